@@ -0,0 +1,293 @@
+// Benchmarks of the hgrm pipeline stages
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// Each stage is measured on generated VCFs of several
+// (n_samples, k_founders, n_markers) sizes:
+//
+//      BM_GetLine          BufferedRead::get_line               bytes/s
+//      BM_NextField        StringRecord::next_field             bytes/s
+//      BM_ParseVcfLine     HaplotypeDataRecord::parse_vcf_line  bytes/s, markers/s
+//      BM_AccumulateUpper  GRM accumulation kernel              markers/s, GFLOP/s
+//      BM_AccumulateSparse sparse kernel, including conversion  markers/s, dense GFLOP/s
+//      BM_AccumulatePairs  pair state kernel, including coding  markers/s, dense GFLOP/s
+//      BM_EndToEnd         parse and accumulate a whole file    all of the above
+//
+// Run from the build directory,
+//
+//      ./hgrm_bench --benchmark_counters_tabular=true
+//
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <tuple>
+#include "HaplotypeVcfParser.h"
+#include "GrmKernels.h"
+#include "VcfSimulator.h"
+
+
+namespace {
+
+const size_t BENCH_BUFFER_SIZE { 100000 };
+
+
+// Simulated VCF of n samples with k founder haplotype dosages for m
+// markers, written once per size in to the working directory
+std::string bench_vcf(size_t n, size_t k, size_t m) {
+
+    static std::map<std::tuple<size_t, size_t, size_t>, std::string> cache;
+
+    auto key { std::make_tuple(n, k, m) };
+    auto found { cache.find(key) };
+    if (found != cache.end())
+        return found->second;
+
+    std::string fname { "hgrm_bench_" + std::to_string(n) + "_"
+                        + std::to_string(k) + "_" + std::to_string(m) + ".vcf" };
+
+    SimulationParams params;
+    params.n_samples = n;
+    params.k_founders = k;
+    params.n_markers = m;
+    params.block_length = 100;
+    params.noise = 0.005;
+
+    write_simulated_vcf(fname.c_str(), params);
+
+    cache[key] = fname;
+    return fname;
+}
+
+
+// first data line of a benchmark VCF
+std::string first_record(const std::string& fname) {
+    BufferedRead reader { const_cast<char*>(fname.c_str()), BENCH_BUFFER_SIZE };
+    CharBuffer line { 1 << 24 };
+
+    while (reader.get_line(line) > 0)
+        if (line(0) != '#')
+            break;
+
+    return line.data();
+}
+
+
+size_t file_bytes(const std::string& fname) {
+    FILE* fid { std::fopen(fname.c_str(), "r") };
+    std::fseek(fid, 0, SEEK_END);
+    size_t bytes { static_cast<size_t>(std::ftell(fid)) };
+    std::fclose(fid);
+    return bytes;
+}
+
+
+void set_sizes(benchmark::internal::Benchmark* b) {
+    b->Args({ 100, 8, 200 })
+        ->Args({ 500, 8, 50 })
+        ->Args({ 500, 16, 50 })
+        ->Args({ 2000, 8, 10 });
+}
+
+
+double kernel_flops(size_t n, size_t k) {
+    return static_cast<double>(n) * (n + 1) / 2 * 2 * k;
+}
+
+}
+
+
+static void BM_GetLine(benchmark::State& state) {
+    std::string fname { bench_vcf(state.range(0), state.range(1), state.range(2)) };
+    CharBuffer line { 1 << 24 };
+    size_t bytes { 0 };
+
+    for (auto _ : state) {
+        BufferedRead reader { const_cast<char*>(fname.c_str()), BENCH_BUFFER_SIZE };
+        while (reader.get_line(line) > 0)
+            bytes += line.size() + 1;
+
+        benchmark::DoNotOptimize(line.data());
+    }
+
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_GetLine)->Apply(set_sizes);
+
+
+static void BM_NextField(benchmark::State& state) {
+    std::string line { first_record(bench_vcf(state.range(0), state.range(1), state.range(2))) };
+    StringRecord fields { SPACE_DELIM, line.size() };
+
+    for (auto _ : state) {
+        fields.update_str(line.c_str());
+        while (fields.next_field())
+            benchmark::DoNotOptimize(fields.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * line.size());
+}
+BENCHMARK(BM_NextField)->Apply(set_sizes);
+
+
+static void BM_ParseVcfLine(benchmark::State& state) {
+    std::string line { first_record(bench_vcf(state.range(0), state.range(1), state.range(2))) };
+    HaplotypeDataRecord record { static_cast<size_t>(state.range(0)),
+                                 static_cast<size_t>(state.range(1)) };
+
+    for (auto _ : state) {
+        record.parse_vcf_line(line.c_str());
+        benchmark::DoNotOptimize(&record(0, 0));
+    }
+
+    state.SetBytesProcessed(state.iterations() * line.size());
+    state.counters["markers/s"] = benchmark::Counter(state.iterations(),
+                                                     benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ParseVcfLine)->Apply(set_sizes);
+
+
+static void BM_AccumulateUpper(benchmark::State& state) {
+    const size_t n { static_cast<size_t>(state.range(0)) };
+    const size_t k { static_cast<size_t>(state.range(1)) };
+
+    std::string line { first_record(bench_vcf(n, k, state.range(2))) };
+    HaplotypeDataRecord record { n, k };
+    record.parse_vcf_line(line.c_str());
+
+    Matrix covariance { n, n };
+
+    for (auto _ : state) {
+        accumulate_upper(record, covariance);
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["markers/s"] = benchmark::Counter(state.iterations(),
+                                                     benchmark::Counter::kIsRate);
+    state.counters["GFLOP/s"] = benchmark::Counter(
+            state.iterations() * kernel_flops(n, k) / 1e9,
+            benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_AccumulateUpper)->Apply(set_sizes);
+
+
+// a panel of the founder major dosages of 64 markers added at once
+static void BM_AccumulatePanel(benchmark::State& state) {
+    const size_t n { static_cast<size_t>(state.range(0)) };
+    const size_t k { static_cast<size_t>(state.range(1)) };
+    const size_t m_markers { 64 };
+
+    std::string line { first_record(bench_vcf(n, k, state.range(2))) };
+    HaplotypeDataRecord record { n, k };
+    record.set_layout(RecordLayout::founder_major);
+    record.parse_vcf_line(line.c_str());
+
+    DosagePanel panel { n, k, m_markers };
+    while (!panel.full())
+        panel.append(record);
+
+    Matrix covariance { n, n };
+
+    for (auto _ : state) {
+        accumulate_upper(panel, covariance);
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["markers/s"] = benchmark::Counter(state.iterations() * m_markers,
+                                                     benchmark::Counter::kIsRate);
+    state.counters["GFLOP/s"] = benchmark::Counter(
+            state.iterations() * m_markers * kernel_flops(n, k) / 1e9,
+            benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_AccumulatePanel)->Apply(set_sizes);
+
+
+// GFLOP/s counts the flops of the dense kernel, so the two are
+// directly comparable
+static void BM_AccumulateSparse(benchmark::State& state) {
+    const size_t n { static_cast<size_t>(state.range(0)) };
+    const size_t k { static_cast<size_t>(state.range(1)) };
+
+    std::string line { first_record(bench_vcf(n, k, state.range(2))) };
+    HaplotypeDataRecord record { n, k };
+    record.parse_vcf_line(line.c_str());
+
+    SparseDosage sparse { n, k, 0.01 };
+    Matrix covariance { n, n };
+
+    for (auto _ : state) {
+        sparse.assign(record);
+        accumulate_upper(sparse, covariance);
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["density"] = sparse.density();
+    state.counters["markers/s"] = benchmark::Counter(state.iterations(),
+                                                     benchmark::Counter::kIsRate);
+    state.counters["GFLOP/s"] = benchmark::Counter(
+            state.iterations() * kernel_flops(n, k) / 1e9,
+            benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_AccumulateSparse)->Apply(set_sizes);
+
+
+static void BM_AccumulatePairs(benchmark::State& state) {
+    const size_t n { static_cast<size_t>(state.range(0)) };
+    const size_t k { static_cast<size_t>(state.range(1)) };
+
+    std::string line { first_record(bench_vcf(n, k, state.range(2))) };
+    HaplotypeDataRecord record { n, k };
+    record.parse_vcf_line(line.c_str());
+
+    PairStates states { n, k, 0.05 };
+    Matrix covariance { n, n };
+
+    for (auto _ : state) {
+        states.assign(record);
+        accumulate_upper(states, covariance);
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["exact"] = static_cast<double>(states.n_exact()) / n;
+    state.counters["markers/s"] = benchmark::Counter(state.iterations(),
+                                                     benchmark::Counter::kIsRate);
+    state.counters["GFLOP/s"] = benchmark::Counter(
+            state.iterations() * kernel_flops(n, k) / 1e9,
+            benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_AccumulatePairs)->Apply(set_sizes);
+
+
+// The loop of hgrm: parse every marker of the file and accumulate
+static void BM_EndToEnd(benchmark::State& state) {
+    const size_t n { static_cast<size_t>(state.range(0)) };
+    const size_t k { static_cast<size_t>(state.range(1)) };
+
+    std::string fname { bench_vcf(n, k, state.range(2)) };
+    size_t m_markers { 0 };
+
+    for (auto _ : state) {
+        HaplotypeVcfParser vcf { const_cast<char*>(fname.c_str()), BENCH_BUFFER_SIZE };
+        HaplotypeDataRecord record { vcf.n_samples(), vcf.k_founders() };
+        Matrix covariance { n, n };
+
+        while (vcf.load_record(record)) {
+            accumulate_upper(record, covariance);
+            m_markers++;
+        }
+
+        benchmark::DoNotOptimize(&covariance(0, 0));
+    }
+
+    state.SetBytesProcessed(state.iterations() * file_bytes(fname));
+    state.counters["markers/s"] = benchmark::Counter(m_markers,
+                                                     benchmark::Counter::kIsRate);
+    state.counters["GFLOP/s"] = benchmark::Counter(
+            m_markers * kernel_flops(n, k) / 1e9,
+            benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_EndToEnd)->Apply(set_sizes)->Unit(benchmark::kMillisecond);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+// GRM accumulation from the change points of each sample
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// The haplotype dosages of a sample only change at its own
+// recombination breakpoints.  For each pair of samples the current
+// product x_i . x_j is kept with the marker from which it is valid.
+// When the dosages of sample i change, only the pairs of row and
+// column i are flushed to the GRM, product times the number of markers
+// it held, and recomputed at O(n k).  The work is proportional to the
+// number of change points times n rather than markers times n^2.
+//
+// A sample changes when any dosage differs from its current dosages by
+// more than the tolerance, otherwise its current dosages are kept.  A
+// tolerance of 0 reproduces the dense GRM exactly.
+//
+// Contributions are pending until flush is called, which must be done
+// after the last marker and before the GRM is used.  The weight must be
+// the same for every call of a pass.
+//
+#ifndef HEADER_CHANGEPOINTACCUMULATOR_H
+#define HEADER_CHANGEPOINTACCUMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include "Matrix.h"
+#include "HaplotypeVcfParser.h"
+
+
+class ChangePointAccumulator
+{
+public:
+    ChangePointAccumulator(size_t n_samples, size_t k_founders, double tolerance=0);
+    ChangePointAccumulator(const ChangePointAccumulator&)=delete;
+    ChangePointAccumulator& operator=(const ChangePointAccumulator&)=delete;
+
+    void add_marker(const HaplotypeDataRecord&, Matrix& covariance, double weight=1);
+    void flush(Matrix& covariance, double weight=1);
+
+    size_t n_markers() const;
+    size_t n_changes() const;           // sample dosage changes over all markers
+
+private:
+    const size_t n_samples_;
+    const size_t k_founders_;
+    const double tolerance_;
+
+    std::vector<double> rows_;          // current dosages, n_samples by k_founders
+    Matrix products_;                   // upper triangle, current x_i . x_j
+    std::vector<uint32_t> valid_from_;  // upper triangle, marker of the product
+
+    std::vector<size_t> changed_;
+    std::vector<bool> is_changed_;
+
+    size_t m_markers_ { 0 };
+    size_t n_changes_ { 0 };
+
+    bool differs_(const double* row, const double* current) const;
+    void flush_pair_(size_t a, size_t b, Matrix& covariance, double weight);
+};
+
+#endif
@@ -0,0 +1,47 @@
+// Compressed text output formatted and compressed by several threads
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// Text is produced in chunks that are formatted and compressed
+// independently, then written in order, so the writer is not a serial
+// bottleneck.  Each chunk is compressed to complete blocks whose
+// concatenation is a valid stream:
+//
+//      gzip    BGZF blocks of at most 64 KB, gzip members carrying their
+//              compressed size, ended by the BGZF end of file block.
+//              Readable by gzip and zcat, and indexable by bgzip.
+//      zstd    one zstd frame per chunk.
+//
+// zstd is only available when its header and library were found at
+// build time, see compression_available.
+//
+#ifndef HEADER_COMPRESSEDOUTPUT_H
+#define HEADER_COMPRESSEDOUTPUT_H
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+
+enum class Compression { none, gzip, zstd };
+
+Compression parse_compression(const char* name);
+
+bool compression_available(Compression compression);
+
+
+// Append the compressed blocks of n bytes of data to out
+void compress_blocks(Compression compression, const char* data, size_t n,
+                     std::string& out);
+
+
+// Write n_chunks chunks of text in order, format(c, text) sets text to
+// chunk c.  Chunks are formatted and compressed by n_threads workers.
+// Returns the number of bytes written.
+size_t write_compressed_chunks(FILE* fout, Compression compression, size_t n_chunks,
+                               const std::function<void(size_t, std::string&)>& format,
+                               size_t n_threads);
+
+#endif
@@ -0,0 +1,73 @@
+// Haplotype dosages of consecutive markers held founder major
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// A panel holds up to capacity markers, each k_founders columns of the
+// n_samples dosages in the founder major layout of HaplotypeDataRecord.
+// Column c, founder c % k_founders of marker c / k_founders, starts at a
+// 64 byte boundary and is padded with zeros to stride() values.
+//
+// Records parse lines directly in to the panel:
+//
+//      record.set_layout(RecordLayout::founder_major);
+//      record.set_target(panel.next_marker());
+//      while (vcf.load_record(record)) {
+//          panel.commit();
+//          if (panel.full()) {
+//              accumulate_upper(panel, covariance);
+//              panel.clear();
+//          }
+//          record.set_target(panel.next_marker());
+//      }
+//
+#ifndef HEADER_DOSAGEPANEL_H
+#define HEADER_DOSAGEPANEL_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include "HaplotypeVcfParser.h"
+
+
+class DosagePanel
+{
+public:
+    DosagePanel(size_t n_samples, size_t k_founders, size_t capacity);
+    DosagePanel(const DosagePanel&)=delete;
+    DosagePanel& operator=(const DosagePanel&)=delete;
+
+    // storage of the marker following those committed, for
+    // HaplotypeDataRecord::set_target
+    double* next_marker();
+
+    // keep the marker written to next_marker
+    void commit();
+
+    // copy in the dosages of a record of either layout
+    void append(const HaplotypeDataRecord&);
+
+    void clear();
+    bool full() const;
+
+    size_t n_samples() const;
+    size_t k_founders() const;
+    size_t capacity() const;
+    size_t n_markers() const;
+    size_t n_columns() const;           // n_markers * k_founders
+    size_t stride() const;
+
+    const double* column(size_t c) const;
+
+private:
+    const size_t n_samples_;
+    const size_t k_founders_;
+    const size_t capacity_;
+    const size_t stride_;
+    size_t n_markers_ { 0 };
+
+    std::unique_ptr<double, void(*)(void*)> data_ { nullptr, std::free };
+};
+
+#endif
@@ -0,0 +1,184 @@
+// Streaming accumulation of the GRM for embedding in other programs
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// GrmAccumulator sums the cross products of marker panels, n_samples
+// by k_founders haplotype dosages, in to the upper triangle of an
+// n_samples by n_samples matrix, with the kernel and normalization
+// given by GrmOptions.  Accumulators over disjoint sets of markers, e.g.
+// one per thread or chromosome, are combined with merge.  After
+// finalize, data() is the GRM, row major with the upper triangle valid,
+// read in place or taken with release.
+//
+//      GrmAccumulator grm { n, k, options };
+//      while (vcf.load_record(record))
+//          grm.add(record);
+//      grm.finalize();
+//      use(grm.data());
+//
+// With panel_markers the dense kernel adds markers a panel at a time.
+// Records given to attach are then parsed, founder major, straight in
+// to the panel, so no dosages are copied:
+//
+//      grm.attach(record);
+//      while (vcf.load_record(record))
+//          grm.add(record);
+//
+// MarkerKernel is the record representation of a kernel, also used
+// where only rows of the GRM are computed.
+//
+#ifndef HEADER_GRMACCUMULATOR_H
+#define HEADER_GRMACCUMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Matrix.h"
+#include "HaplotypeVcfParser.h"
+#include "SparseDosage.h"
+#include "PairStates.h"
+#include "ChangePointAccumulator.h"
+#include "GrmNormalizer.h"
+#include "PairCounts.h"
+#include "DosagePanel.h"
+
+
+enum class GrmKernel { dense, sparse, pair_states, change_points };
+
+
+struct GrmOptions
+{
+    GrmKernel kernel { GrmKernel::dense };
+    double tolerance { 0 };     // eps of sparse, tolerance of pair states and change points
+    Normalization normalize { Normalization::none };
+    bool pair_counts { false };
+    size_t panel_markers { 0 };     // markers per panel, dense kernel and no standardize
+};
+
+
+class MarkerKernel
+{
+public:
+    MarkerKernel(size_t n_samples, size_t k_founders,
+                 GrmKernel kernel=GrmKernel::dense, double tolerance=0);
+    MarkerKernel(const MarkerKernel&)=delete;
+    MarkerKernel& operator=(const MarkerKernel&)=delete;
+
+    // covariance += weight x x^T, or with founder_weights the sum of
+    // x_ik x_jk weighted by founder, dense and sparse kernels only
+    void add_marker(const HaplotypeDataRecord&, Matrix& covariance,
+                    double weight=1, const double* founder_weights=nullptr);
+
+    // cross(r, j) += x_{rows[r]} . x_j, change points use the dense rows
+    void add_rows(const HaplotypeDataRecord&, const std::vector<size_t>& rows,
+                  Matrix& cross);
+
+    // add contributions still held after the last marker
+    void flush(Matrix& covariance, double weight=1);
+
+    GrmKernel kind() const;
+    const ChangePointAccumulator* change_points() const;      // nullptr unless change points
+
+private:
+    const GrmKernel kind_;
+
+    std::unique_ptr<SparseDosage> sparse_;
+    std::unique_ptr<PairStates> pairs_;
+    std::unique_ptr<ChangePointAccumulator> change_points_;
+};
+
+
+class GrmAccumulator
+{
+public:
+    GrmAccumulator(size_t n_samples, size_t k_founders,
+                   const GrmOptions& options=GrmOptions {});
+
+    // accumulate in to covariance, n_samples square and zero, e.g. the
+    // matrix of a binary GRM file from create_grm_mapped
+    GrmAccumulator(size_t n_samples, size_t k_founders, const GrmOptions& options,
+                   std::unique_ptr<Matrix> covariance);
+    GrmAccumulator(const GrmAccumulator&)=delete;
+    GrmAccumulator& operator=(const GrmAccumulator&)=delete;
+
+    // Add a marker.  Missing samples add nothing, or with normalization
+    // their dosages are set to the marker means, in the record.
+    void add(HaplotypeDataRecord&);
+
+    // Set the record founder major, writing the lines parsed after to
+    // the panel, until it is attached to another accumulator or its
+    // target is reset.  Nothing is done without panel_markers.
+    void attach(HaplotypeDataRecord&);
+
+    // Add in two steps, for threads sharing one matrix: the totals of
+    // each marker in marker order, then its products by bands of rows,
+    // each band in marker order, with the founder weights add_totals
+    // gave for the marker, empty when unweighted.  Every entry is summed
+    // as by add, so the GRM does not depend on the bands or threads.
+    // add_rows may be called concurrently for disjoint bands.  Dense
+    // kernel without panels.
+    void add_totals(HaplotypeDataRecord&, std::vector<double>& founder_weights);
+    void add_rows(const HaplotypeDataRecord&, const std::vector<double>& founder_weights,
+                  size_t row_begin, size_t row_end);
+
+    // n_samples by k_founders dosages, row major, valid as in
+    // HaplotypeDataRecord::assign
+    void add(const double* dosages, const uint64_t* valid=nullptr);
+
+    // add the contributions held by the kernel, done by finalize and
+    // required of an accumulator before it is merged
+    void flush();
+
+    // add the markers of another accumulator with the same options
+    void merge(const GrmAccumulator&);
+
+    // merge in parts, e.g. rows split over threads followed by totals
+    void merge_rows(const GrmAccumulator&, size_t row_begin, size_t row_end);
+    void merge_totals(const GrmAccumulator&);
+
+    // flush and normalize, no markers may be added or merged after
+    void finalize();
+    bool finalized() const;
+
+    size_t n_samples() const;
+    size_t k_founders() const;
+    size_t n_markers() const;
+    size_t n_missing() const;           // missing sample entries
+    const GrmOptions& options() const;
+    const MarkerKernel& kernel() const;
+
+    // n_samples by n_samples, row major, upper triangle valid
+    const double* data() const;
+    const Matrix& matrix() const;
+
+    // hand over the matrix, the accumulator holds none after
+    std::unique_ptr<Matrix> release();
+
+private:
+    const size_t n_samples_;
+    const size_t k_founders_;
+    const GrmOptions options_;
+
+    MarkerKernel kernel_;
+    GrmNormalizer normalizer_;
+    std::unique_ptr<PairCounts> counts_;
+    std::unique_ptr<Matrix> covariance_;
+    std::unique_ptr<HaplotypeDataRecord> record_;      // for add of raw dosages
+    std::unique_ptr<DosagePanel> panel_;
+
+    size_t m_markers_ { 0 };
+    size_t n_missing_ { 0 };
+    bool flushed_ { true };
+    bool finalized_ { false };
+
+    void check_open_() const;
+    void check_banded_() const;
+    void add_marker_totals_(HaplotypeDataRecord&);
+    void add_to_panel_(HaplotypeDataRecord&);
+    void flush_panel_();
+    void check_merge_(const GrmAccumulator&) const;
+};
+
+#endif
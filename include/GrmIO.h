@@ -0,0 +1,111 @@
+// Reading and writing genetic relationship matrices
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// Binary GRM layout, all integers little endian uint64:
+//
+//      offset 0        magic "HGRMBIN\0"
+//      offset 8        version, with GRM_INCOMPLETE set while the
+//                      matrix is being accumulated in the file
+//      offset 16       n_samples
+//      offset 24       n_markers, count of markers summed in to the matrix
+//      offset 32       id_bytes, length of the sample id block
+//      offset 40       data_offset
+//      offset 48       sample ids, each null terminated, in matrix order
+//      data_offset     n_samples x n_samples doubles, row-major
+//
+// data_offset is a multiple of GRM_DATA_ALIGNMENT.  The matrix is the
+// unnormalized sum over markers.  Only the upper triangle (j >= i) is
+// authoritative, writers may leave the lower triangle unset.
+//
+// A GRM may be accumulated in the file itself, see create_grm_mapped:
+// the matrix is mapped from data_offset and GRM_INCOMPLETE stays set in
+// version until sync_grm_mapped has written back the matrix and
+// n_markers.  The file of an interrupted run is rejected by
+// read_grm_binary, its matrix need not match any marker count, while a
+// complete GRM of 0 markers is read as any other.
+//
+// Sparse GRMs follow GCTA's --make-bK-sparse files: <prefix>.grm.id
+// with FID and IID of each sample, tab delimited, and <prefix>.grm.sp
+// with one "i j value" line per kept pair, i >= j indices in to the
+// id file from 0, ordered by i then j.  The diagonal is always kept.
+//
+#ifndef HEADER_GRMIO_H
+#define HEADER_GRMIO_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include "Matrix.h"
+
+
+const char GRM_MAGIC[8] { 'H', 'G', 'R', 'M', 'B', 'I', 'N', '\0' };
+const uint64_t GRM_VERSION { 1 };
+const uint64_t GRM_INCOMPLETE { uint64_t { 1 } << 63 };
+const uint64_t GRM_DATA_ALIGNMENT { 4096 };
+
+
+struct GrmBinaryHeader
+{
+    char magic[8];
+    uint64_t version;
+    uint64_t n_samples;
+    uint64_t n_markers;
+    uint64_t id_bytes;
+    uint64_t data_offset;
+};
+
+
+struct GrmBinary
+{
+    std::vector<std::string> sample_ids;
+    size_t n_markers { 0 };
+    std::unique_ptr<Matrix> covariance { nullptr };   // upper triangle valid
+};
+
+
+// header and id block for the given samples
+GrmBinaryHeader make_grm_header(const std::vector<std::string>& sample_ids,
+                                size_t n_markers);
+
+void write_grm_binary(const char* filename,
+                      const Matrix& covariance,
+                      const std::vector<std::string>& sample_ids,
+                      size_t n_markers);
+
+// Throws when the file is not a complete binary GRM
+GrmBinary read_grm_binary(const char* filename);
+
+// Create filename as an incomplete binary GRM of the samples with
+// n_markers 0 and a zero matrix, and return its matrix mapped for
+// accumulating in place.  The file is extended rather than written, so matrix pages
+// take disk space only once written.
+std::unique_ptr<Matrix> create_grm_mapped(const char* filename,
+                                          const std::vector<std::string>& sample_ids);
+
+// Write back the matrix of create_grm_mapped, then set n_markers and
+// clear GRM_INCOMPLETE in the header, completing the file
+void sync_grm_mapped(const char* filename, Matrix& covariance, size_t n_markers);
+
+// Symmetric comma delimited text, one matrix row per line, from the
+// upper triangle of covariance
+void write_grm_text(FILE* fout, const Matrix& covariance);
+
+// Set text to rows [row_begin, row_end) as written by write_grm_text
+void format_grm_rows(const Matrix& covariance, size_t row_begin, size_t row_end,
+                     std::string& text);
+
+// GCTA id file, the sample id as both FID and IID
+void write_grm_ids(FILE* fout, const std::vector<std::string>& sample_ids);
+
+// GCTA sparse triplets of the diagonal and the pairs whose value
+// exceeds threshold, read from the upper triangle of covariance one
+// tile at a time.  Returns the number of triplets written.
+size_t write_grm_sparse(FILE* fout, const Matrix& covariance, double threshold);
+
+#endif
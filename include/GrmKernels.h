@@ -0,0 +1,81 @@
+// Accumulation of haplotype cross products in to a GRM
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// For a marker with haplotype dosages x_i (length k_founders) of each
+// sample i, the GRM is updated by the dot products x_i . x_j.
+//
+// The sparse kernels scatter, for each founder, the products of the
+// samples carrying it.  With about two retained dosages per sample the
+// work per marker is about 2 n^2 / k rather than n^2 k / 2.
+//
+// Founder major records and panels of markers are added by founder
+// column, covariance(i, j) += x_ki x_kj over a tile of j at a time,
+// a loop vectorized over samples that needs no transposition.
+//
+// The pair state kernels replace the dot product of two coded samples
+// by a lookup in the table of state dot products.
+//
+#ifndef HEADER_GRMKERNELS_H
+#define HEADER_GRMKERNELS_H
+
+#include <cstddef>
+#include <vector>
+#include <stdexcept>
+#include "Matrix.h"
+#include "HaplotypeVcfParser.h"
+#include "SparseDosage.h"
+#include "PairStates.h"
+#include "DosagePanel.h"
+
+
+// covariance(i, j) += weight x_i . x_j for all j >= i, the upper
+// triangle.  A weight of -1 removes a marker's contribution.  Records
+// may have either layout, accumulate_rows requires sample major ones.
+void accumulate_upper(const HaplotypeDataRecord& record, Matrix& covariance,
+                      double weight=1);
+
+// as above for the rows in [row_begin, row_end), each entry is summed as
+// by the whole matrix kernel, so bands of rows may be given to threads
+void accumulate_upper(const HaplotypeDataRecord& record, Matrix& covariance,
+                      size_t row_begin, size_t row_end, double weight=1);
+
+// cross(r, j) += x_{rows[r]} . x_j for every sample j, i.e. the rows
+// of the GRM belonging to the listed samples
+void accumulate_rows(const HaplotypeDataRecord& record,
+                     const std::vector<size_t>& rows,
+                     Matrix& cross);
+
+// as above from the retained dosages of a sparse record
+void accumulate_upper(const SparseDosage& dosage, Matrix& covariance,
+                      double weight=1);
+
+void accumulate_rows(const SparseDosage& dosage,
+                     const std::vector<size_t>& rows,
+                     Matrix& cross);
+
+// covariance(i, j) += sum_k founder_weights[k] x_ik x_jk for j >= i
+void accumulate_upper_weighted(const HaplotypeDataRecord& record, Matrix& covariance,
+                               const double* founder_weights);
+
+void accumulate_upper_weighted(const HaplotypeDataRecord& record, Matrix& covariance,
+                               const double* founder_weights,
+                               size_t row_begin, size_t row_end);
+
+void accumulate_upper_weighted(const SparseDosage& dosage, Matrix& covariance,
+                               const double* founder_weights);
+
+// as above from founder pair state codes
+void accumulate_upper(const PairStates& states, Matrix& covariance,
+                      double weight=1);
+
+void accumulate_rows(const PairStates& states,
+                     const std::vector<size_t>& rows,
+                     Matrix& cross);
+
+// the sum of the above over the markers of the panel
+void accumulate_upper(const DosagePanel& panel, Matrix& covariance,
+                      double weight=1);
+
+#endif
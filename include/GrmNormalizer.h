@@ -0,0 +1,84 @@
+// Centering and standardization of the GRM in a single pass
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// With mu the mean founder dosages of a marker and w_k a weight per
+// founder, the normalized GRM is
+//
+//      G_ij = 1/M sum_m sum_k w_k (x_ik - mu_k) (x_jk - mu_k)
+//           = 1/M (C_ij - a_i - a_j + c)
+//
+// where C_ij = sum_m sum_k w_k x_ik x_jk is accumulated by the usual
+// kernels, and
+//
+//      a_i = sum_m sum_k w_k x_ik mu_k
+//      c   = sum_m sum_k w_k mu_k^2
+//
+// are kept here while the markers stream, so the corrections are
+// applied at finalize without a second pass.
+//
+// Modes
+//      none            w_k = 1, no centering, the raw sum C
+//      center          w_k = 1
+//      standardize     w_k = 1 / (2 p_k (1 - p_k)) with p_k = mu_k / 2 the
+//                      founder haplotype frequency, 0 for monomorphic
+//                      founders
+//
+#ifndef HEADER_GRMNORMALIZER_H
+#define HEADER_GRMNORMALIZER_H
+
+#include <cstddef>
+#include <vector>
+#include <stdexcept>
+#include "Matrix.h"
+#include "HaplotypeVcfParser.h"
+#include "PairCounts.h"
+
+
+enum class Normalization { none, center, standardize };
+
+Normalization parse_normalization(const char*);
+
+
+class GrmNormalizer
+{
+public:
+    GrmNormalizer(size_t n_samples, size_t k_founders, Normalization);
+
+    Normalization mode() const;
+
+    // update the running corrections with a marker, call before
+    // accumulating it
+    void add_marker(const HaplotypeDataRecord&);
+
+    // weights w_k of the last marker, null when all are 1 so that the
+    // unweighted kernels apply
+    const double* founder_weights() const;
+
+    size_t n_markers() const;
+
+    // add the corrections of markers seen by another instance
+    void merge(const GrmNormalizer&);
+
+    // covariance holds C in its upper triangle, replaced by G.  With
+    // counts each entry is divided by the markers at which both samples
+    // were observed instead of M, missing dosages must then have been
+    // filled with the marker means so their centered values are 0.
+    void finalize(Matrix& covariance, const PairCounts* counts=nullptr) const;
+
+private:
+    const size_t n_samples_;
+    const size_t k_founders_;
+    const Normalization mode_;
+
+    std::vector<double> mean_;          // mu of the last marker
+    std::vector<double> weights_;       // w of the last marker
+    std::vector<double> weighted_mean_; // w_k mu_k
+
+    std::vector<double> a_;
+    double c_ { 0 };
+    size_t m_markers_ { 0 };
+};
+
+#endif
@@ -19,18 +19,27 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <array>
+#include <vector>
+#include <unordered_set>
 #include <cstdlib>
+#include <cstdint>
 #include <cstring>
+#include <memory>
 #include "Matrix.h"
+#include "MarkerFilter.h"
+#include "Profiler.h"
 #include "utils.h"
 
 
 // samples are separated by white space
 const char HAP_CODE[] { "HD" };
+const char DOSAGE_CODE[] { "DS" };
 const char META_PREFIX { '#' };
 const char MEASUREMENT_DELIM { ':' };
 const char HAP_DELIM { ',' };
+const char MISSING_VALUE { '.' };
 const int NUM_VCF_FIELDS { 9 };
 const char SPACE_DELIM { '\t' };
 
@@ -49,52 +58,141 @@ static const char* VCF_FIELD_NAMES[NUM_VCF_FIELDS] {
 };
 
 
+// Sample identifiers to retain (keep) or exclude (remove) from the
+// analysis.  An empty keep list retains every sample in the header,
+// unless has_keep marks it as given, e.g. by an empty --keep file,
+// which is an error.
+struct SampleSelection
+{
+    std::vector<std::string> keep;
+    std::vector<std::string> remove;
+    bool has_keep { false };
+};
+
+
 // Move semantics, I don't want to copy data
+// Dosages of a record are held sample major, n_samples by k_founders,
+// or founder major, k_founders columns of the n_samples dosages, each
+// column padded to founder_stride() values and 64 byte aligned so
+// kernels may be vectorized over samples.
+enum class RecordLayout { sample_major, founder_major };
+
+
 class HaplotypeDataRecord
 {
 public:
 
     HaplotypeDataRecord()=delete;
     HaplotypeDataRecord(size_t, size_t);
+    // sample_mask has one entry per sample column of the VCF, columns
+    // that are false are skipped without being parsed
+    HaplotypeDataRecord(size_t, size_t, const std::vector<bool>& sample_mask);
     HaplotypeDataRecord(const HaplotypeDataRecord&)=delete;
     HaplotypeDataRecord(HaplotypeDataRecord&&)=delete;
 
 
-    const std::string& chrom() const;
-    const long pos() const;
-    const std::string& id() const;
-    const char ref() const;
-    const char alt() const;
-    const std::string& qual() const;
-    const std::string& filter() const;
-    const std::string& info() const;
-    const std::string& format() const;
+    // The fixed columns are views of a copy of the first nine columns
+    // of the line, valid until the next line is parsed.  They are
+    // decoded, e.g. POS converted to a number, only when requested.
+    std::string_view chrom() const;
+    long pos() const;
+    std::string_view id() const;
+    char ref() const;
+    char alt() const;
+    std::string_view qual() const;
+    std::string_view filter() const;
+    std::string_view info() const;
+    std::string_view format() const;
+
+    // value of key=value in the INFO column, empty if key is absent
+    std::string_view info(std::string_view key) const;
 
     void parse_vcf_line(const char*);
     const double& operator()(size_t, size_t) const;
 
+    // Set the dosages from n_samples by k_founders values, row major,
+    // in place of a parsed line.  valid has the layout of valid_words,
+    // nullptr when every sample was observed.
+    void assign(const double* dosages, const uint64_t* valid=nullptr);
+
+    // A sample whose HD entry is '.', has a '.' dosage, or is absent
+    // from the sample field is missing, its dosages are set to 0 and
+    // its bit of the validity mask is cleared.  Bit i % 64 of word
+    // i / 64 is set when sample i was observed.
+    bool is_valid(size_t) const;
+    size_t n_missing() const;
+    const uint64_t* valid_words() const;
+
+    // set the dosages of missing samples to the founder means of the
+    // observed samples
+    void fill_missing_with_mean();
+
+    // time tokenize and parse phases, nullptr disables timing
+    void set_profiler(PhaseCounters*);
+
     std::array<size_t,2> dims() const;
 
+    // Lines are parsed directly in to the layout, changing it clears the
+    // dosages
+    void set_layout(RecordLayout);
+    RecordLayout layout() const;
+
+    // founder major only, the dosages of founder k and the distance in
+    // values between founders, a multiple of 8 whose padding is zero
+    const double* founder_data(size_t k) const;
+    size_t founder_stride() const;
+
+    // Founder major dosages of the following lines are written to
+    // target, k_founders * founder_stride() values, 64 byte aligned with
+    // zero padding, e.g. a marker of a DosagePanel.  nullptr restores the
+    // storage of the record.
+    void set_target(double* target);
+    const double* target() const;
+
+    // The DS subfield of the following lines is parsed, in the same
+    // pass as HD, in to the dosages and validity of snp_dosages, an
+    // n_samples by 1 record in either layout, e.g. attached to a panel.
+    // Samples without DS or with DS '.' are missing there.  Its fixed
+    // columns are not set.  nullptr stops.
+    void set_snp_dosages(HaplotypeDataRecord* snp_dosages);
+
 
 private:
     size_t n_samples_;
     size_t k_founders_;
 
-    std::string chrom_ { "" };
-    long pos_ { -1 };
-    std::string id_ { "" };
-    char ref_ { '\0' };
-    char alt_ { '\0' };
-    std::string qual_ { "" };
-    std::string filter_ { "" };
-    std::string info_ { "" };
-    std::string format_ { "" };
+    RecordLayout layout_ { RecordLayout::sample_major };
+    size_t stride_ { 0 };
+    std::unique_ptr<double, void(*)(void*)> founders_ { nullptr, std::free };
+    double* target_ { nullptr };        // founder major values, founders_ or set_target
+
+    // first nine columns of the line, the buffer is reused between lines
+    std::string fixed_;
+    std::array<std::string_view, NUM_VCF_FIELDS> fixed_cols_;
+
+    // FORMAT of the previous line and the index of HD in it
+    std::string hap_format_;
+    size_t hap_idx_ { 0 };
+    size_t ds_idx_ { SIZE_MAX };        // SIZE_MAX when FORMAT has no DS
+
+    HaplotypeDataRecord* snp_dosages_ { nullptr };
 
     std::unique_ptr<Matrix> samples_ { nullptr };
+    std::vector<bool> sample_mask_;
+    std::vector<uint64_t> valid_;
+    size_t n_missing_ { 0 };
+    PhaseCounters* profile_ { nullptr };
 
     StringRecord line_parse_ { SPACE_DELIM };
     StringRecord field_parse_ { MEASUREMENT_DELIM };
     StringRecord hap_parse_ { HAP_DELIM };
+
+    void reset_valid_();
+    const char* parse_fixed_(const char* line);
+    void find_hap_idx_();
+    void set_missing_(size_t);
+    void parse_hap_(size_t i, const char* field);
+    double& value_(size_t i, size_t k);
 };
 
 
@@ -105,17 +203,54 @@ public:
     HaplotypeVcfParser()=delete;                                // default constructor
     HaplotypeVcfParser(char* filename);                         // constructor
     HaplotypeVcfParser(char* filename, size_t buffer_size);                         // constructor
+    HaplotypeVcfParser(char* filename, size_t buffer_size, const SampleSelection&);   // constructor
+    // another reader of the file opened by header, which is not read
+    // again for its header and line length
+    HaplotypeVcfParser(size_t buffer_size, const HaplotypeVcfParser& header);
     //HaplotypeVcfParser(std::string filename);                   // constructor
     HaplotypeVcfParser(const HaplotypeVcfParser&)=delete;       // copy constructor
     HaplotypeVcfParser(const HaplotypeVcfParser&&)=delete;       // move constructor
     HaplotypeVcfParser& operator=(const HaplotypeVcfParser&)=delete;    // copy assignment
     // ~HaplotypeVcfParser();                                      // descructor
 
-    size_t n_samples() const;
+    size_t n_samples() const;                       // samples retained
+    size_t n_sample_columns() const;                // samples in the VCF
     size_t k_founders() const;
 
+    const std::vector<std::string>& sample_names() const;
+    const std::vector<bool>& sample_mask() const;
+
+    // Markers rejected by the filter are skipped by load_record
+    // without reading their sample columns
+    void set_marker_filter(const MarkerFilter&);
+    const MarkerFilter& marker_filter() const;
+
     bool load_record(HaplotypeDataRecord&);
 
+    // the line of the next record accepted by the filter, without
+    // parsing it, valid until the next read.  nullptr at the end.
+    const char* next_line();
+
+    // return to the first data record, for algorithms that make
+    // several passes over the markers
+    void rewind();
+
+    // Restrict load_record to the records whose lines start in
+    // [begin, end) of the file.  begin and end need not be line starts,
+    // so a file can be split in to byte ranges read concurrently.
+    void set_range(size_t begin, size_t end);
+    size_t data_offset() const;             // file position of the first record
+    const std::string& filename() const;
+
+    size_t bytes_read() const;
+    size_t file_size() const;
+
+    // read the file through io_uring, false when not available
+    bool use_uring(const UringOptions&);
+
+    // time the read phase, nullptr disables timing
+    void set_profiler(PhaseCounters*);
+
 private:
     const std::string fname_;
     BufferedRead file_io_;
@@ -125,13 +260,22 @@ private:
 
     size_t n_cols_ { 0 };
     size_t n_samples_ { 0 };
+    size_t n_sample_cols_ { 0 };
     size_t k_founders_ { 0 };
     size_t fpos_record_one_ { 0 };
+    size_t range_end_ { SIZE_MAX };
+
+    SampleSelection selection_;
+    MarkerFilter marker_filter_;
+    PhaseCounters* profile_ { nullptr };
+    std::vector<std::string> sample_names_;
+    std::vector<bool> sample_mask_;
 
 
     void pos_(size_t);
     size_t get_line_num_char_();
     void set_params_();
+    void select_samples_(const std::vector<std::string>&);
 };
 
 #endif
@@ -0,0 +1,88 @@
+// Top eigenpairs of the haplotype GRM without forming the GRM
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// The GRM is G = sum_m X_m X_m^T, where X_m is the n_samples by
+// k_founders matrix of haplotype dosages at marker m.  The product
+// G Q for an n by l matrix Q is accumulated marker by marker as
+// X_m (X_m^T Q), so each pass over the VCF costs O(n k l) per marker
+// and O(n l) memory.
+//
+// RandomizedEigen implements the randomized range finder with subspace
+// (power) iterations:
+//
+//      Q_0 = orth(Omega),  Omega Gaussian n by l, l = rank + oversample
+//      Q_1 = orth(G Q_0)                         range finder pass
+//      Q_t = orth(G Q_{t-1}),  t = 2 .. q + 1    one pass per iteration
+//      B   = Q^T G Q,  B = V L V^T               final pass
+//      U   = Q V
+//
+// so q power iterations take n_passes(q) = q + 2 passes, each but the
+// last followed by end_pass.
+//
+// see Halko, Martinsson, and Tropp SIAM Review 53, 217-288 (2011).
+//
+#ifndef HEADER_LOWRANK_H
+#define HEADER_LOWRANK_H
+
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include "Matrix.h"
+#include "HaplotypeVcfParser.h"
+
+
+// Orthonormalize the columns of a in place, by modified Gram-Schmidt
+// with one step of reorthogonalization.  Columns that are linearly
+// dependent on earlier columns are set to zero.
+void orthonormalize_columns(Matrix& a);
+
+// Eigen decomposition of the symmetric matrix a by cyclic Jacobi
+// rotations.  Eigenvalues are sorted in descending order and the
+// columns of vectors are the corresponding eigenvectors.  a is
+// overwritten.
+void symmetric_eigen(Matrix& a, std::vector<double>& values, Matrix& vectors);
+
+
+class RandomizedEigen
+{
+public:
+    RandomizedEigen()=delete;
+    RandomizedEigen(size_t n_samples, size_t rank, size_t oversample,
+                    unsigned long seed);
+    RandomizedEigen(const RandomizedEigen&)=delete;
+    RandomizedEigen& operator=(const RandomizedEigen&)=delete;
+
+    // One pass over the markers computes Y = G Q
+    void start_pass();
+    void add_marker(const HaplotypeDataRecord&);
+    void end_pass();            // Q <- orth(Y)
+
+    // Rayleigh-Ritz step, using Y = G Q of the most recent pass
+    void finalize();
+
+    // passes over the markers for power_iters power iterations
+    static size_t n_passes(size_t power_iters);
+
+    size_t rank() const;
+    size_t sketch_size() const;
+    const std::vector<double>& eigenvalues() const;
+    const Matrix& eigenvectors() const;         // n_samples by rank
+
+private:
+    const size_t n_samples_;
+    const size_t rank_;
+    const size_t sketch_size_;
+    size_t k_founders_ { 0 };
+
+    Matrix q_;                  // n_samples by sketch_size
+    Matrix y_;                  // n_samples by sketch_size
+    std::unique_ptr<double[]> w_ { nullptr };   // k_founders by sketch_size
+
+    std::vector<double> values_;
+    std::unique_ptr<Matrix> vectors_ { nullptr };
+};
+
+#endif
@@ -0,0 +1,74 @@
+// Marker filters evaluated on the fixed VCF columns
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// A marker is accepted or rejected using only the first nine VCF
+// columns, so that sample columns of rejected markers need not be
+// read in to memory or parsed.
+//
+// Filters are applied in the order: FILTER == PASS, INFO_SCORE and
+// EAF thresholds, minimum spacing to the last accepted marker, and
+// finally keeping every Nth of the markers that remain.
+//
+#ifndef HEADER_MARKERFILTER_H
+#define HEADER_MARKERFILTER_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+
+const char INFO_SCORE_KEY[] { "INFO_SCORE" };
+const char EAF_KEY[] { "EAF" };
+const char PASS_VALUE[] { "PASS" };
+
+
+class MarkerFilter
+{
+public:
+    MarkerFilter();
+
+    void every_nth(size_t);
+    void min_spacing(long);
+    void require_pass(bool);
+    void min_info_score(double);
+    void eaf_range(double, double);
+
+    bool active() const;
+    bool sequential() const;    // depends on earlier markers, thinning or spacing
+    void restart();             // forget markers seen, keep settings
+
+    // fixed_columns points to the start of a data line, it must hold
+    // at least the first eight tab delimited columns
+    bool accept(const char* fixed_columns);
+
+    size_t n_accepted() const;
+    size_t n_rejected() const;
+
+    // Look up a numeric value of a ';' delimited INFO field, returns
+    // false if the key is absent
+    static bool info_value(const char* info, size_t len,
+                           const char* key, double& value);
+
+private:
+    size_t every_nth_ { 1 };
+    long min_spacing_ { 0 };
+    bool require_pass_ { false };
+    double min_info_score_ { 0 };
+    bool use_info_score_ { false };
+    double min_eaf_ { 0 };
+    double max_eaf_ { 1 };
+    bool use_eaf_ { false };
+
+    size_t n_accepted_ { 0 };
+    size_t n_rejected_ { 0 };
+    size_t n_candidates_ { 0 };       // markers passing all but thinning
+
+    std::string last_chrom_;
+    long last_pos_ { -1 };
+};
+
+#endif
@@ -24,6 +24,7 @@ class Matrix
 {
 public:
     Matrix(size_t, size_t);                         // constructorconstructor
+    Matrix(size_t, size_t, int fd, size_t offset);  // mapped from a file
     Matrix(const Matrix&);                          // copy constructor
     Matrix(Matrix&&);                               // move constructor
     Matrix& operator=(const Matrix&)=delete;        // copy assignment
@@ -36,11 +37,39 @@ public:
     size_t size() const;
     std::array<size_t,2> dims() const;
 
+    // row major storage of size() values
+    double* data();
+    const double* data() const;
+
+    // Matrices of at least 2 MB are mapped rather than taken from the
+    // heap.  The mapped pages are zero and placed on the NUMA node of
+    // the thread that first writes them, and are marked for transparent
+    // huge pages.  With use_huge_pages(true) reserved 2 MB huge pages
+    // are requested first, falling back when none are available.
+    static void use_huge_pages(bool);
+
+    // A matrix constructed from a file, open for reading and writing as
+    // fd, is the file's values from offset, shared with the file so
+    // writes go to the page cache and the kernel pages the matrix in
+    // and out.  sync writes the changed pages back to the file, it does
+    // nothing for matrices in memory.
+    void sync();
+
 private:
+    struct Storage
+    {
+        size_t mapped_bytes { 0 };      // 0 when allocated by new[]
+        size_t map_offset { 0 };        // bytes from the mapping to the data
+        bool file { false };
+        void operator()(double*) const;
+    };
+
     const size_t nrow_;
     const size_t mcol_;
-    std::unique_ptr<double[]> data_;
+    std::unique_ptr<double[], Storage> data_;
     size_t mat_idx_to_array_(const size_t&, const size_t&) const;
+
+    static std::unique_ptr<double[], Storage> allocate_(size_t);
 };
 
 #endif
@@ -0,0 +1,60 @@
+// Number of markers at which both samples of a pair were observed
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// Markers with no missing sample only increment a common count.  The
+// validity bits of markers with missing samples are transposed in to
+// one 64 bit word per sample, bit b set when the sample was observed
+// at the b-th such marker, and every 64 markers the count of each pair
+// is increased by popcount(w_i & w_j).  The cost is O(n) per marker
+// with missing samples plus O(n^2 / 64) per 64 of them.
+//
+#ifndef HEADER_PAIRCOUNTS_H
+#define HEADER_PAIRCOUNTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include "Matrix.h"
+#include "HaplotypeVcfParser.h"
+
+
+class PairCounts
+{
+public:
+    PairCounts(size_t n_samples);
+
+    void add_marker(const HaplotypeDataRecord&);
+
+    // add the counts of markers seen by another instance
+    void merge(const PairCounts&);
+
+    size_t n_samples() const;
+    size_t n_markers() const;
+    size_t n_missing() const;           // missing sample entries
+
+    // markers at which samples i and j were both observed
+    size_t operator()(size_t i, size_t j) const;
+
+    // divide the upper triangle of covariance by the pair counts,
+    // entries of pairs never observed together become NaN
+    void normalize(Matrix& covariance) const;
+
+private:
+    const size_t n_samples_;
+
+    size_t m_markers_ { 0 };
+    size_t n_missing_ { 0 };
+    size_t complete_ { 0 };             // markers without missing samples
+
+    // markers with missing samples, in batches of 64
+    std::vector<uint64_t> batch_;
+    size_t batch_size_ { 0 };
+    std::vector<uint32_t> partial_;     // upper triangle, counts of flushed batches
+
+    void flush_batch_();
+};
+
+#endif
@@ -0,0 +1,81 @@
+// Founder pair state encoding of the haplotype dosages of a marker
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// A diploid sample carries two founder haplotypes, so its dosage
+// vector is nearly e_a + e_b for one of the K (K+1) / 2 founder pairs
+// a <= b.  A sample whose dosages are each within tolerance of the
+// nearest pair state is coded by that state, otherwise its dosages
+// are kept exactly.
+//
+// The dot product of the states (a, b) and (c, d) is
+//
+//      [a == c] + [a == d] + [b == c] + [b == d]
+//
+// which is tabulated once, so the GRM update of two coded samples is
+// a lookup on their codes.  The dot product of a coded sample with an
+// exact one is x_a + x_b.
+//
+#ifndef HEADER_PAIRSTATES_H
+#define HEADER_PAIRSTATES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include "HaplotypeVcfParser.h"
+
+
+typedef uint16_t PairCode;
+
+// code of a sample whose dosages are kept exactly
+const PairCode EXACT_STATE { 0xFFFF };
+
+
+class PairStates
+{
+public:
+    PairStates(size_t n_samples, size_t k_founders, double tolerance);
+
+    void assign(const HaplotypeDataRecord&);
+
+    size_t n_samples() const;
+    size_t k_founders() const;
+    size_t n_states() const;
+    double tolerance() const;
+
+    size_t n_exact() const;             // samples not coded by a state
+
+    const PairCode* codes() const;
+
+    // founders of a state
+    size_t state_a(PairCode) const;
+    size_t state_b(PairCode) const;
+    PairCode state(size_t a, size_t b) const;
+
+    // n_states by n_states table of state dot products
+    const uint8_t* table() const;
+
+    // dosages of sample i, only for samples with code EXACT_STATE
+    const double* exact(size_t i) const;
+
+private:
+    const size_t n_samples_;
+    const size_t k_founders_;
+    const size_t n_states_;
+    const double tolerance_;
+
+    std::vector<size_t> state_a_;
+    std::vector<size_t> state_b_;
+    std::vector<PairCode> state_index_;     // k_founders by k_founders
+    std::vector<uint8_t> table_;
+
+    std::vector<PairCode> codes_;
+    std::vector<size_t> exact_offset_;
+    std::vector<double> exact_values_;
+
+    PairCode nearest_state_(const double* x) const;
+};
+
+#endif
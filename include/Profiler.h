@@ -0,0 +1,150 @@
+// Run time instrumentation of the hgrm phases
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// Each thread records in to its own PhaseCounters, so timing adds no
+// synchronization to the hot loops.  The cost of a timed phase is two
+// reads of the steady clock.  A null PhaseCounters pointer disables
+// timing altogether.
+//
+// Phases
+//      read        reading lines from the input
+//      tokenize    locating the fixed VCF columns and FORMAT
+//      parse       splitting sample columns and converting numbers
+//      accumulate  updating the GRM, or sketch, from a marker
+//      write       writing results
+//
+#ifndef HEADER_PROFILER_H
+#define HEADER_PROFILER_H
+
+#include <cstddef>
+#include <atomic>
+#include <cstdio>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <utility>
+
+
+enum class Phase { read, tokenize, parse, accumulate, write };
+
+const size_t N_PHASES { 5 };
+const char* phase_name(Phase);
+
+
+struct PhaseStats
+{
+    double seconds { 0 };
+    size_t bytes { 0 };
+    size_t markers { 0 };
+    size_t calls { 0 };
+};
+
+
+class PhaseCounters
+{
+public:
+    PhaseCounters(const std::string& name);
+
+    void add(Phase, std::chrono::steady_clock::duration,
+             size_t bytes=0, size_t markers=0);
+
+    const PhaseStats& stats(Phase) const;
+    const std::string& name() const;
+
+    void start();               // mark the start of the thread's work
+    void stop();                // record wall and CPU time of the thread
+    double wall_seconds() const;
+    double cpu_seconds() const;
+
+private:
+    std::string name_;
+    PhaseStats stats_[N_PHASES];
+
+    std::chrono::steady_clock::time_point wall_start_;
+    double cpu_start_ { 0 };
+    double wall_seconds_ { 0 };
+    double cpu_seconds_ { 0 };
+};
+
+
+// Times the enclosing scope when counters is not null
+class ScopedPhase
+{
+public:
+    ScopedPhase(PhaseCounters* counters, Phase phase);
+    ScopedPhase(const ScopedPhase&)=delete;
+    ScopedPhase& operator=(const ScopedPhase&)=delete;
+    ~ScopedPhase();
+
+    void add_bytes(size_t);
+    void add_markers(size_t);
+
+private:
+    PhaseCounters* counters_;
+    Phase phase_;
+    size_t bytes_ { 0 };
+    size_t markers_ { 0 };
+    std::chrono::steady_clock::time_point start_;
+};
+
+
+class Profiler
+{
+public:
+    Profiler();
+    Profiler(const Profiler&)=delete;
+    Profiler& operator=(const Profiler&)=delete;
+
+    // thread safe, the returned counters belong to the calling thread
+    // and live as long as the profiler
+    PhaseCounters* register_thread(const std::string& name);
+
+    PhaseStats total(Phase) const;
+    double wall_seconds() const;
+
+    // Machine readable run metrics.  extra holds additional name and
+    // value pairs, values are written verbatim so strings must be quoted.
+    void write_json(const char* filename,
+                    const std::vector<std::pair<std::string, std::string>>& extra) const;
+
+    static long peak_rss_kb();
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<PhaseCounters>> threads_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+
+// Progress with an estimated time remaining from the fraction of the
+// input read, written to standard error each time the number of
+// markers passes a multiple of marker_interval.  Thread safe.
+class ProgressReporter
+{
+public:
+    ProgressReporter(size_t total_bytes, size_t marker_interval);
+
+    void update(size_t m_markers, size_t bytes_done);
+
+    // add to running totals kept by the reporter, for threads that
+    // share one report
+    void add(size_t markers, size_t bytes);
+
+private:
+    const size_t total_bytes_;
+    const size_t marker_interval_;
+    std::atomic<size_t> markers_done_ { 0 };
+    std::atomic<size_t> bytes_done_ { 0 };
+    std::atomic<size_t> next_report_;
+    std::mutex mutex_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+
+double thread_cpu_seconds();
+
+#endif
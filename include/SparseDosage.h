@@ -0,0 +1,70 @@
+// Sparse representation of the haplotype dosages of a marker
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// The dosage vector of a sample is nearly one or two hot, e.g.
+// 0.001,0,0,0.989,0.005,0.005,1,0 has two meaningful entries of 8.
+// Dosages with absolute value at most epsilon are dropped, an epsilon
+// of 0 keeps every nonzero value and so is exact.
+//
+// The retained values are held twice, in compressed sparse column and
+// row form:
+//
+//      by founder  for each founder k, the samples with a retained
+//                  dosage of k in increasing order, with their values
+//      by sample   for each sample i, the founders of its retained
+//                  dosages, with their values
+//
+#ifndef HEADER_SPARSEDOSAGE_H
+#define HEADER_SPARSEDOSAGE_H
+
+#include <cstddef>
+#include <vector>
+#include <stdexcept>
+#include "HaplotypeVcfParser.h"
+
+
+class SparseDosage
+{
+public:
+    SparseDosage(size_t n_samples, size_t k_founders, double epsilon=0);
+
+    void assign(const HaplotypeDataRecord&);
+
+    size_t n_samples() const;
+    size_t k_founders() const;
+    double epsilon() const;
+
+    size_t n_nonzero() const;
+    double density() const;             // n_nonzero / (n_samples k_founders)
+
+    // entries [founder_start(k), founder_start(k+1)) of founder_samples
+    // and founder_values belong to founder k
+    const size_t* founder_start() const;
+    const size_t* founder_samples() const;
+    const double* founder_values() const;
+
+    // entries [sample_start(i), sample_start(i+1)) of sample_founders
+    // and sample_values belong to sample i
+    const size_t* sample_start() const;
+    const size_t* sample_founders() const;
+    const double* sample_values() const;
+
+private:
+    const size_t n_samples_;
+    const size_t k_founders_;
+    const double epsilon_;
+
+    std::vector<size_t> founder_start_;
+    std::vector<size_t> founder_samples_;
+    std::vector<double> founder_values_;
+
+    std::vector<size_t> sample_start_;
+    std::vector<size_t> sample_founders_;
+    std::vector<double> sample_values_;
+
+    std::vector<size_t> fill_;          // per founder insert position
+};
+
+#endif
@@ -0,0 +1,106 @@
+// Sequential file reads kept in flight with io_uring
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// The file is read in aligned blocks of block_size bytes, with up to
+// queue_depth blocks requested ahead of the one being consumed, so the
+// device is kept busy while the parser works.  With direct the file is
+// opened with O_DIRECT, bypassing the page cache; file systems that do
+// not support it are read through the cache.
+//
+// The ring is set up with the io_uring system calls directly, so no
+// library is needed.  Construction throws std::runtime_error when the
+// kernel does not provide io_uring or its read operation, callers then
+// use ordinary reads, see BufferedRead::use_uring.
+//
+#ifndef HEADER_URINGREADER_H
+#define HEADER_URINGREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+struct UringOptions
+{
+    size_t queue_depth { 8 };
+    size_t block_size { size_t { 1 } << 20 };      // multiple of 4096
+    bool direct { false };
+};
+
+
+class UringReader
+{
+public:
+    UringReader(const char* filename, const UringOptions& options=UringOptions {});
+    UringReader(const UringReader&)=delete;
+    UringReader& operator=(const UringReader&)=delete;
+    ~UringReader();
+
+    // whether a ring can be set up, checked once
+    static bool available();
+
+    // continue reading from offset, reads in flight are discarded.
+    // Blocks past readahead_end are only requested when they are read.
+    void seek(size_t offset, size_t readahead_end=SIZE_MAX);
+
+    // copy up to n bytes, from the current offset, in to dst, returns
+    // the number copied, 0 at the end of the file
+    size_t read(char* dst, size_t n);
+
+    size_t file_size() const;
+    bool direct() const;
+
+private:
+    struct Block
+    {
+        char* data { nullptr };
+        size_t number { SIZE_MAX };     // block of the file held or requested
+        size_t offset { 0 };
+        size_t length { 0 };        // bytes read
+        bool in_flight { false };
+    };
+
+    const UringOptions options_;
+    int file_ { -1 };
+    bool direct_ { false };
+    size_t file_size_ { 0 };
+
+    int ring_ { -1 };
+    void* sq_ring_ { nullptr };
+    void* cq_ring_ { nullptr };
+    void* sqes_ { nullptr };
+    size_t sq_ring_bytes_ { 0 };
+    size_t cq_ring_bytes_ { 0 };
+    size_t sqes_bytes_ { 0 };
+
+    // ring fields, in the mapped memory
+    unsigned* sq_head_ { nullptr };
+    unsigned* sq_tail_ { nullptr };
+    unsigned* sq_mask_ { nullptr };
+    unsigned* sq_array_ { nullptr };
+    unsigned* cq_head_ { nullptr };
+    unsigned* cq_tail_ { nullptr };
+    unsigned* cq_mask_ { nullptr };
+    void* cqes_ { nullptr };
+
+    std::vector<Block> blocks_;
+    std::unique_ptr<char, void(*)(void*)> memory_ { nullptr, nullptr };
+
+    size_t readahead_end_ { SIZE_MAX };
+    size_t next_block_ { 0 };           // next block number to request
+    size_t current_block_ { 0 };        // block number being consumed
+    size_t block_pos_ { 0 };            // position in the current block
+    size_t n_in_flight_ { 0 };
+
+    void setup_ring_();
+    void close_();
+    void submit_(Block&, size_t block_number);
+    void request_ahead_();
+    void wait_();
+    void complete_(Block&, long result);
+};
+
+#endif
@@ -0,0 +1,86 @@
+// Simulated STITCH style haplotype dosage VCFs
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// Each sample carries two haplotypes, each a mosaic of the K founder
+// haplotypes.  Along a haplotype the founder changes at recombination
+// breakpoints, with block lengths geometrically distributed with mean
+// block_length markers.  Within a block the haplotype dosages (HD) of a
+// sample are constant: the expected founder counts shrunk by a factor
+// (1 - noise) toward a random composition, so that each HD vector sums
+// to two as in STITCH output.  Founders carry random alleles per
+// marker, from which the dosage (DS), genotype probabilities (GP) and
+// genotype (GT) are derived.
+//
+// The output is written by formatting directly in to a large buffer,
+// and the HD text of a sample is reused until its block changes, so
+// files of 100+ GB are produced at close to disk speed.
+//
+#ifndef HEADER_VCFSIMULATOR_H
+#define HEADER_VCFSIMULATOR_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <random>
+#include <stdexcept>
+
+
+struct SimulationParams
+{
+    size_t n_samples { 100 };
+    size_t k_founders { 8 };
+    size_t n_markers { 1000 };
+    double block_length { 500 };        // mean markers between breakpoints
+    double noise { 0.01 };              // HD mass not on the true founders
+    long spacing { 100 };               // mean bp between markers
+    std::string chrom { "chr1" };
+    unsigned long seed { 1 };
+};
+
+
+class VcfSimulator
+{
+public:
+    VcfSimulator()=delete;
+    VcfSimulator(const SimulationParams&);
+    VcfSimulator(const VcfSimulator&)=delete;
+    VcfSimulator& operator=(const VcfSimulator&)=delete;
+
+    void write(FILE* fout);
+    size_t bytes_written() const;
+
+private:
+    const SimulationParams params_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> unif_ { 0, 1 };
+    std::geometric_distribution<size_t> block_;
+
+    std::vector<size_t> founder_;       // founder of each of 2 n haplotypes
+    std::vector<size_t> next_break_;    // marker of next breakpoint
+    std::vector<double> hd_;            // n_samples by k_founders
+    std::vector<std::string> hd_text_;  // formatted HD of each sample
+    std::vector<double> ds_;            // dosage of each sample
+    std::vector<char> alleles_;         // allele of each founder
+
+    std::vector<char> out_;
+    size_t out_pos_ { 0 };
+    size_t bytes_written_ { 0 };
+    FILE* fout_ { nullptr };
+
+    void new_block_(size_t sample);
+    void write_header_();
+    void write_marker_(size_t marker, long pos);
+
+    void put_(char);
+    void put_(const char*, size_t);
+    void put_(const std::string&);
+    void flush_();
+};
+
+
+void write_simulated_vcf(const char* filename, const SimulationParams&);
+
+#endif
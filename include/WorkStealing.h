@@ -0,0 +1,105 @@
+// Work stealing over chunks of VCF files
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// The records of each input file are split in to byte ranges, which
+// HaplotypeVcfParser::set_range aligns to lines.  Each worker starts
+// with a contiguous block of the chunks, so it reads its files
+// sequentially, and takes chunks from the front of its own queue.  A
+// worker whose queue is empty steals from the back of the longest
+// remaining queue, so files of uneven size do not leave threads idle.
+//
+#ifndef HEADER_WORKSTEALING_H
+#define HEADER_WORKSTEALING_H
+
+#include <cstddef>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <pthread.h>
+
+
+struct VcfChunk
+{
+    size_t file { 0 };
+    size_t begin { 0 };
+    size_t end { 0 };
+};
+
+
+// Split the records of each file, from its data offset to its size, in
+// to chunks of about chunk_bytes.  A chunk_bytes of 0 keeps each file
+// whole.
+std::vector<VcfChunk> split_vcf_chunks(const std::vector<size_t>& data_offsets,
+                                       const std::vector<size_t>& file_sizes,
+                                       size_t chunk_bytes);
+
+
+class WorkStealingScheduler
+{
+public:
+    WorkStealingScheduler(size_t n_workers, size_t n_tasks);
+    WorkStealingScheduler(const WorkStealingScheduler&)=delete;
+    WorkStealingScheduler& operator=(const WorkStealingScheduler&)=delete;
+
+    // the next task of worker, false when no task remains
+    bool next(size_t worker, size_t& task);
+
+    size_t n_workers() const;
+    size_t n_steals() const;
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::atomic<size_t> n_steals_ { 0 };
+
+    bool steal_(size_t worker, size_t& task);
+};
+
+
+// Threads calling wait are held until all n_threads have arrived, the
+// barrier may be reused.  A worker that fails calls abort, after which
+// wait returns false in every thread so the workers stop together.
+class Barrier
+{
+public:
+    explicit Barrier(size_t n_threads);
+    Barrier(const Barrier&)=delete;
+    Barrier& operator=(const Barrier&)=delete;
+    ~Barrier();
+
+    bool wait();
+    void abort();
+
+private:
+    // pthreads rather than std::condition_variable, whose wait needs a
+    // newer libstdc++ at run time than the rest of the program
+    const size_t n_threads_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t arrived_;
+    size_t n_waiting_ { 0 };
+    size_t generation_ { 0 };
+    bool aborted_ { false };
+};
+
+
+// Pin the calling thread to the index-th CPU, modulo their number, of
+// those the process may run on.  Returns false when affinity is not
+// supported or could not be set.
+bool pin_thread(size_t index);
+
+
+// Run worker(0), ..., worker(n_threads - 1) on their own threads and
+// wait for them.  The first exception thrown by a worker is rethrown.
+void run_workers(size_t n_threads, const std::function<void(size_t)>& worker);
+
+#endif
@@ -3,6 +3,7 @@
 
 
 #include <cstdlib>
+#include <cstdint>
 #include <cctype>
 #include <cstdio>
 #include <cstring>
@@ -10,6 +11,8 @@
 #include <functional>
 #include <memory>
 #include <stdexcept>
+#include <vector>
+#include "UringReader.h"
 
 
 
@@ -55,6 +58,7 @@ public:
     void reset();
     size_t size();
     bool next_field();
+    bool skip_field();      // advance past a field without copying it
 
 
 private:
@@ -81,22 +85,53 @@ public:
     ~BufferedRead();
 
     size_t get_line(CharBuffer& line_buf);
+    // read the first n_fields delimited fields of a line, stopping
+    // short of the newline so the line can be completed or skipped
+    size_t get_fields(CharBuffer& line_buf, char delim, size_t n_fields);
+    size_t append_line(CharBuffer& line_buf);
+    size_t skip_line();
     // size_t get_line(std::unique_ptr<char[]> line_buf);
     char get_char();
     void seek(size_t n);
     size_t tell();
     void reset();
 
+    size_t offset() const;          // file position of the next character
+    size_t file_size() const;
+
+    // read through io_uring, see UringReader, from the current offset
+    // on; false, keeping ordinary reads, when it is not available
+    bool use_uring(const UringOptions&);
+    bool uses_uring() const;
+
+    // io_uring reads ahead of the position only up to end, e.g. the
+    // end of a range of records, until seek is called with another end
+    void seek(size_t n, size_t readahead_end);
+
 private:
     const char* filename_;
     const size_t buff_size_;
 
     FILE* fid_;
     std::unique_ptr<char[]> buffer_;
+    std::unique_ptr<UringReader> uring_ { nullptr };
+    size_t readahead_end_ { SIZE_MAX };
 
     size_t buffer_pos_ { 0 };
+    size_t buffer_len_ { 0 };           // valid characters in buffer_
+    size_t buffer_start_ { 0 };         // file position of buffer_[0]
 
     size_t update_buffer_();
 
 };
+
+
+// Read sample identifiers, one per line.  Lines with two white space
+// separated columns (PLINK style FID IID) use the second column.
+std::vector<std::string> read_sample_ids(const char* filename);
+
+// Read the lines of a file, e.g. a list of file names, skipping blank
+// lines and surrounding white space
+std::vector<std::string> read_lines(const char* filename);
+
 #endif
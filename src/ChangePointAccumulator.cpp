@@ -0,0 +1,128 @@
+// GRM accumulation from the change points of each sample
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "ChangePointAccumulator.h"
+
+
+ChangePointAccumulator::ChangePointAccumulator(size_t n_samples, size_t k_founders,
+                                               double tolerance)
+    : n_samples_(n_samples), k_founders_(k_founders), tolerance_(tolerance),
+        rows_(n_samples * k_founders, 0), products_(n_samples, n_samples),
+        valid_from_(n_samples * n_samples, 0), is_changed_(n_samples, false) {
+
+    if (tolerance < 0)
+        throw std::runtime_error("Change point tolerance must not be negative");
+
+    changed_.reserve(n_samples);
+};
+
+
+bool ChangePointAccumulator::differs_(const double* row, const double* current) const {
+    for (size_t k = 0; k < k_founders_; k++)
+        if (std::fabs(row[k] - current[k]) > tolerance_)
+            return true;
+    return false;
+}
+
+
+void ChangePointAccumulator::flush_pair_(size_t a, size_t b, Matrix& covariance,
+                                         double weight) {
+    uint32_t& from { valid_from_[a * n_samples_ + b] };
+    covariance(a, b) += weight * products_(a, b) * (m_markers_ - from);
+    from = m_markers_;
+}
+
+
+void ChangePointAccumulator::add_marker(const HaplotypeDataRecord& record,
+                                        Matrix& covariance, double weight) {
+
+    if (record.dims()[0] != n_samples_ || record.dims()[1] != k_founders_)
+        throw std::runtime_error("Change point accumulator and record dimensions differ");
+
+    if (record.layout() != RecordLayout::sample_major)
+        throw std::runtime_error("Change point accumulator requires sample major records");
+
+    if (covariance.dims()[0] != n_samples_ || covariance.dims()[1] != n_samples_)
+        throw std::runtime_error("Covariance and record dimensions differ");
+
+    if (m_markers_ >= std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Too many markers for the change point accumulator");
+
+    changed_.clear();
+
+    const double* row { nullptr };
+    double* current { nullptr };
+
+    for (size_t i = 0; i < n_samples_; i++) {
+
+        row = &record(i, 0);
+        current = &rows_[i * k_founders_];
+
+        // every sample starts at the first marker
+        if (m_markers_ > 0 && !differs_(row, current))
+            continue;
+
+        std::copy(row, row + k_founders_, current);
+        changed_.push_back(i);
+        is_changed_[i] = true;
+    }
+
+    n_changes_ += changed_.size();
+
+    size_t a { 0 };
+    size_t b { 0 };
+    double sum { 0 };
+    const double* xi { nullptr };
+    const double* xj { nullptr };
+
+    for (size_t i : changed_) {
+
+        xi = &rows_[i * k_founders_];
+
+        for (size_t j = 0; j < n_samples_; j++) {
+
+            // pairs of two changed samples are done once
+            if (is_changed_[j] && j < i)
+                continue;
+
+            a = std::min(i, j);
+            b = std::max(i, j);
+
+            flush_pair_(a, b, covariance, weight);
+
+            xj = &rows_[j * k_founders_];
+            sum = 0;
+
+            for (size_t k = 0; k < k_founders_; k++)
+                sum += xi[k] * xj[k];
+
+            products_(a, b) = sum;
+        }
+    }
+
+    for (size_t i : changed_)
+        is_changed_[i] = false;
+
+    m_markers_++;
+}
+
+
+void ChangePointAccumulator::flush(Matrix& covariance, double weight) {
+
+    if (covariance.dims()[0] != n_samples_ || covariance.dims()[1] != n_samples_)
+        throw std::runtime_error("Covariance and record dimensions differ");
+
+    for (size_t a = 0; a < n_samples_; a++)
+        for (size_t b = a; b < n_samples_; b++)
+            flush_pair_(a, b, covariance, weight);
+}
+
+
+size_t ChangePointAccumulator::n_markers() const { return m_markers_; }
+size_t ChangePointAccumulator::n_changes() const { return n_changes_; }
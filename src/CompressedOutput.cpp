@@ -0,0 +1,202 @@
+// Compressed text output formatted and compressed by several threads
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+#ifdef HGRM_HAS_ZSTD
+#include <zstd.h>
+#endif
+#include "CompressedOutput.h"
+#include "WorkStealing.h"
+
+
+namespace {
+
+// as htslib, so blocks of incompressible data still fit
+const size_t BGZF_MAX_INPUT { 0xff00 };
+const size_t BGZF_MAX_BLOCK { 65536 };
+const size_t BGZF_HEADER { 18 };
+const size_t BGZF_FOOTER { 8 };
+
+const unsigned char BGZF_EOF[28] {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+const int ZSTD_LEVEL { 3 };
+
+// chunks of each worker per round, bounding the text held in memory
+const size_t CHUNKS_PER_THREAD { 4 };
+
+
+void put_le(unsigned char* p, uint32_t value, size_t n_bytes) {
+    for (size_t b = 0; b < n_bytes; b++)
+        p[b] = (value >> (8 * b)) & 0xff;
+}
+
+
+// one BGZF block of n bytes, false when it does not compress in to one
+bool bgzf_block(const char* data, size_t n, std::string& out) {
+
+    unsigned char block[BGZF_MAX_BLOCK];
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    // raw deflate, the gzip header and footer are written here
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        throw std::runtime_error("Unable to initialize gzip compression");
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = n;
+    stream.next_out = block + BGZF_HEADER;
+    stream.avail_out = BGZF_MAX_BLOCK - BGZF_HEADER - BGZF_FOOTER;
+
+    const int status { deflate(&stream, Z_FINISH) };
+    const size_t compressed { stream.total_out };
+    deflateEnd(&stream);
+
+    if (status != Z_STREAM_END)
+        return false;
+
+    const size_t block_size { BGZF_HEADER + compressed + BGZF_FOOTER };
+
+    // gzip header with the BC extra field holding the block size - 1
+    const unsigned char header[BGZF_HEADER] {
+        0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+        0x06, 0x00, 0x42, 0x43, 0x02, 0x00, 0x00, 0x00
+    };
+    std::memcpy(block, header, BGZF_HEADER);
+    put_le(block + 16, block_size - 1, 2);
+
+    const uLong crc { crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), n) };
+    put_le(block + BGZF_HEADER + compressed, crc, 4);
+    put_le(block + BGZF_HEADER + compressed + 4, n, 4);
+
+    out.append(reinterpret_cast<const char*>(block), block_size);
+    return true;
+}
+
+
+void compress_bgzf(const char* data, size_t n, std::string& out) {
+
+    size_t size { 0 };
+
+    for (size_t pos = 0; pos < n; pos += size) {
+        size = std::min(BGZF_MAX_INPUT, n - pos);
+
+        while (!bgzf_block(data + pos, size, out))
+            size /= 2;
+    }
+}
+
+
+void compress_zstd(const char* data, size_t n, std::string& out) {
+#ifdef HGRM_HAS_ZSTD
+    const size_t start { out.size() };
+    const size_t bound { ZSTD_compressBound(n) };
+    out.resize(start + bound);
+
+    const size_t size { ZSTD_compress(&out[start], bound, data, n, ZSTD_LEVEL) };
+
+    if (ZSTD_isError(size))
+        throw std::runtime_error(std::string("zstd compression failed: ")
+                                 + ZSTD_getErrorName(size));
+
+    out.resize(start + size);
+#else
+    (void) data;
+    (void) n;
+    (void) out;
+    throw std::runtime_error("hgrm was built without zstd");
+#endif
+}
+
+}
+
+
+Compression parse_compression(const char* name) {
+    if (strcmp(name, "none") == 0)
+        return Compression::none;
+    if (strcmp(name, "gzip") == 0)
+        return Compression::gzip;
+    if (strcmp(name, "zstd") == 0)
+        return Compression::zstd;
+
+    throw std::runtime_error("Compression must be none, gzip or zstd");
+}
+
+
+bool compression_available(Compression compression) {
+#ifdef HGRM_HAS_ZSTD
+    (void) compression;
+    return true;
+#else
+    return compression != Compression::zstd;
+#endif
+}
+
+
+void compress_blocks(Compression compression, const char* data, size_t n,
+                     std::string& out) {
+    if (compression == Compression::gzip)
+        compress_bgzf(data, n, out);
+    else if (compression == Compression::zstd)
+        compress_zstd(data, n, out);
+    else
+        out.append(data, n);
+}
+
+
+size_t write_compressed_chunks(FILE* fout, Compression compression, size_t n_chunks,
+                               const std::function<void(size_t, std::string&)>& format,
+                               size_t n_threads) {
+
+    if (!compression_available(compression))
+        throw std::runtime_error("hgrm was built without zstd");
+
+    n_threads = std::max(n_threads, size_t { 1 });
+
+    const size_t round_size { n_threads * CHUNKS_PER_THREAD };
+    std::vector<std::string> text(round_size);
+    std::vector<std::string> compressed(round_size);
+    size_t n_bytes { 0 };
+
+    // the chunks of a round are written in order once all are compressed
+    for (size_t first = 0; first < n_chunks; first += round_size) {
+        const size_t n_round { std::min(round_size, n_chunks - first) };
+        std::atomic<size_t> next { 0 };
+
+        run_workers(std::min(n_threads, n_round), [&](size_t) {
+            for (size_t s = next++; s < n_round; s = next++) {
+                format(first + s, text[s]);
+                compressed[s].clear();
+                compress_blocks(compression, text[s].data(), text[s].size(), compressed[s]);
+            }
+        });
+
+        for (size_t s = 0; s < n_round; s++) {
+            std::fwrite(compressed[s].data(), 1, compressed[s].size(), fout);
+            n_bytes += compressed[s].size();
+        }
+    }
+
+    if (compression == Compression::gzip) {
+        std::fwrite(BGZF_EOF, 1, sizeof(BGZF_EOF), fout);
+        n_bytes += sizeof(BGZF_EOF);
+    }
+
+    if (std::ferror(fout))
+        throw std::runtime_error("Error writing compressed output");
+
+    return n_bytes;
+}
@@ -0,0 +1,83 @@
+// Haplotype dosages of consecutive markers held founder major
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <algorithm>
+#include "DosagePanel.h"
+
+
+DosagePanel::DosagePanel(size_t n_samples, size_t k_founders, size_t capacity)
+    : n_samples_(n_samples), k_founders_(k_founders), capacity_(capacity),
+    stride_((n_samples + 7) / 8 * 8) {
+
+    if (n_samples_ == 0 || k_founders_ == 0 || capacity_ == 0)
+        throw std::runtime_error("Panel must have more than zero samples, founders and markers");
+
+    const size_t n_values { capacity_ * k_founders_ * stride_ };
+
+    data_.reset(static_cast<double*>(std::aligned_alloc(64, n_values * sizeof(double))));
+
+    if (!data_)
+        throw std::bad_alloc();
+
+    // the padding is never written after
+    std::fill(data_.get(), data_.get() + n_values, 0);
+}
+
+
+double* DosagePanel::next_marker() {
+    if (full())
+        throw std::runtime_error("Dosage panel is full");
+
+    return data_.get() + n_markers_ * k_founders_ * stride_;
+}
+
+
+void DosagePanel::commit() {
+    if (full())
+        throw std::runtime_error("Dosage panel is full");
+
+    n_markers_++;
+}
+
+
+void DosagePanel::append(const HaplotypeDataRecord& record) {
+
+    if (record.dims()[0] != n_samples_ || record.dims()[1] != k_founders_)
+        throw std::runtime_error("Panel and record dimensions differ");
+
+    double* marker { next_marker() };
+
+    if (record.layout() == RecordLayout::founder_major) {
+        for (size_t k = 0; k < k_founders_; k++)
+            std::copy(record.founder_data(k), record.founder_data(k) + n_samples_,
+                      marker + k * stride_);
+    } else {
+        for (size_t i = 0; i < n_samples_; i++)
+            for (size_t k = 0; k < k_founders_; k++)
+                marker[k * stride_ + i] = record(i, k);
+    }
+
+    n_markers_++;
+}
+
+
+void DosagePanel::clear() { n_markers_ = 0; }
+bool DosagePanel::full() const { return n_markers_ == capacity_; }
+
+size_t DosagePanel::n_samples() const { return n_samples_; }
+size_t DosagePanel::k_founders() const { return k_founders_; }
+size_t DosagePanel::capacity() const { return capacity_; }
+size_t DosagePanel::n_markers() const { return n_markers_; }
+size_t DosagePanel::n_columns() const { return n_markers_ * k_founders_; }
+size_t DosagePanel::stride() const { return stride_; }
+
+
+const double* DosagePanel::column(size_t c) const {
+    if (c >= n_columns())
+        throw std::out_of_range("Index is out of matrix range.");
+
+    return data_.get() + c * stride_;
+}
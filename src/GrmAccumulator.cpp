@@ -0,0 +1,349 @@
+// Streaming accumulation of the GRM for embedding in other programs
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <stdexcept>
+#include "GrmAccumulator.h"
+#include "GrmKernels.h"
+
+
+MarkerKernel::MarkerKernel(size_t n_samples, size_t k_founders,
+                           GrmKernel kernel, double tolerance)
+    : kind_(kernel) {
+
+    if (kernel == GrmKernel::sparse)
+        sparse_ = std::make_unique<SparseDosage>(n_samples, k_founders, tolerance);
+    else if (kernel == GrmKernel::pair_states)
+        pairs_ = std::make_unique<PairStates>(n_samples, k_founders, tolerance);
+    else if (kernel == GrmKernel::change_points)
+        change_points_ = std::make_unique<ChangePointAccumulator>(n_samples, k_founders,
+                                                                  tolerance);
+}
+
+
+void MarkerKernel::add_marker(const HaplotypeDataRecord& record, Matrix& covariance,
+                              double weight, const double* founder_weights) {
+    if (founder_weights != nullptr) {
+        if (pairs_ || change_points_)
+            throw std::runtime_error("Founder weights require the dense or sparse kernel");
+
+        if (sparse_) {
+            sparse_->assign(record);
+            accumulate_upper_weighted(*sparse_, covariance, founder_weights);
+        } else
+            accumulate_upper_weighted(record, covariance, founder_weights);
+    } else if (sparse_) {
+        sparse_->assign(record);
+        accumulate_upper(*sparse_, covariance, weight);
+    } else if (pairs_) {
+        pairs_->assign(record);
+        accumulate_upper(*pairs_, covariance, weight);
+    } else if (change_points_)
+        change_points_->add_marker(record, covariance, weight);
+    else
+        accumulate_upper(record, covariance, weight);
+}
+
+
+void MarkerKernel::add_rows(const HaplotypeDataRecord& record,
+                            const std::vector<size_t>& rows, Matrix& cross) {
+    if (sparse_) {
+        sparse_->assign(record);
+        accumulate_rows(*sparse_, rows, cross);
+    } else if (pairs_) {
+        pairs_->assign(record);
+        accumulate_rows(*pairs_, rows, cross);
+    } else
+        accumulate_rows(record, rows, cross);
+}
+
+
+void MarkerKernel::flush(Matrix& covariance, double weight) {
+    if (change_points_)
+        change_points_->flush(covariance, weight);
+}
+
+
+GrmKernel MarkerKernel::kind() const { return kind_; }
+
+const ChangePointAccumulator* MarkerKernel::change_points() const {
+    return change_points_.get();
+}
+
+
+GrmAccumulator::GrmAccumulator(size_t n_samples, size_t k_founders,
+                               const GrmOptions& options)
+    : GrmAccumulator(n_samples, k_founders, options,
+                     std::make_unique<Matrix>(n_samples, n_samples)) {}
+
+
+GrmAccumulator::GrmAccumulator(size_t n_samples, size_t k_founders,
+                               const GrmOptions& options,
+                               std::unique_ptr<Matrix> covariance)
+    : n_samples_(n_samples), k_founders_(k_founders), options_(options),
+    kernel_(n_samples, k_founders, options.kernel, options.tolerance),
+    normalizer_(n_samples, k_founders, options.normalize),
+    covariance_(std::move(covariance)) {
+
+    if (!covariance_ || covariance_->dims()[0] != n_samples
+            || covariance_->dims()[1] != n_samples)
+        throw std::runtime_error("GRM accumulator matrix must be n_samples by n_samples");
+
+    if (options.normalize == Normalization::standardize
+            && options.kernel != GrmKernel::dense && options.kernel != GrmKernel::sparse)
+        throw std::runtime_error("Standardized GRMs require the dense or sparse kernel");
+
+    if (options.pair_counts)
+        counts_ = std::make_unique<PairCounts>(n_samples);
+
+    if (options.panel_markers > 0) {
+        if (options.kernel != GrmKernel::dense
+                || options.normalize == Normalization::standardize)
+            throw std::runtime_error("Marker panels require the dense kernel without standardization");
+
+        panel_ = std::make_unique<DosagePanel>(n_samples, k_founders, options.panel_markers);
+    }
+}
+
+
+void GrmAccumulator::attach(HaplotypeDataRecord& record) {
+
+    if (!panel_)
+        return;
+
+    if (record.dims()[0] != n_samples_ || record.dims()[1] != k_founders_)
+        throw std::runtime_error("GRM accumulator and record dimensions differ");
+
+    if (record.layout() != RecordLayout::founder_major)
+        record.set_layout(RecordLayout::founder_major);
+
+    record.set_target(panel_->next_marker());
+}
+
+
+// A record attached to the panel holds the next marker of the panel,
+// other records are copied in to it
+void GrmAccumulator::add_to_panel_(HaplotypeDataRecord& record) {
+
+    const bool attached { record.target() == panel_->next_marker() };
+
+    if (attached)
+        panel_->commit();
+    else
+        panel_->append(record);
+
+    if (panel_->full())
+        flush_panel_();
+
+    if (attached)
+        record.set_target(panel_->next_marker());
+}
+
+
+void GrmAccumulator::flush_panel_() {
+    accumulate_upper(*panel_, *covariance_);
+    panel_->clear();
+}
+
+
+void GrmAccumulator::check_open_() const {
+    if (finalized_ || !covariance_)
+        throw std::runtime_error("GRM accumulator has been finalized or released");
+}
+
+
+void GrmAccumulator::add(HaplotypeDataRecord& record) {
+
+    add_marker_totals_(record);
+
+    if (panel_)
+        add_to_panel_(record);
+    else
+        kernel_.add_marker(record, *covariance_, 1, normalizer_.founder_weights());
+
+    // only change points and panels hold back contributions
+    flushed_ = kernel_.change_points() == nullptr
+                && (!panel_ || panel_->n_markers() == 0);
+}
+
+
+// counts, missing dosages and normalization of a marker, the kernel is
+// left to the caller
+void GrmAccumulator::add_marker_totals_(HaplotypeDataRecord& record) {
+
+    check_open_();
+
+    if (record.dims()[0] != n_samples_ || record.dims()[1] != k_founders_)
+        throw std::runtime_error("GRM accumulator and record dimensions differ");
+
+    n_missing_ += record.n_missing();
+
+    if (counts_)
+        counts_->add_marker(record);
+
+    if (options_.normalize != Normalization::none)
+        record.fill_missing_with_mean();
+
+    normalizer_.add_marker(record);
+    m_markers_++;
+}
+
+
+void GrmAccumulator::check_banded_() const {
+    if (options_.kernel != GrmKernel::dense || panel_)
+        throw std::runtime_error("Markers added by rows require the dense kernel without panels");
+}
+
+
+void GrmAccumulator::add_totals(HaplotypeDataRecord& record,
+                                std::vector<double>& founder_weights) {
+    check_banded_();
+    add_marker_totals_(record);
+
+    const double* weights { normalizer_.founder_weights() };
+
+    if (weights != nullptr)
+        founder_weights.assign(weights, weights + k_founders_);
+    else
+        founder_weights.clear();
+}
+
+
+void GrmAccumulator::add_rows(const HaplotypeDataRecord& record,
+                              const std::vector<double>& founder_weights,
+                              size_t row_begin, size_t row_end) {
+
+    check_open_();
+    check_banded_();
+
+    if (!founder_weights.empty())
+        accumulate_upper_weighted(record, *covariance_, founder_weights.data(),
+                                  row_begin, row_end);
+    else
+        accumulate_upper(record, *covariance_, row_begin, row_end);
+}
+
+
+void GrmAccumulator::add(const double* dosages, const uint64_t* valid) {
+
+    if (!record_)
+        record_ = std::make_unique<HaplotypeDataRecord>(n_samples_, k_founders_);
+
+    record_->assign(dosages, valid);
+    add(*record_);
+}
+
+
+void GrmAccumulator::flush() {
+
+    check_open_();
+
+    kernel_.flush(*covariance_);
+
+    if (panel_)
+        flush_panel_();
+
+    flushed_ = true;
+}
+
+
+void GrmAccumulator::check_merge_(const GrmAccumulator& other) const {
+
+    check_open_();
+
+    if (&other == this)
+        throw std::runtime_error("GRM accumulator can not be merged with itself");
+
+    if (other.n_samples_ != n_samples_ || other.k_founders_ != k_founders_
+            || other.options_.normalize != options_.normalize
+            || other.options_.pair_counts != options_.pair_counts)
+        throw std::runtime_error("GRM accumulators differ");
+
+    if (other.finalized_ || !other.covariance_)
+        throw std::runtime_error("Finalized or released GRM accumulators can not be merged");
+
+    if (!other.flushed_)
+        throw std::runtime_error("GRM accumulator must be flushed before it is merged");
+}
+
+
+void GrmAccumulator::merge(const GrmAccumulator& other) {
+    merge_rows(other, 0, n_samples_);
+    merge_totals(other);
+}
+
+
+void GrmAccumulator::merge_rows(const GrmAccumulator& other,
+                                size_t row_begin, size_t row_end) {
+
+    check_merge_(other);
+
+    if (row_begin > row_end || row_end > n_samples_)
+        throw std::out_of_range("Rows are out of matrix range");
+
+    double* row { nullptr };
+    const double* other_row { nullptr };
+
+    for (size_t i = row_begin; i < row_end; i++) {
+        row = covariance_->data() + i * n_samples_;
+        other_row = other.covariance_->data() + i * n_samples_;
+
+        for (size_t j = i; j < n_samples_; j++)
+            row[j] += other_row[j];
+    }
+}
+
+
+void GrmAccumulator::merge_totals(const GrmAccumulator& other) {
+
+    check_merge_(other);
+
+    normalizer_.merge(other.normalizer_);
+
+    if (counts_)
+        counts_->merge(*other.counts_);
+
+    m_markers_ += other.m_markers_;
+    n_missing_ += other.n_missing_;
+}
+
+
+void GrmAccumulator::finalize() {
+
+    if (finalized_)
+        return;
+
+    flush();
+    normalizer_.finalize(*covariance_, counts_.get());
+    finalized_ = true;
+}
+
+
+bool GrmAccumulator::finalized() const { return finalized_; }
+
+size_t GrmAccumulator::n_samples() const { return n_samples_; }
+size_t GrmAccumulator::k_founders() const { return k_founders_; }
+size_t GrmAccumulator::n_markers() const { return m_markers_; }
+size_t GrmAccumulator::n_missing() const { return n_missing_; }
+const GrmOptions& GrmAccumulator::options() const { return options_; }
+const MarkerKernel& GrmAccumulator::kernel() const { return kernel_; }
+
+
+const double* GrmAccumulator::data() const {
+    return covariance_ ? covariance_->data() : nullptr;
+}
+
+
+const Matrix& GrmAccumulator::matrix() const {
+    if (!covariance_)
+        throw std::runtime_error("GRM accumulator matrix has been released");
+
+    return *covariance_;
+}
+
+
+std::unique_ptr<Matrix> GrmAccumulator::release() {
+    return std::move(covariance_);
+}
@@ -0,0 +1,296 @@
+// Reading and writing genetic relationship matrices
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <unistd.h>
+#include "GrmIO.h"
+
+
+GrmBinaryHeader make_grm_header(const std::vector<std::string>& sample_ids,
+                                size_t n_markers) {
+
+    GrmBinaryHeader header;
+    std::memcpy(header.magic, GRM_MAGIC, sizeof(GRM_MAGIC));
+    header.version = GRM_VERSION;
+    header.n_samples = sample_ids.size();
+    header.n_markers = n_markers;
+    header.id_bytes = 0;
+
+    for (const std::string& id : sample_ids)
+        header.id_bytes += id.size() + 1;
+
+    uint64_t end_of_ids { sizeof(GrmBinaryHeader) + header.id_bytes };
+    header.data_offset = (end_of_ids + GRM_DATA_ALIGNMENT - 1)
+                            / GRM_DATA_ALIGNMENT * GRM_DATA_ALIGNMENT;
+
+    return header;
+}
+
+
+void write_grm_binary(const char* filename,
+                      const Matrix& covariance,
+                      const std::vector<std::string>& sample_ids,
+                      size_t n_markers) {
+
+    const size_t n { sample_ids.size() };
+
+    if (covariance.dims()[0] != n || covariance.dims()[1] != n)
+        throw std::runtime_error("Number of sample ids and matrix dimensions differ");
+
+    GrmBinaryHeader header { make_grm_header(sample_ids, n_markers) };
+
+    FILE* fout { std::fopen(filename, "wb") };
+
+    if (!fout)
+        throw std::runtime_error("Error in opening file for writing.");
+
+    std::fwrite(&header, sizeof(header), 1, fout);
+
+    for (const std::string& id : sample_ids)
+        std::fwrite(id.c_str(), 1, id.size() + 1, fout);
+
+    const char zero { '\0' };
+    for (uint64_t i = sizeof(header) + header.id_bytes; i < header.data_offset; i++)
+        std::fwrite(&zero, 1, 1, fout);
+
+    // write the symmetric matrix a row at a time
+    std::unique_ptr<double[]> row { std::make_unique<double[]>(n) };
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++)
+            row[j] = j < i ? covariance(j, i) : covariance(i, j);
+
+        std::fwrite(row.get(), sizeof(double), n, fout);
+    }
+
+    if (std::ferror(fout)) {
+        std::fclose(fout);
+        throw std::runtime_error("Error writing binary GRM");
+    }
+
+    std::fclose(fout);
+}
+
+
+GrmBinary read_grm_binary(const char* filename) {
+
+    FILE* fid { std::fopen(filename, "rb") };
+
+    if (!fid)
+        throw std::runtime_error("File Access error");
+
+    GrmBinaryHeader header;
+
+    if (std::fread(&header, sizeof(header), 1, fid) != 1
+            || std::memcmp(header.magic, GRM_MAGIC, sizeof(GRM_MAGIC)) != 0) {
+        std::fclose(fid);
+        throw std::runtime_error("File is not a binary GRM");
+    }
+
+    if (header.version == (GRM_VERSION | GRM_INCOMPLETE)) {
+        std::fclose(fid);
+        throw std::runtime_error("Binary GRM is incomplete, the run writing it "
+                                 "was interrupted");
+    }
+
+    if (header.version != GRM_VERSION || header.n_samples == 0) {
+        std::fclose(fid);
+        throw std::runtime_error("Unsupported binary GRM version");
+    }
+
+    std::unique_ptr<char[]> ids { std::make_unique<char[]>(header.id_bytes + 1) };
+    ids[header.id_bytes] = '\0';
+
+    if (std::fread(ids.get(), 1, header.id_bytes, fid) != header.id_bytes) {
+        std::fclose(fid);
+        throw std::runtime_error("Binary GRM sample ids are truncated");
+    }
+
+    GrmBinary grm;
+    grm.n_markers = header.n_markers;
+
+    for (size_t pos = 0; pos < header.id_bytes; ) {
+        grm.sample_ids.push_back(&ids[pos]);
+        pos += grm.sample_ids.back().size() + 1;
+    }
+
+    const size_t n { header.n_samples };
+
+    if (grm.sample_ids.size() != n
+            || std::fseek(fid, header.data_offset, SEEK_SET) != 0) {
+        std::fclose(fid);
+        throw std::runtime_error("Binary GRM header is inconsistent");
+    }
+
+    grm.covariance = std::make_unique<Matrix>(n, n);
+
+    std::unique_ptr<double[]> row { std::make_unique<double[]>(n) };
+    for (size_t i = 0; i < n; i++) {
+        if (std::fread(row.get(), sizeof(double), n, fid) != n) {
+            std::fclose(fid);
+            throw std::runtime_error("Binary GRM matrix is truncated");
+        }
+
+        for (size_t j = i; j < n; j++)
+            (*grm.covariance)(i, j) = row[j];
+    }
+
+    std::fclose(fid);
+    return grm;
+}
+
+
+std::unique_ptr<Matrix> create_grm_mapped(const char* filename,
+                                          const std::vector<std::string>& sample_ids) {
+
+    const size_t n { sample_ids.size() };
+
+    if (n == 0)
+        throw std::runtime_error("Binary GRM requires at least one sample");
+
+    GrmBinaryHeader header { make_grm_header(sample_ids, 0) };
+    header.version |= GRM_INCOMPLETE;
+
+    FILE* fout { std::fopen(filename, "w+b") };
+
+    if (!fout)
+        throw std::runtime_error("Error in opening file for writing.");
+
+    std::fwrite(&header, sizeof(header), 1, fout);
+
+    for (const std::string& id : sample_ids)
+        std::fwrite(id.c_str(), 1, id.size() + 1, fout);
+
+    if (std::fflush(fout) != 0 || std::ferror(fout)
+            || ftruncate(fileno(fout), header.data_offset + n * n * sizeof(double)) != 0) {
+        std::fclose(fout);
+        throw std::runtime_error("Error writing binary GRM");
+    }
+
+    std::unique_ptr<Matrix> covariance { nullptr };
+
+    try {
+        covariance = std::make_unique<Matrix>(n, n, fileno(fout), header.data_offset);
+    } catch (...) {
+        std::fclose(fout);
+        throw;
+    }
+
+    // the mapping holds the file open
+    std::fclose(fout);
+    return covariance;
+}
+
+
+void sync_grm_mapped(const char* filename, Matrix& covariance, size_t n_markers) {
+
+    covariance.sync();
+
+    FILE* fout { std::fopen(filename, "r+b") };
+
+    if (!fout)
+        throw std::runtime_error("File Access error");
+
+    const uint64_t markers { n_markers };
+    const uint64_t version { GRM_VERSION };
+
+    // the file is marked complete only once the matrix and the marker
+    // count are on disk
+    const bool written { std::fseek(fout, offsetof(GrmBinaryHeader, n_markers), SEEK_SET) == 0
+                         && std::fwrite(&markers, sizeof(markers), 1, fout) == 1
+                         && std::fflush(fout) == 0
+                         && fsync(fileno(fout)) == 0
+                         && std::fseek(fout, offsetof(GrmBinaryHeader, version), SEEK_SET) == 0
+                         && std::fwrite(&version, sizeof(version), 1, fout) == 1 };
+
+    if (std::fclose(fout) != 0 || !written)
+        throw std::runtime_error("Error writing binary GRM");
+}
+
+
+void write_grm_text(FILE* fout, const Matrix& covariance) {
+
+    const size_t n_samples { covariance.dims()[0] };
+
+    size_t i { 0 };
+    size_t j { 0 };
+    for (i = 0; i < n_samples; i++) {
+
+        for (j = 0; j < n_samples-1; j++) {
+            if (j < i)
+                fprintf(fout, "%0.5f,", covariance(j,i));
+            else
+                fprintf(fout, "%0.5f,", covariance(i,j));
+
+        }
+
+        fprintf(fout,"%0.5f\n", covariance(i, j));
+    }
+}
+
+
+void format_grm_rows(const Matrix& covariance, size_t row_begin, size_t row_end,
+                     std::string& text) {
+
+    const size_t n_samples { covariance.dims()[0] };
+
+    if (row_begin > row_end || row_end > n_samples)
+        throw std::out_of_range("Rows are out of matrix range");
+
+    char value[64];
+    int n_chars { 0 };
+    text.clear();
+
+    for (size_t i = row_begin; i < row_end; i++)
+        for (size_t j = 0; j < n_samples; j++) {
+            n_chars = snprintf(value, sizeof(value), "%0.5f%c",
+                               j < i ? covariance(j, i) : covariance(i, j),
+                               j + 1 < n_samples ? ',' : '\n');
+            text.append(value, n_chars);
+        }
+}
+
+
+void write_grm_ids(FILE* fout, const std::vector<std::string>& sample_ids) {
+    for (const std::string& id : sample_ids)
+        fprintf(fout, "%s\t%s\n", id.c_str(), id.c_str());
+}
+
+
+// Row i of the lower triangle is column i of the upper triangle, so
+// SPARSE_TILE output rows are gathered together, reading each upper
+// triangle row across them, and only the kept pairs are buffered.
+size_t write_grm_sparse(FILE* fout, const Matrix& covariance, double threshold) {
+
+    const size_t SPARSE_TILE { 256 };
+    const size_t n { covariance.dims()[0] };
+    const double* data { covariance.data() };
+
+    std::vector<std::vector<std::pair<size_t, double>>> kept(SPARSE_TILE);
+    size_t n_written { 0 };
+
+    for (size_t i_begin = 0; i_begin < n; i_begin += SPARSE_TILE) {
+        const size_t i_end { std::min(i_begin + SPARSE_TILE, n) };
+
+        for (size_t j = 0; j < i_end; j++) {
+            const double* row { data + j * n };
+
+            for (size_t i = std::max(i_begin, j); i < i_end; i++)
+                if (i == j || row[i] > threshold)
+                    kept[i - i_begin].push_back({ j, row[i] });
+        }
+
+        for (size_t i = i_begin; i < i_end; i++) {
+            for (const auto& [j, value] : kept[i - i_begin])
+                fprintf(fout, "%zu\t%zu\t%0.6g\n", i, j, value);
+
+            n_written += kept[i - i_begin].size();
+            kept[i - i_begin].clear();
+        }
+    }
+
+    return n_written;
+}
@@ -0,0 +1,420 @@
+// Accumulation of haplotype cross products in to a GRM
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <algorithm>
+#include "GrmKernels.h"
+
+
+namespace {
+
+// columns of the covariance updated together, so that the tile of a
+// row stays in cache while every founder column is added to it
+const size_t COLUMN_TILE { 512 };
+
+
+// covariance(i, j) += sum_c weights[c] x_ci x_cj for j >= i and rows i
+// in [row_begin, row_end) from founder major columns x_c.  The loop over
+// j is contiguous in both the row and the column, and dosages of 0 are
+// stepped over.
+void accumulate_upper_columns(const std::vector<const double*>& columns,
+                              const std::vector<double>& weights,
+                              Matrix& covariance, size_t row_begin, size_t row_end) {
+
+    const size_t n_samples { covariance.dims()[0] };
+    double* cov { covariance.data() };
+
+    double a { 0 };
+    double* row { nullptr };
+    const double* x { nullptr };
+
+    for (size_t j_tile = row_begin / COLUMN_TILE * COLUMN_TILE; j_tile < n_samples;
+            j_tile += COLUMN_TILE) {
+
+        const size_t j_end { std::min(n_samples, j_tile + COLUMN_TILE) };
+
+        for (size_t i = row_begin; i < std::min(j_end, row_end); i++) {
+
+            row = cov + i * n_samples;
+            const size_t j_begin { std::max(i, j_tile) };
+
+            for (size_t c = 0; c < columns.size(); c++) {
+                x = columns[c];
+                a = weights[c] * x[i];
+
+                if (a == 0)
+                    continue;
+
+                for (size_t j = j_begin; j < j_end; j++)
+                    row[j] += a * x[j];
+            }
+        }
+    }
+}
+
+
+void accumulate_upper_founder_major(const HaplotypeDataRecord& record, Matrix& covariance,
+                                    double weight, const double* founder_weights,
+                                    size_t row_begin, size_t row_end) {
+
+    const size_t k_founders { record.dims()[1] };
+
+    std::vector<const double*> columns(k_founders);
+    std::vector<double> weights(k_founders, weight);
+
+    for (size_t k = 0; k < k_founders; k++) {
+        columns[k] = record.founder_data(k);
+
+        if (founder_weights != nullptr)
+            weights[k] = founder_weights[k];
+    }
+
+    accumulate_upper_columns(columns, weights, covariance, row_begin, row_end);
+}
+
+
+void check_rows(size_t row_begin, size_t row_end, size_t n_samples) {
+    if (row_begin > row_end || row_end > n_samples)
+        throw std::out_of_range("Rows are out of matrix range");
+}
+
+
+void require_sample_major(const HaplotypeDataRecord& record) {
+    if (record.layout() != RecordLayout::sample_major)
+        throw std::runtime_error("Kernel requires sample major records");
+}
+
+}
+
+
+void accumulate_upper(const HaplotypeDataRecord& record, Matrix& covariance,
+                      double weight) {
+    accumulate_upper(record, covariance, 0, record.dims()[0], weight);
+}
+
+
+void accumulate_upper(const HaplotypeDataRecord& record, Matrix& covariance,
+                      size_t row_begin, size_t row_end, double weight) {
+
+    const size_t n_samples { record.dims()[0] };
+    const size_t k_founders { record.dims()[1] };
+
+    if (covariance.dims()[0] != n_samples || covariance.dims()[1] != n_samples)
+        throw std::runtime_error("Covariance and record dimensions differ");
+
+    check_rows(row_begin, row_end, n_samples);
+
+    if (record.layout() == RecordLayout::founder_major) {
+        accumulate_upper_founder_major(record, covariance, weight, nullptr,
+                                       row_begin, row_end);
+        return;
+    }
+
+    double sum { 0 };
+    const double* rowi { nullptr };
+    const double* rowj { nullptr };
+    double* rowi_cov { nullptr };
+
+    for (size_t i = row_begin; i < row_end; i++) {
+
+        rowi = &record(i, 0);
+        rowi_cov = &covariance(i, 0);
+
+        for (size_t j = i; j < n_samples; j++) {
+
+            rowj = &record(j,0);
+            sum = 0;
+
+            for (size_t k = 0; k < k_founders; k++)
+                sum += rowi[k] * rowj[k];
+
+            rowi_cov[j] += weight * sum;
+        }
+    }
+}
+
+
+void accumulate_rows(const HaplotypeDataRecord& record,
+                     const std::vector<size_t>& rows,
+                     Matrix& cross) {
+
+    const size_t n_samples { record.dims()[0] };
+    const size_t k_founders { record.dims()[1] };
+
+    if (cross.dims()[0] != rows.size() || cross.dims()[1] != n_samples)
+        throw std::runtime_error("Cross product and record dimensions differ");
+
+    require_sample_major(record);
+
+    double sum { 0 };
+    const double* rowi { nullptr };
+    const double* rowj { nullptr };
+    double* row_cross { nullptr };
+
+    for (size_t r = 0; r < rows.size(); r++) {
+
+        rowi = &record(rows[r], 0);
+        row_cross = &cross(r, 0);
+
+        for (size_t j = 0; j < n_samples; j++) {
+
+            rowj = &record(j, 0);
+            sum = 0;
+
+            for (size_t k = 0; k < k_founders; k++)
+                sum += rowi[k] * rowj[k];
+
+            row_cross[j] += sum;
+        }
+    }
+}
+
+
+void accumulate_upper(const SparseDosage& dosage, Matrix& covariance,
+                      double weight) {
+
+    const size_t n_samples { dosage.n_samples() };
+
+    if (covariance.dims()[0] != n_samples || covariance.dims()[1] != n_samples)
+        throw std::runtime_error("Covariance and record dimensions differ");
+
+    const size_t* start { dosage.founder_start() };
+    const size_t* samples { dosage.founder_samples() };
+    const double* values { dosage.founder_values() };
+
+    double va { 0 };
+    double* rowa_cov { nullptr };
+
+    // samples of a founder are sorted, so b >= a is the upper triangle
+    for (size_t k = 0; k < dosage.k_founders(); k++)
+        for (size_t a = start[k]; a < start[k + 1]; a++) {
+
+            va = weight * values[a];
+            rowa_cov = &covariance(samples[a], 0);
+
+            for (size_t b = a; b < start[k + 1]; b++)
+                rowa_cov[samples[b]] += va * values[b];
+        }
+}
+
+
+void accumulate_rows(const SparseDosage& dosage,
+                     const std::vector<size_t>& rows,
+                     Matrix& cross) {
+
+    if (cross.dims()[0] != rows.size() || cross.dims()[1] != dosage.n_samples())
+        throw std::runtime_error("Cross product and record dimensions differ");
+
+    const size_t* founder_start { dosage.founder_start() };
+    const size_t* samples { dosage.founder_samples() };
+    const double* values { dosage.founder_values() };
+    const size_t* sample_start { dosage.sample_start() };
+    const size_t* founders { dosage.sample_founders() };
+    const double* sample_values { dosage.sample_values() };
+
+    size_t k { 0 };
+    double v { 0 };
+    double* row_cross { nullptr };
+
+    for (size_t r = 0; r < rows.size(); r++) {
+
+        row_cross = &cross(r, 0);
+
+        for (size_t e = sample_start[rows[r]]; e < sample_start[rows[r] + 1]; e++) {
+
+            k = founders[e];
+            v = sample_values[e];
+
+            for (size_t b = founder_start[k]; b < founder_start[k + 1]; b++)
+                row_cross[samples[b]] += v * values[b];
+        }
+    }
+}
+
+
+void accumulate_upper_weighted(const HaplotypeDataRecord& record, Matrix& covariance,
+                               const double* founder_weights) {
+    accumulate_upper_weighted(record, covariance, founder_weights, 0, record.dims()[0]);
+}
+
+
+void accumulate_upper_weighted(const HaplotypeDataRecord& record, Matrix& covariance,
+                               const double* founder_weights,
+                               size_t row_begin, size_t row_end) {
+
+    const size_t n_samples { record.dims()[0] };
+    const size_t k_founders { record.dims()[1] };
+
+    if (covariance.dims()[0] != n_samples || covariance.dims()[1] != n_samples)
+        throw std::runtime_error("Covariance and record dimensions differ");
+
+    check_rows(row_begin, row_end, n_samples);
+
+    if (record.layout() == RecordLayout::founder_major) {
+        accumulate_upper_founder_major(record, covariance, 1, founder_weights,
+                                       row_begin, row_end);
+        return;
+    }
+
+    std::vector<double> weighted_rowi(k_founders);
+    double sum { 0 };
+    const double* rowi { nullptr };
+    const double* rowj { nullptr };
+    double* rowi_cov { nullptr };
+
+    for (size_t i = row_begin; i < row_end; i++) {
+
+        rowi = &record(i, 0);
+        rowi_cov = &covariance(i, 0);
+
+        for (size_t k = 0; k < k_founders; k++)
+            weighted_rowi[k] = founder_weights[k] * rowi[k];
+
+        for (size_t j = i; j < n_samples; j++) {
+
+            rowj = &record(j,0);
+            sum = 0;
+
+            for (size_t k = 0; k < k_founders; k++)
+                sum += weighted_rowi[k] * rowj[k];
+
+            rowi_cov[j] += sum;
+        }
+    }
+}
+
+
+void accumulate_upper_weighted(const SparseDosage& dosage, Matrix& covariance,
+                               const double* founder_weights) {
+
+    const size_t n_samples { dosage.n_samples() };
+
+    if (covariance.dims()[0] != n_samples || covariance.dims()[1] != n_samples)
+        throw std::runtime_error("Covariance and record dimensions differ");
+
+    const size_t* start { dosage.founder_start() };
+    const size_t* samples { dosage.founder_samples() };
+    const double* values { dosage.founder_values() };
+
+    double va { 0 };
+    double* rowa_cov { nullptr };
+
+    for (size_t k = 0; k < dosage.k_founders(); k++) {
+
+        if (founder_weights[k] == 0)
+            continue;
+
+        for (size_t a = start[k]; a < start[k + 1]; a++) {
+
+            va = founder_weights[k] * values[a];
+            rowa_cov = &covariance(samples[a], 0);
+
+            for (size_t b = a; b < start[k + 1]; b++)
+                rowa_cov[samples[b]] += va * values[b];
+        }
+    }
+}
+
+
+namespace {
+
+// out[j] += weight x_i . x_j for j in [j_begin, n_samples)
+void accumulate_pair_row(const PairStates& states, size_t i, size_t j_begin,
+                         double* out, double weight) {
+
+    const size_t n_samples { states.n_samples() };
+    const size_t k_founders { states.k_founders() };
+    const PairCode* codes { states.codes() };
+
+    PairCode cj { 0 };
+    const double* xj { nullptr };
+
+    if (codes[i] != EXACT_STATE) {
+
+        // state dot products are 0 to 4
+        const double weighted[5] { 0, weight, 2 * weight, 3 * weight, 4 * weight };
+
+        const uint8_t* table_row { states.table() + codes[i] * states.n_states() };
+        const size_t a { states.state_a(codes[i]) };
+        const size_t b { states.state_b(codes[i]) };
+
+        for (size_t j = j_begin; j < n_samples; j++) {
+            cj = codes[j];
+
+            if (cj != EXACT_STATE)
+                out[j] += weighted[table_row[cj]];
+            else {
+                xj = states.exact(j);
+                out[j] += weight * (xj[a] + xj[b]);
+            }
+        }
+
+        return;
+    }
+
+    const double* xi { states.exact(i) };
+    double sum { 0 };
+
+    for (size_t j = j_begin; j < n_samples; j++) {
+        cj = codes[j];
+
+        if (cj != EXACT_STATE) {
+            out[j] += weight * (xi[states.state_a(cj)] + xi[states.state_b(cj)]);
+            continue;
+        }
+
+        xj = states.exact(j);
+        sum = 0;
+
+        for (size_t k = 0; k < k_founders; k++)
+            sum += xi[k] * xj[k];
+
+        out[j] += weight * sum;
+    }
+}
+
+}
+
+
+void accumulate_upper(const PairStates& states, Matrix& covariance,
+                      double weight) {
+
+    const size_t n_samples { states.n_samples() };
+
+    if (covariance.dims()[0] != n_samples || covariance.dims()[1] != n_samples)
+        throw std::runtime_error("Covariance and record dimensions differ");
+
+    for (size_t i = 0; i < n_samples; i++)
+        accumulate_pair_row(states, i, i, &covariance(i, 0), weight);
+}
+
+
+void accumulate_rows(const PairStates& states,
+                     const std::vector<size_t>& rows,
+                     Matrix& cross) {
+
+    if (cross.dims()[0] != rows.size() || cross.dims()[1] != states.n_samples())
+        throw std::runtime_error("Cross product and record dimensions differ");
+
+    for (size_t r = 0; r < rows.size(); r++)
+        accumulate_pair_row(states, rows[r], 0, &cross(r, 0), 1);
+}
+
+
+void accumulate_upper(const DosagePanel& panel, Matrix& covariance, double weight) {
+
+    const size_t n_samples { panel.n_samples() };
+
+    if (covariance.dims()[0] != n_samples || covariance.dims()[1] != n_samples)
+        throw std::runtime_error("Covariance and panel dimensions differ");
+
+    std::vector<const double*> columns(panel.n_columns());
+    const std::vector<double> weights(panel.n_columns(), weight);
+
+    for (size_t c = 0; c < columns.size(); c++)
+        columns[c] = panel.column(c);
+
+    accumulate_upper_columns(columns, weights, covariance, 0, n_samples);
+}
@@ -0,0 +1,152 @@
+// Centering and standardization of the GRM in a single pass
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <cstring>
+#include <algorithm>
+#include "GrmNormalizer.h"
+
+
+// frequencies closer than this to 0 or 1 are treated as monomorphic
+const double MIN_FOUNDER_VARIANCE { 1e-12 };
+
+
+Normalization parse_normalization(const char* name) {
+    if (strcmp(name, "none") == 0)
+        return Normalization::none;
+    if (strcmp(name, "center") == 0)
+        return Normalization::center;
+    if (strcmp(name, "standardize") == 0)
+        return Normalization::standardize;
+
+    throw std::runtime_error("Normalization must be none, center or standardize");
+}
+
+
+GrmNormalizer::GrmNormalizer(size_t n_samples, size_t k_founders, Normalization mode)
+    : n_samples_(n_samples), k_founders_(k_founders), mode_(mode),
+        mean_(k_founders, 0), weights_(k_founders, 1),
+        weighted_mean_(k_founders, 0), a_(n_samples, 0) {};
+
+
+Normalization GrmNormalizer::mode() const { return mode_; }
+size_t GrmNormalizer::n_markers() const { return m_markers_; }
+
+
+const double* GrmNormalizer::founder_weights() const {
+    if (mode_ == Normalization::standardize)
+        return weights_.data();
+    return nullptr;
+}
+
+
+void GrmNormalizer::add_marker(const HaplotypeDataRecord& record) {
+
+    if (record.dims()[0] != n_samples_ || record.dims()[1] != k_founders_)
+        throw std::runtime_error("Normalizer and record dimensions differ");
+
+    m_markers_++;
+
+    if (mode_ == Normalization::none || n_samples_ == 0)
+        return;
+
+    std::fill(mean_.begin(), mean_.end(), 0);
+
+    const bool founder_major { record.layout() == RecordLayout::founder_major };
+    const double* row { nullptr };
+
+    if (founder_major) {
+        for (size_t k = 0; k < k_founders_; k++) {
+            row = record.founder_data(k);
+            for (size_t i = 0; i < n_samples_; i++)
+                mean_[k] += row[i];
+        }
+    } else {
+        for (size_t i = 0; i < n_samples_; i++) {
+            row = &record(i, 0);
+            for (size_t k = 0; k < k_founders_; k++)
+                mean_[k] += row[k];
+        }
+    }
+
+    double p { 0 };
+    double variance { 0 };
+
+    for (size_t k = 0; k < k_founders_; k++) {
+        mean_[k] /= n_samples_;
+
+        if (mode_ == Normalization::standardize) {
+            p = mean_[k] / 2;
+            variance = 2 * p * (1 - p);
+            weights_[k] = variance > MIN_FOUNDER_VARIANCE ? 1 / variance : 0;
+        }
+
+        weighted_mean_[k] = weights_[k] * mean_[k];
+        c_ += weighted_mean_[k] * mean_[k];
+    }
+
+    if (founder_major) {
+        for (size_t k = 0; k < k_founders_; k++) {
+            row = record.founder_data(k);
+            for (size_t i = 0; i < n_samples_; i++)
+                a_[i] += row[i] * weighted_mean_[k];
+        }
+
+        return;
+    }
+
+    double sum { 0 };
+    for (size_t i = 0; i < n_samples_; i++) {
+        row = &record(i, 0);
+        sum = 0;
+
+        for (size_t k = 0; k < k_founders_; k++)
+            sum += row[k] * weighted_mean_[k];
+
+        a_[i] += sum;
+    }
+}
+
+
+void GrmNormalizer::merge(const GrmNormalizer& other) {
+
+    if (other.mode_ != mode_ || other.n_samples_ != n_samples_
+            || other.k_founders_ != k_founders_)
+        throw std::runtime_error("Normalizers differ");
+
+    for (size_t i = 0; i < n_samples_; i++)
+        a_[i] += other.a_[i];
+
+    c_ += other.c_;
+    m_markers_ += other.m_markers_;
+}
+
+
+void GrmNormalizer::finalize(Matrix& covariance, const PairCounts* counts) const {
+
+    if (covariance.dims()[0] != n_samples_ || covariance.dims()[1] != n_samples_)
+        throw std::runtime_error("Covariance and normalizer dimensions differ");
+
+    if (mode_ == Normalization::none || m_markers_ == 0) {
+        if (counts != nullptr)
+            counts->normalize(covariance);
+        return;
+    }
+
+    const double scale { 1.0 / m_markers_ };
+
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t j = i; j < n_samples_; j++)
+            covariance(i, j) = covariance(i, j) - a_[i] - a_[j] + c_;
+
+    if (counts != nullptr) {
+        counts->normalize(covariance);
+        return;
+    }
+
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t j = i; j < n_samples_; j++)
+            covariance(i, j) *= scale;
+}
@@ -12,6 +12,7 @@
 // reviewed by Claude Sonnet, the AI assistant from Anthropic
 // (Jan 2025), with minor recommendations incorporated.
 //
+#include <algorithm>
 #include "HaplotypeVcfParser.h"
 
 
@@ -24,20 +25,137 @@ HaplotypeDataRecord::HaplotypeDataRecord(size_t n_samples, size_t k_founders)
 
         if (n_samples_ <= 0 || k_founders_ <= 0)
             throw std::runtime_error("Data must have more than zero samples and founders");
-         
+
+        reset_valid_();
+    };
+
+
+HaplotypeDataRecord::HaplotypeDataRecord(size_t n_samples, size_t k_founders,
+        const std::vector<bool>& sample_mask) 
+    : n_samples_(n_samples),
+        k_founders_(k_founders),
+        samples_(n_samples_ > 0 && k_founders_ > 0 
+                    ? std::make_unique<Matrix>(n_samples_, k_founders_) : nullptr),
+        sample_mask_(sample_mask) {
+
+        if (n_samples_ <= 0 || k_founders_ <= 0)
+            throw std::runtime_error("Data must have more than zero samples and founders");
+
+        size_t n_kept { 0 };
+        for (bool keep : sample_mask_)
+            n_kept += keep;
+
+        if (n_kept != n_samples_)
+            throw std::runtime_error("Sample mask does not match the number of samples");
+
+        reset_valid_();
     };
 
 
 // access elements
-const std::string& HaplotypeDataRecord::chrom() const { return chrom_; };
-const long HaplotypeDataRecord::pos() const { return pos_; };
-const std::string& HaplotypeDataRecord::id() const { return id_; };
-const char HaplotypeDataRecord::ref() const { return ref_; };
-const char HaplotypeDataRecord::alt() const { return alt_; };
-const std::string& HaplotypeDataRecord::qual() const { return qual_; };
-const std::string& HaplotypeDataRecord::filter() const { return filter_; };
-const std::string& HaplotypeDataRecord::info() const { return info_; };
-const std::string& HaplotypeDataRecord::format() const { return format_; };
+std::string_view HaplotypeDataRecord::chrom() const { return fixed_cols_[0]; };
+
+long HaplotypeDataRecord::pos() const {
+    // the column is followed by white space in fixed_
+    return fixed_cols_[1].empty() ? -1 : std::atol(fixed_cols_[1].data());
+};
+
+std::string_view HaplotypeDataRecord::id() const { return fixed_cols_[2]; };
+
+char HaplotypeDataRecord::ref() const {
+    return fixed_cols_[3].empty() ? '\0' : fixed_cols_[3][0];
+};
+
+char HaplotypeDataRecord::alt() const {
+    return fixed_cols_[4].empty() ? '\0' : fixed_cols_[4][0];
+};
+
+std::string_view HaplotypeDataRecord::qual() const { return fixed_cols_[5]; };
+std::string_view HaplotypeDataRecord::filter() const { return fixed_cols_[6]; };
+std::string_view HaplotypeDataRecord::info() const { return fixed_cols_[7]; };
+std::string_view HaplotypeDataRecord::format() const { return fixed_cols_[8]; };
+
+
+std::string_view HaplotypeDataRecord::info(std::string_view key) const {
+
+    std::string_view rest { fixed_cols_[7] };
+    std::string_view entry;
+
+    while (!rest.empty()) {
+        const size_t end { rest.find(';') };
+        entry = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view {} : rest.substr(end + 1);
+
+        if (entry.size() > key.size() && entry[key.size()] == '='
+                && entry.compare(0, key.size(), key) == 0)
+            return entry.substr(key.size() + 1);
+    }
+
+    return {};
+}
+
+
+// Copy the first nine columns of the line to fixed_ and set the views
+// of each.  Returns the position in line following FORMAT, nullptr if
+// the line has fewer columns.
+const char* HaplotypeDataRecord::parse_fixed_(const char* line) {
+
+    std::array<size_t, NUM_VCF_FIELDS> starts;
+    std::array<size_t, NUM_VCF_FIELDS> lens;
+    size_t i { 0 };
+
+    for (int col = 0; col < NUM_VCF_FIELDS; col++) {
+        while (line[i] != '\0' && std::isspace(line[i]))
+            i++;
+
+        if (line[i] == '\0')
+            return nullptr;
+
+        starts[col] = i;
+        while (line[i] != '\0' && !std::isspace(line[i]))
+            i++;
+        lens[col] = i - starts[col];
+    }
+
+    // null terminated, and every column but FORMAT followed by white
+    // space, so POS converts in place
+    fixed_.assign(line, i);
+
+    for (int col = 0; col < NUM_VCF_FIELDS; col++)
+        fixed_cols_[col] = std::string_view(fixed_.data() + starts[col], lens[col]);
+
+    return line + i;
+}
+
+
+// index of HD among the FORMAT keys, searched only when FORMAT differs
+// from that of the previous line
+void HaplotypeDataRecord::find_hap_idx_() {
+
+    if (!hap_format_.empty() && fixed_cols_[8] == hap_format_)
+        return;
+
+    const std::string format { fixed_cols_[8] };
+
+    hap_format_.clear();
+    field_parse_.update_str(format.c_str());
+
+    bool hap_found { false };
+    ds_idx_ = SIZE_MAX;
+
+    for (size_t i = 0; field_parse_.next_field(); i++) {
+        if (std::strcmp(field_parse_.data(), HAP_CODE) == 0) {
+            hap_idx_ = i;
+            hap_found = true;
+        } else if (std::strcmp(field_parse_.data(), DOSAGE_CODE) == 0)
+            ds_idx_ = i;
+    }
+
+    if (!hap_found)
+        throw std::runtime_error("Haplotype counts are not specified");
+
+    hap_format_ = fixed_cols_[8];
+}
 
 
 void HaplotypeDataRecord::parse_vcf_line(const char* vcf_line) {
@@ -53,87 +171,310 @@ void HaplotypeDataRecord::parse_vcf_line(const char* vcf_line) {
     // fields have numerous : delimited records
     // The counts of the k founders in any one sample field is a comma delimited
     // element of a sample field record.
-    size_t hap_idx { 0 };              // index with hap counts
     bool hap_found { false };       // determine whether hap dose is in dataset
+    bool ds_found { false };
     size_t sample_idx { 0 };           // sample index
-    size_t founder_idx { 0 };
+    size_t col_idx { 0 };              // sample column index, kept or not
 
-    line_parse_.update_str(vcf_line);
-
-    for (int field_idx = 1; line_parse_.next_field(); field_idx++) {
-
-        if (field_idx == 1)
-            chrom_ = line_parse_.data();
-        else if (field_idx == 2)
-            pos_ = std::atoi(line_parse_.data());
-        else if (field_idx == 3)
-            id_ = line_parse_.data();
-        else if (field_idx == 4)
-            ref_ = line_parse_.data()[0];
-        else if (field_idx == 5)
-            alt_ = line_parse_.data()[0];
-        else if (field_idx == 6)
-            qual_ = line_parse_.data();
-        else if (field_idx == 7)
-            filter_ = line_parse_.data();
-        else if (field_idx == 8)
-            info_ = line_parse_.data();
-        else if (field_idx == 9) {
-            format_ = line_parse_.data();
-
-            // verify in the format field that haplotype dose (HD)
-            // is included in the data.  Find the index (hap_idx)
-            // for which haplotype count data is found in a sample field
-            // record
-            field_parse_.update_str(line_parse_.data());
+    // fixed columns are timed as tokenize, sample columns as parse
+    std::chrono::steady_clock::time_point t_phase;
 
-            hap_found = false;
-            for (size_t i = 0; field_parse_.next_field(); i++) {
-                if (std::strcmp(field_parse_.data(), HAP_CODE) == 0 ) {
-                    hap_found = true;
-                    hap_idx = i;
+    if (profile_)
+        t_phase = std::chrono::steady_clock::now();
+
+    reset_valid_();
+
+    if (snp_dosages_ != nullptr)
+        snp_dosages_->reset_valid_();
+
+    const char* samples { parse_fixed_(vcf_line) };
+
+    if (samples == nullptr) {
+        fixed_cols_.fill({});
+        throw std::runtime_error("Number of samples found is not equal to that expected.");
+    }
+
+    // verify in the format field that haplotype dose (HD) is included
+    // in the data, and find the index (hap_idx_) for which haplotype
+    // count data is found in a sample field record
+    find_hap_idx_();
+
+    if (snp_dosages_ != nullptr && ds_idx_ == SIZE_MAX)
+        throw std::runtime_error("SNP dosages (DS) are not specified");
+
+    // the subfields of a sample are read up to the last one needed
+    const size_t last_idx { snp_dosages_ != nullptr ? std::max(hap_idx_, ds_idx_)
+                                                    : hap_idx_ };
+
+    if (profile_) {
+        auto t_now { std::chrono::steady_clock::now() };
+        profile_->add(Phase::tokenize, t_now - t_phase, 0, 1);
+        t_phase = t_now;
+    }
+
+    line_parse_.update_str(samples);
+
+    for (int field_idx = NUM_VCF_FIELDS + 1; ; field_idx++) {
+
+        // Excluded samples are stepped over without copying or
+        // converting the field
+        if (!sample_mask_.empty()) {
+
+            col_idx = field_idx - NUM_VCF_FIELDS - 1;
+
+            if (col_idx >= sample_mask_.size()) {
+                if (line_parse_.next_field())
+                    throw std::out_of_range("More sample columns than in the header.");
+                break;
+            }
+
+            if (!sample_mask_[col_idx]) {
+                if (!line_parse_.skip_field())
                     break;
-                }
-                hap_idx++;
+                continue;
             }
+        }
 
-            if (!hap_found)
-                throw std::runtime_error("Haplotype counts are not specified");
+        if (!line_parse_.next_field())
+            break;
 
-        } else if (field_idx > 9 && samples_) {
+        if (samples_ || target_ != nullptr) {
 
             if (sample_idx < 0 || sample_idx >= n_samples_)
                 throw std::out_of_range("Index is out of matrix range.");
 
             field_parse_.update_str(line_parse_.data());
-            for (size_t j = 0; field_parse_.next_field(); j++)
-                if (j == hap_idx)
-                    break;
 
-            hap_parse_.update_str(field_parse_.data());
+            // trailing fields of a sample may be dropped, e.g. ./.
+            hap_found = false;
+            ds_found = false;
+            for (size_t j = 0; field_parse_.next_field(); j++) {
+                if (j == ds_idx_ && snp_dosages_ != nullptr) {
+                    ds_found = !(field_parse_.data()[0] == MISSING_VALUE
+                                    && field_parse_.data()[1] == '\0');
+                    if (ds_found)
+                        snp_dosages_->value_(sample_idx, 0) = std::atof(field_parse_.data());
+                }
+
+                if (j == hap_idx_) {
+                    hap_found = true;
+                    parse_hap_(sample_idx, field_parse_.data());
+                }
 
-            // decompose haplotype counts to respective founders
-            for (founder_idx = 0; hap_parse_.next_field(); founder_idx++)
-                (*samples_)(sample_idx, founder_idx) = std::atof(hap_parse_.data());
+                if (j >= last_idx)
+                    break;
+            }
 
+            if (!hap_found)
+                set_missing_(sample_idx);
+
+            if (snp_dosages_ != nullptr && !ds_found)
+                snp_dosages_->set_missing_(sample_idx);
 
-            if (founder_idx != k_founders_)
-                throw std::runtime_error("Number of founders found for sample is incorrect");
-            
             sample_idx++;
         }
     }
 
+    if (profile_)
+        profile_->add(Phase::parse, std::chrono::steady_clock::now() - t_phase, 0, 1);
+
     if (sample_idx != n_samples_)
         throw std::runtime_error("Number of samples found is not equal to that expected.");
 
 }
 
 
+// the HD entry of sample i, missing when '.' or with a '.' dosage
+void HaplotypeDataRecord::parse_hap_(size_t i, const char* field) {
+
+    if (field[0] == MISSING_VALUE && field[1] == '\0') {
+        set_missing_(i);
+        return;
+    }
+
+    hap_parse_.update_str(field);
+
+    // decompose haplotype counts to respective founders
+    bool missing { false };
+    size_t founder_idx { 0 };
+    for (founder_idx = 0; hap_parse_.next_field(); founder_idx++) {
+        if (founder_idx >= k_founders_)
+            throw std::runtime_error("Number of founders found for sample is incorrect");
+
+        if (hap_parse_.data()[0] == MISSING_VALUE && hap_parse_.data()[1] == '\0')
+            missing = true;
+        else
+            value_(i, founder_idx) = std::atof(hap_parse_.data());
+    }
+
+    if (founder_idx != k_founders_)
+        throw std::runtime_error("Number of founders found for sample is incorrect");
+
+    if (missing)
+        set_missing_(i);
+}
+
+
+void HaplotypeDataRecord::set_snp_dosages(HaplotypeDataRecord* snp_dosages) {
+
+    if (snp_dosages != nullptr
+            && (snp_dosages == this || snp_dosages->n_samples_ != n_samples_
+                || snp_dosages->k_founders_ != 1))
+        throw std::runtime_error("SNP dosage record must be n_samples by 1");
+
+    snp_dosages_ = snp_dosages;
+}
+
+
+void HaplotypeDataRecord::set_profiler(PhaseCounters* counters) {
+    profile_ = counters;
+}
+
+
+void HaplotypeDataRecord::reset_valid_() {
+    valid_.assign((n_samples_ + 63) / 64, ~uint64_t { 0 });
+
+    // bits past the last sample are clear
+    if (n_samples_ % 64 != 0)
+        valid_.back() = (uint64_t { 1 } << (n_samples_ % 64)) - 1;
+
+    n_missing_ = 0;
+}
+
+
+void HaplotypeDataRecord::set_missing_(size_t i) {
+    if (i >= n_samples_)
+        throw std::out_of_range("Index is out of matrix range.");
+
+    for (size_t k = 0; k < k_founders_; k++)
+        value_(i, k) = 0;
+
+    valid_[i / 64] &= ~(uint64_t { 1 } << (i % 64));
+    n_missing_++;
+}
+
+
+void HaplotypeDataRecord::assign(const double* dosages, const uint64_t* valid) {
+
+    reset_valid_();
+
+    for (size_t i = 0; i < n_samples_; i++) {
+        for (size_t k = 0; k < k_founders_; k++)
+            value_(i, k) = dosages[i * k_founders_ + k];
+
+        if (valid != nullptr && !((valid[i / 64] >> (i % 64)) & 1))
+            set_missing_(i);
+    }
+}
+
+
+bool HaplotypeDataRecord::is_valid(size_t i) const {
+    return (valid_[i / 64] >> (i % 64)) & 1;
+}
+
+
+size_t HaplotypeDataRecord::n_missing() const { return n_missing_; }
+const uint64_t* HaplotypeDataRecord::valid_words() const { return valid_.data(); }
+
+
+void HaplotypeDataRecord::fill_missing_with_mean() {
+
+    if (n_missing_ == 0 || n_missing_ == n_samples_)
+        return;
+
+    std::vector<double> mean(k_founders_, 0);
+
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t k = 0; k < k_founders_; k++)
+            mean[k] += value_(i, k);
+
+    for (size_t k = 0; k < k_founders_; k++)
+        mean[k] /= n_samples_ - n_missing_;
+
+    for (size_t i = 0; i < n_samples_; i++) {
+        if (is_valid(i))
+            continue;
+
+        for (size_t k = 0; k < k_founders_; k++)
+            value_(i, k) = mean[k];
+    }
+}
+
+
 const double& HaplotypeDataRecord::operator()(size_t i, size_t j) const {
+    if (layout_ == RecordLayout::founder_major) {
+        if (i >= n_samples_ || j >= k_founders_)
+            throw std::out_of_range("Index is out of matrix range.");
+
+        return target_[j * stride_ + i];
+    }
+
     return (*samples_)(i, j);
 }
 
+
+double& HaplotypeDataRecord::value_(size_t i, size_t k) {
+    if (layout_ == RecordLayout::founder_major)
+        return target_[k * stride_ + i];
+
+    return (*samples_)(i, k);
+}
+
+
+void HaplotypeDataRecord::set_layout(RecordLayout layout) {
+
+    layout_ = layout;
+    target_ = nullptr;
+    founders_.reset();
+    stride_ = 0;
+
+    if (layout_ == RecordLayout::sample_major) {
+        samples_ = std::make_unique<Matrix>(n_samples_, k_founders_);
+        return;
+    }
+
+    samples_.reset();
+    stride_ = (n_samples_ + 7) / 8 * 8;
+
+    const size_t bytes { k_founders_ * stride_ * sizeof(double) };
+    founders_.reset(static_cast<double*>(std::aligned_alloc(64, bytes)));
+
+    if (!founders_)
+        throw std::bad_alloc();
+
+    std::fill(founders_.get(), founders_.get() + k_founders_ * stride_, 0);
+    target_ = founders_.get();
+}
+
+
+RecordLayout HaplotypeDataRecord::layout() const { return layout_; }
+size_t HaplotypeDataRecord::founder_stride() const { return stride_; }
+
+
+const double* HaplotypeDataRecord::founder_data(size_t k) const {
+    if (layout_ != RecordLayout::founder_major)
+        throw std::runtime_error("Founder data requires the founder major layout");
+
+    if (k >= k_founders_)
+        throw std::out_of_range("Index is out of matrix range.");
+
+    return target_ + k * stride_;
+}
+
+
+void HaplotypeDataRecord::set_target(double* target) {
+    if (layout_ != RecordLayout::founder_major)
+        throw std::runtime_error("Targets require the founder major layout");
+
+    if (target != nullptr && reinterpret_cast<uintptr_t>(target) % 64 != 0)
+        throw std::runtime_error("Record targets must be 64 byte aligned");
+
+    target_ = target != nullptr ? target : founders_.get();
+}
+
+
+const double* HaplotypeDataRecord::target() const { return target_; }
+
 std::array<size_t, 2> HaplotypeDataRecord::dims() const {
-    return (*samples_).dims();
+    return { n_samples_, k_founders_ };
 }
@@ -58,6 +58,48 @@ HaplotypeVcfParser::HaplotypeVcfParser(char* filename, size_t buff_size)
 };
 
 
+HaplotypeVcfParser::HaplotypeVcfParser(char* filename, size_t buff_size,
+        const SampleSelection& selection)
+    : fname_(filename),
+        file_io_(BufferedRead(filename, buff_size)),
+        selection_(selection) {
+
+    // get number of characters in data record for line buffer size
+    size_t nchar { get_line_num_char_() };
+
+    if (nchar == 0)
+        throw std::runtime_error("No data to read");
+
+    // make buffer 10% larger then the number of characters read.
+    line_buffer_size_ = static_cast<size_t>(nchar * 1.1);
+    line_buffer_.reset(line_buffer_size_);
+
+    set_params_();
+    pos_(fpos_record_one_);
+};
+
+
+HaplotypeVcfParser::HaplotypeVcfParser(size_t buff_size,
+        const HaplotypeVcfParser& header)
+    : fname_(header.fname_),
+        file_io_(BufferedRead(const_cast<char*>(fname_.c_str()), buff_size)),
+        line_buffer_size_(header.line_buffer_size_),
+        n_cols_(header.n_cols_),
+        n_samples_(header.n_samples_),
+        n_sample_cols_(header.n_sample_cols_),
+        k_founders_(header.k_founders_),
+        fpos_record_one_(header.fpos_record_one_),
+        selection_(header.selection_),
+        marker_filter_(header.marker_filter_),
+        sample_names_(header.sample_names_),
+        sample_mask_(header.sample_mask_) {
+
+    line_buffer_.reset(line_buffer_size_);
+    pos_(fpos_record_one_);
+    marker_filter_.restart();
+};
+
+
 // HaplotypeVcfParser::HaplotypeVcfParser(std::string filename)
 //     : fname_(filename),
 //         fid_(filename) {
@@ -110,13 +152,25 @@ size_t HaplotypeVcfParser::get_line_num_char_() {
 size_t HaplotypeVcfParser::n_samples() const { return n_samples_; }
 
 
+size_t HaplotypeVcfParser::n_sample_columns() const { return n_sample_cols_; }
+
+
 size_t HaplotypeVcfParser::k_founders() const { return k_founders_; }
 
 
+const std::vector<std::string>& HaplotypeVcfParser::sample_names() const {
+    return sample_names_;
+}
+
+
+const std::vector<bool>& HaplotypeVcfParser::sample_mask() const {
+    return sample_mask_;
+}
+
+
+// seek clears the buffer, reads ahead no further than the range end
 void HaplotypeVcfParser::pos_(size_t n) { 
-    file_io_.reset();
-    if (n != 0)
-        file_io_.seek(n);
+    file_io_.seek(n, range_end_);
 }
 
 
@@ -156,7 +210,7 @@ void HaplotypeVcfParser::set_params_() {
     StringRecord hap_parser_ { HAP_DELIM };
 
     n_cols_ = 0;
-    n_samples_ = 0;
+    std::vector<std::string> column_names;
     for (; line_parser_.next_field(); n_cols_++) {
 
         if (n_cols_ < NUM_VCF_FIELDS 
@@ -164,10 +218,12 @@ void HaplotypeVcfParser::set_params_() {
             throw std::runtime_error("File doesn't follow vcf header specification");
 
         if (n_cols_ >= NUM_VCF_FIELDS)
-            n_samples_++;
+            column_names.push_back(line_parser_.data());
 
     }
 
+    select_samples_(column_names);
+
 
     // get k founders from record
     if ((n = file_io_.get_line(line_buffer_)) == 0)
@@ -205,16 +261,147 @@ void HaplotypeVcfParser::set_params_() {
 }
 
 
+// Resolve the keep and remove sample lists against the sample names
+// of the #CHROM header line.  Identifiers that are not in the header
+// are ignored.
+void HaplotypeVcfParser::select_samples_(const std::vector<std::string>& column_names) {
+
+    if (selection_.has_keep && selection_.keep.empty())
+        throw std::runtime_error("Sample keep list is empty");
+
+    const bool use_keep { selection_.has_keep || !selection_.keep.empty() };
+    const std::unordered_set<std::string> keep(selection_.keep.begin(),
+                                               selection_.keep.end());
+    const std::unordered_set<std::string> remove(selection_.remove.begin(),
+                                                 selection_.remove.end());
+
+    n_sample_cols_ = column_names.size();
+    sample_mask_.assign(n_sample_cols_, false);
+
+    for (size_t i = 0; i < n_sample_cols_; i++)
+        sample_mask_[i] = (!use_keep || keep.count(column_names[i]) > 0)
+                            && remove.count(column_names[i]) == 0;
+
+    sample_names_.clear();
+    for (size_t i = 0; i < n_sample_cols_; i++)
+        if (sample_mask_[i])
+            sample_names_.push_back(column_names[i]);
+
+    n_samples_ = sample_names_.size();
+
+    if (n_samples_ == 0)
+        throw std::runtime_error("No samples remain after applying sample selection");
+}
+
+
+void HaplotypeVcfParser::set_marker_filter(const MarkerFilter& filter) {
+    marker_filter_ = filter;
+}
+
+
+const MarkerFilter& HaplotypeVcfParser::marker_filter() const {
+    return marker_filter_;
+}
+
+
+void HaplotypeVcfParser::rewind() {
+    range_end_ = SIZE_MAX;
+    pos_(fpos_record_one_);
+    marker_filter_.restart();
+}
+
+
+void HaplotypeVcfParser::set_range(size_t begin, size_t end) {
+
+    marker_filter_.restart();
+    range_end_ = end;
+
+    if (begin <= fpos_record_one_) {
+        pos_(fpos_record_one_);
+        return;
+    }
+
+    // the first line starting at or after begin follows the first
+    // newline at or after begin - 1
+    pos_(begin - 1);
+    file_io_.skip_line();
+}
+
+
+size_t HaplotypeVcfParser::data_offset() const { return fpos_record_one_; }
+const std::string& HaplotypeVcfParser::filename() const { return fname_; }
+
+
+size_t HaplotypeVcfParser::bytes_read() const { return file_io_.offset(); }
+size_t HaplotypeVcfParser::file_size() const { return file_io_.file_size(); }
+
+
+bool HaplotypeVcfParser::use_uring(const UringOptions& options) {
+    return file_io_.use_uring(options);
+}
+
+
+void HaplotypeVcfParser::set_profiler(PhaseCounters* counters) {
+    profile_ = counters;
+}
+
+
 bool HaplotypeVcfParser::load_record(HaplotypeDataRecord& record) {
 
-    size_t n { 0 };
+    const char* line { next_line() };
 
-    if ((n = file_io_.get_line(line_buffer_)) == 0)
+    if (line == nullptr)
         return false;
 
-    record.parse_vcf_line(line_buffer_.data());
+    record.parse_vcf_line(line);
 
     return true;
 }
 
 
+const char* HaplotypeVcfParser::next_line() {
+
+    size_t n { 0 };
+
+    {
+        ScopedPhase timer { profile_, Phase::read };
+        const size_t start { file_io_.offset() };
+
+        if (start >= range_end_)
+            return nullptr;
+
+        if (!marker_filter_.active()) {
+
+            if ((n = file_io_.get_line(line_buffer_)) == 0)
+                return nullptr;
+
+        } else {
+
+            // Only the fixed columns are read before the filter decides,
+            // the sample columns of rejected markers are passed over by
+            // a search for the newline.
+            while (true) {
+
+                if ((n = file_io_.get_fields(line_buffer_, SPACE_DELIM, NUM_VCF_FIELDS)) == 0)
+                    return nullptr;
+
+                if (marker_filter_.accept(line_buffer_.data()))
+                    break;
+
+                file_io_.skip_line();
+
+                if (file_io_.offset() >= range_end_)
+                    return nullptr;
+            }
+
+            file_io_.append_line(line_buffer_);
+        }
+
+        timer.add_bytes(file_io_.offset() - start);
+        timer.add_markers(1);
+    }
+
+    return line_buffer_.data();
+}
+
+
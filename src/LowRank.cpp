@@ -0,0 +1,308 @@
+// Top eigenpairs of the haplotype GRM without forming the GRM
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include "LowRank.h"
+
+const static size_t MAX_JACOBI_SWEEPS { 100 };
+const static double JACOBI_TOLERANCE { 1e-14 };
+
+
+void orthonormalize_columns(Matrix& a) {
+
+    const size_t nrow { a.dims()[0] };
+    const size_t mcol { a.dims()[1] };
+
+    double dot { 0 };
+    double norm { 0 };
+    double norm_before { 0 };
+
+    for (size_t c = 0; c < mcol; c++) {
+
+        norm_before = 0;
+        for (size_t i = 0; i < nrow; i++)
+            norm_before += a(i, c) * a(i, c);
+
+        // two rounds of projection keep the basis orthogonal to
+        // working precision
+        for (int round = 0; round < 2; round++) {
+            for (size_t p = 0; p < c; p++) {
+
+                dot = 0;
+                for (size_t i = 0; i < nrow; i++)
+                    dot += a(i, p) * a(i, c);
+
+                for (size_t i = 0; i < nrow; i++)
+                    a(i, c) -= dot * a(i, p);
+            }
+        }
+
+        norm = 0;
+        for (size_t i = 0; i < nrow; i++)
+            norm += a(i, c) * a(i, c);
+
+        norm = std::sqrt(norm);
+
+        // column is numerically in the span of the previous columns
+        if (norm <= 1e-12 * std::sqrt(norm_before) || norm == 0) {
+            for (size_t i = 0; i < nrow; i++)
+                a(i, c) = 0;
+            continue;
+        }
+
+        for (size_t i = 0; i < nrow; i++)
+            a(i, c) /= norm;
+    }
+}
+
+
+void symmetric_eigen(Matrix& a, std::vector<double>& values, Matrix& vectors) {
+
+    const size_t n { a.dims()[0] };
+
+    if (a.dims()[1] != n || vectors.dims()[0] != n || vectors.dims()[1] != n)
+        throw std::runtime_error("Eigen decomposition requires square matrices");
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            vectors(i, j) = i == j ? 1 : 0;
+
+    double off { 0 };
+    double scale { 0 };
+    double theta { 0 };
+    double t { 0 };
+    double c { 0 };
+    double s { 0 };
+    double aip { 0 };
+    double aiq { 0 };
+
+    for (size_t sweep = 0; sweep < MAX_JACOBI_SWEEPS; sweep++) {
+
+        off = 0;
+        scale = 0;
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++) {
+                scale += a(i, j) * a(i, j);
+                if (i != j)
+                    off += a(i, j) * a(i, j);
+            }
+
+        if (off <= JACOBI_TOLERANCE * JACOBI_TOLERANCE * scale)
+            break;
+
+        for (size_t p = 0; p + 1 < n; p++)
+            for (size_t q = p + 1; q < n; q++) {
+
+                if (a(p, q) == 0)
+                    continue;
+
+                theta = (a(q, q) - a(p, p)) / (2 * a(p, q));
+                t = (theta >= 0 ? 1 : -1)
+                    / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                c = 1 / std::sqrt(t * t + 1);
+                s = t * c;
+
+                // A <- J^T A J
+                for (size_t i = 0; i < n; i++) {
+                    aip = a(i, p);
+                    aiq = a(i, q);
+                    a(i, p) = c * aip - s * aiq;
+                    a(i, q) = s * aip + c * aiq;
+                }
+
+                for (size_t i = 0; i < n; i++) {
+                    aip = a(p, i);
+                    aiq = a(q, i);
+                    a(p, i) = c * aip - s * aiq;
+                    a(q, i) = s * aip + c * aiq;
+                }
+
+                for (size_t i = 0; i < n; i++) {
+                    aip = vectors(i, p);
+                    aiq = vectors(i, q);
+                    vectors(i, p) = c * aip - s * aiq;
+                    vectors(i, q) = s * aip + c * aiq;
+                }
+            }
+    }
+
+    // sort in descending order of eigenvalue
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&a](size_t i, size_t j) { return a(i, i) > a(j, j); });
+
+    Matrix unsorted { vectors };
+    values.resize(n);
+
+    for (size_t c = 0; c < n; c++) {
+        values[c] = a(order[c], order[c]);
+        for (size_t i = 0; i < n; i++)
+            vectors(i, c) = unsorted(i, order[c]);
+    }
+}
+
+
+RandomizedEigen::RandomizedEigen(size_t n_samples, size_t rank,
+        size_t oversample, unsigned long seed)
+    : n_samples_(n_samples),
+        rank_(rank),
+        sketch_size_(std::min(rank + oversample, n_samples)),
+        q_(n_samples, sketch_size_),
+        y_(n_samples, sketch_size_) {
+
+    if (rank_ == 0 || rank_ > n_samples_)
+        throw std::runtime_error("Rank must be between 1 and the number of samples");
+
+    std::mt19937_64 rng { seed };
+    std::normal_distribution<double> normal { 0, 1 };
+
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t c = 0; c < sketch_size_; c++)
+            q_(i, c) = normal(rng);
+
+    orthonormalize_columns(q_);
+}
+
+
+size_t RandomizedEigen::n_passes(size_t power_iters) { return power_iters + 2; }
+
+size_t RandomizedEigen::rank() const { return rank_; }
+size_t RandomizedEigen::sketch_size() const { return sketch_size_; }
+
+
+const std::vector<double>& RandomizedEigen::eigenvalues() const { return values_; }
+
+
+const Matrix& RandomizedEigen::eigenvectors() const {
+    if (!vectors_)
+        throw std::runtime_error("Eigenvectors are not computed until finalize");
+    return *vectors_;
+}
+
+
+void RandomizedEigen::start_pass() {
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t c = 0; c < sketch_size_; c++)
+            y_(i, c) = 0;
+}
+
+
+void RandomizedEigen::add_marker(const HaplotypeDataRecord& record) {
+
+    const std::array<size_t, 2> dims { record.dims() };
+
+    if (dims[0] != n_samples_)
+        throw std::runtime_error("Record and sketch number of samples differ");
+
+    if (record.layout() != RecordLayout::sample_major)
+        throw std::runtime_error("Sketch requires sample major records");
+
+    if (k_founders_ != dims[1]) {
+        k_founders_ = dims[1];
+        w_ = std::make_unique<double[]>(k_founders_ * sketch_size_);
+    }
+
+    const double* xi { nullptr };
+    const double* qi { nullptr };
+    double* yi { nullptr };
+    double* wf { nullptr };
+    double xif { 0 };
+
+    // W = X^T Q, k_founders by sketch_size
+    for (size_t f = 0; f < k_founders_ * sketch_size_; f++)
+        w_[f] = 0;
+
+    for (size_t i = 0; i < n_samples_; i++) {
+        xi = &record(i, 0);
+        qi = &q_(i, 0);
+
+        for (size_t f = 0; f < k_founders_; f++) {
+            xif = xi[f];
+            if (xif == 0)
+                continue;
+
+            wf = &w_[f * sketch_size_];
+            for (size_t c = 0; c < sketch_size_; c++)
+                wf[c] += xif * qi[c];
+        }
+    }
+
+    // Y += X W
+    for (size_t i = 0; i < n_samples_; i++) {
+        xi = &record(i, 0);
+        yi = &y_(i, 0);
+
+        for (size_t f = 0; f < k_founders_; f++) {
+            xif = xi[f];
+            if (xif == 0)
+                continue;
+
+            wf = &w_[f * sketch_size_];
+            for (size_t c = 0; c < sketch_size_; c++)
+                yi[c] += xif * wf[c];
+        }
+    }
+}
+
+
+void RandomizedEigen::end_pass() {
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t c = 0; c < sketch_size_; c++)
+            q_(i, c) = y_(i, c);
+
+    orthonormalize_columns(q_);
+}
+
+
+void RandomizedEigen::finalize() {
+
+    // B = Q^T Y = Q^T G Q
+    Matrix b { sketch_size_, sketch_size_ };
+
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t r = 0; r < sketch_size_; r++)
+            for (size_t c = 0; c < sketch_size_; c++)
+                b(r, c) += q_(i, r) * y_(i, c);
+
+    // Y is only equal to G Q to rounding error, symmetrize
+    for (size_t r = 0; r < sketch_size_; r++)
+        for (size_t c = r + 1; c < sketch_size_; c++) {
+            b(r, c) = 0.5 * (b(r, c) + b(c, r));
+            b(c, r) = b(r, c);
+        }
+
+    Matrix v { sketch_size_, sketch_size_ };
+    std::vector<double> values;
+    symmetric_eigen(b, values, v);
+
+    values_.assign(values.begin(), values.begin() + rank_);
+    vectors_ = std::make_unique<Matrix>(n_samples_, rank_);
+
+    // U = Q V, with the sign fixed so that the largest magnitude
+    // element of each eigenvector is positive
+    for (size_t c = 0; c < rank_; c++) {
+
+        double largest { 0 };
+        for (size_t i = 0; i < n_samples_; i++) {
+            double sum { 0 };
+            for (size_t r = 0; r < sketch_size_; r++)
+                sum += q_(i, r) * v(r, c);
+
+            (*vectors_)(i, c) = sum;
+
+            if (std::fabs(sum) > std::fabs(largest))
+                largest = sum;
+        }
+
+        if (largest < 0)
+            for (size_t i = 0; i < n_samples_; i++)
+                (*vectors_)(i, c) = -(*vectors_)(i, c);
+    }
+}
@@ -0,0 +1,158 @@
+// Marker filters evaluated on the fixed VCF columns
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include "MarkerFilter.h"
+
+// VCF column indices, zero based
+const static size_t CHROM_COL { 0 };
+const static size_t POS_COL { 1 };
+const static size_t FILTER_COL { 6 };
+const static size_t INFO_COL { 7 };
+const static size_t N_FILTER_COLS { 8 };
+
+
+MarkerFilter::MarkerFilter() {};
+
+
+void MarkerFilter::every_nth(size_t n) {
+    if (n == 0)
+        throw std::runtime_error("Thinning interval must be at least 1");
+    every_nth_ = n;
+}
+
+
+void MarkerFilter::min_spacing(long bp) {
+    if (bp < 0)
+        throw std::runtime_error("Marker spacing must be non-negative");
+    min_spacing_ = bp;
+}
+
+
+void MarkerFilter::require_pass(bool require) { require_pass_ = require; }
+
+
+void MarkerFilter::min_info_score(double score) {
+    min_info_score_ = score;
+    use_info_score_ = true;
+}
+
+
+void MarkerFilter::eaf_range(double min_eaf, double max_eaf) {
+    if (min_eaf > max_eaf)
+        throw std::runtime_error("Minimum EAF must not exceed maximum EAF");
+    min_eaf_ = min_eaf;
+    max_eaf_ = max_eaf;
+    use_eaf_ = true;
+}
+
+
+bool MarkerFilter::active() const {
+    return every_nth_ > 1 || min_spacing_ > 0 || require_pass_
+        || use_info_score_ || use_eaf_;
+}
+
+
+bool MarkerFilter::sequential() const {
+    return every_nth_ > 1 || min_spacing_ > 0;
+}
+
+
+void MarkerFilter::restart() {
+    n_accepted_ = 0;
+    n_rejected_ = 0;
+    n_candidates_ = 0;
+    last_chrom_.clear();
+    last_pos_ = -1;
+}
+
+
+size_t MarkerFilter::n_accepted() const { return n_accepted_; }
+size_t MarkerFilter::n_rejected() const { return n_rejected_; }
+
+
+bool MarkerFilter::info_value(const char* info, size_t len,
+                              const char* key, double& value) {
+
+    const size_t key_len { std::strlen(key) };
+    size_t start { 0 };
+
+    for (size_t i = 0; i <= len; i++) {
+
+        if (i < len && info[i] != ';')
+            continue;
+
+        // entry spans [start, i)
+        if (i - start > key_len
+                && std::strncmp(info + start, key, key_len) == 0
+                && info[start + key_len] == '=') {
+            value = std::strtod(info + start + key_len + 1, nullptr);
+            return true;
+        }
+
+        start = i + 1;
+    }
+
+    return false;
+}
+
+
+bool MarkerFilter::accept(const char* line) {
+
+    // locate the start and length of each fixed column
+    const char* cols[N_FILTER_COLS] { nullptr };
+    size_t lens[N_FILTER_COLS] { 0 };
+
+    const char* p { line };
+    for (size_t i = 0; i < N_FILTER_COLS; i++) {
+        cols[i] = p;
+        while (*p != '\t' && *p != '\0' && *p != '\n')
+            p++;
+
+        lens[i] = p - cols[i];
+
+        if (*p != '\t')
+            throw std::runtime_error("Marker line has too few fixed columns");
+        p++;
+    }
+
+    bool pass { true };
+    double value { 0 };
+
+    if (require_pass_)
+        pass = lens[FILTER_COL] == std::strlen(PASS_VALUE)
+                && std::strncmp(cols[FILTER_COL], PASS_VALUE, lens[FILTER_COL]) == 0;
+
+    if (pass && use_info_score_)
+        pass = info_value(cols[INFO_COL], lens[INFO_COL], INFO_SCORE_KEY, value)
+                && value >= min_info_score_;
+
+    if (pass && use_eaf_)
+        pass = info_value(cols[INFO_COL], lens[INFO_COL], EAF_KEY, value)
+                && value >= min_eaf_ && value <= max_eaf_;
+
+    long pos { std::atol(cols[POS_COL]) };
+    bool same_chrom { last_chrom_.size() == lens[CHROM_COL]
+                        && last_chrom_.compare(0, lens[CHROM_COL],
+                                               cols[CHROM_COL], lens[CHROM_COL]) == 0 };
+
+    if (pass && min_spacing_ > 0 && same_chrom && last_pos_ >= 0)
+        pass = pos - last_pos_ >= min_spacing_;
+
+    if (pass && every_nth_ > 1)
+        pass = (n_candidates_++ % every_nth_) == 0;
+
+    if (!pass) {
+        n_rejected_++;
+        return false;
+    }
+
+    if (!same_chrom)
+        last_chrom_.assign(cols[CHROM_COL], lens[CHROM_COL]);
+    last_pos_ = pos;
+
+    n_accepted_++;
+    return true;
+}
@@ -13,27 +13,137 @@
 //
 //
 
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "Matrix.h"
 
+
+namespace {
+
+const size_t MAP_BYTES { size_t { 2 } << 20 };
+const size_t HUGE_PAGE_BYTES { size_t { 2 } << 20 };
+
+std::atomic<bool> huge_pages { false };
+
+}
+
+
+void Matrix::use_huge_pages(bool value) { huge_pages = value; }
+
+
+void Matrix::Storage::operator()(double* data) const {
+    if (mapped_bytes > 0)
+        munmap(reinterpret_cast<char*>(data) - map_offset, mapped_bytes);
+    else
+        delete[] data;
+}
+
+
+std::unique_ptr<double[], Matrix::Storage> Matrix::allocate_(size_t n) {
+
+    if (n == 0)
+        return std::unique_ptr<double[], Storage>(nullptr, Storage {});
+
+    if (n > SIZE_MAX / sizeof(double))
+        throw std::bad_alloc();
+
+    const size_t bytes { n * sizeof(double) };
+
+    // zero initialized by new[]
+    if (bytes < MAP_BYTES)
+        return std::unique_ptr<double[], Storage>(new double[n](), Storage {});
+
+    void* data { MAP_FAILED };
+    size_t mapped { bytes };
+
+#ifdef MAP_HUGETLB
+    if (huge_pages) {
+        mapped = (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+        data = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+
+    if (data == MAP_FAILED) {
+        mapped = bytes;
+        data = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (data == MAP_FAILED)
+            throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+        madvise(data, mapped, MADV_HUGEPAGE);
+#endif
+    }
+
+    return std::unique_ptr<double[], Storage>(static_cast<double*>(data),
+                                              Storage { mapped });
+}
+
+
 // default constructor
+//
+// The storage is zero when allocated, mapped pages are left untouched
+// so they are first written by the thread that uses them.
 Matrix::Matrix(size_t nrow, size_t mcol)
     : nrow_(nrow), mcol_(mcol), 
-    data_(nrow_ > 0 &&  mcol_ > 0 ? std::make_unique<double[]>(size()) : nullptr) {
+    data_(allocate_(size())) {
     
         if (nrow_ <= 0 || mcol_ <= 0)
             throw std::runtime_error("Matrix must have minimum size of 1");
-
-        // set default values to zero
-        for (size_t i = 0; i < size(); i++)
-            data_[i] = 0;
     };
 
 
+// mapped from a file
+//
+// The mapping starts at the page holding offset.
+Matrix::Matrix(size_t nrow, size_t mcol, int fd, size_t offset)
+    : nrow_(nrow), mcol_(mcol),
+    data_(nullptr, Storage {}) {
+
+        if (nrow_ <= 0 || mcol_ <= 0)
+            throw std::runtime_error("Matrix must have minimum size of 1");
+
+        if (size() > SIZE_MAX / sizeof(double))
+            throw std::bad_alloc();
+
+        const size_t page { static_cast<size_t>(sysconf(_SC_PAGESIZE)) };
+        const size_t map_offset { offset % page };
+        const size_t mapped { map_offset + size() * sizeof(double) };
+
+        void* data { mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          fd, offset - map_offset) };
+
+        if (data == MAP_FAILED)
+            throw std::runtime_error("Unable to map matrix file");
+
+        data_ = std::unique_ptr<double[], Storage>(
+                    reinterpret_cast<double*>(static_cast<char*>(data) + map_offset),
+                    Storage { mapped, map_offset, true });
+}
+
+
+void Matrix::sync() {
+    const Storage& storage { data_.get_deleter() };
+
+    if (!storage.file || !data_)
+        return;
+
+    if (msync(reinterpret_cast<char*>(data_.get()) - storage.map_offset,
+              storage.mapped_bytes, MS_SYNC) != 0)
+        throw std::runtime_error("Unable to write matrix file");
+}
+
+
 // copy constructor
 //
 Matrix::Matrix(const Matrix& other) 
     : nrow_(other.nrow_), mcol_(other.mcol_),
-    data_(std::make_unique<double[]>(other.size())) {
+    data_(allocate_(other.size())) {
 
         // Matrix values have already been validated
         for (size_t i = 0; i < size(); i++)
@@ -53,6 +163,10 @@ double& Matrix::operator()(const size_t& i, const size_t& j) {
     return data_[mat_idx_to_array_(i, j)];
 }
 
+double* Matrix::data() { return data_.get(); }
+const double* Matrix::data() const { return data_.get(); }
+
+
 std::array<size_t,2> Matrix::dims() const {
     return {nrow_, mcol_};
 }
@@ -0,0 +1,124 @@
+// Number of markers at which both samples of a pair were observed
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "PairCounts.h"
+
+
+PairCounts::PairCounts(size_t n_samples)
+    : n_samples_(n_samples), batch_(n_samples, 0) {};
+
+
+void PairCounts::add_marker(const HaplotypeDataRecord& record) {
+
+    if (record.dims()[0] != n_samples_)
+        throw std::runtime_error("Pair counts and record dimensions differ");
+
+    if (m_markers_ >= std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Too many markers for pair counts");
+
+    m_markers_++;
+
+    if (record.n_missing() == 0) {
+        complete_++;
+        return;
+    }
+
+    n_missing_ += record.n_missing();
+
+    // lazily allocated, only data sets with missing samples need it
+    if (partial_.empty())
+        partial_.assign(n_samples_ * n_samples_, 0);
+
+    const uint64_t* valid { record.valid_words() };
+    const uint64_t bit { uint64_t { 1 } << batch_size_ };
+
+    for (size_t i = 0; i < n_samples_; i++)
+        if ((valid[i / 64] >> (i % 64)) & 1)
+            batch_[i] |= bit;
+
+    if (++batch_size_ == 64)
+        flush_batch_();
+}
+
+
+void PairCounts::flush_batch_() {
+
+    uint64_t wi { 0 };
+    uint32_t* row { nullptr };
+
+    for (size_t i = 0; i < n_samples_; i++) {
+
+        wi = batch_[i];
+        row = &partial_[i * n_samples_];
+
+        for (size_t j = i; j < n_samples_; j++)
+            row[j] += __builtin_popcountll(wi & batch_[j]);
+    }
+
+    std::fill(batch_.begin(), batch_.end(), 0);
+    batch_size_ = 0;
+}
+
+
+void PairCounts::merge(const PairCounts& other) {
+
+    if (other.n_samples_ != n_samples_)
+        throw std::runtime_error("Pair counts dimensions differ");
+
+    m_markers_ += other.m_markers_;
+    n_missing_ += other.n_missing_;
+
+    if (!other.partial_.empty()) {
+        if (partial_.empty())
+            partial_.assign(n_samples_ * n_samples_, 0);
+
+        for (size_t i = 0; i < n_samples_; i++)
+            for (size_t j = i; j < n_samples_; j++)
+                partial_[i * n_samples_ + j] += other(i, j) - other.complete_;
+    }
+
+    complete_ += other.complete_;
+}
+
+
+size_t PairCounts::n_samples() const { return n_samples_; }
+size_t PairCounts::n_markers() const { return m_markers_; }
+size_t PairCounts::n_missing() const { return n_missing_; }
+
+
+size_t PairCounts::operator()(size_t i, size_t j) const {
+
+    if (i >= n_samples_ || j >= n_samples_)
+        throw std::out_of_range("Index is out of matrix range.");
+
+    if (i > j)
+        std::swap(i, j);
+
+    if (partial_.empty())
+        return complete_;
+
+    return complete_ + partial_[i * n_samples_ + j]
+            + __builtin_popcountll(batch_[i] & batch_[j]);
+}
+
+
+void PairCounts::normalize(Matrix& covariance) const {
+
+    if (covariance.dims()[0] != n_samples_ || covariance.dims()[1] != n_samples_)
+        throw std::runtime_error("Covariance and pair count dimensions differ");
+
+    size_t count { 0 };
+
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t j = i; j < n_samples_; j++) {
+            count = (*this)(i, j);
+            covariance(i, j) = count > 0 ? covariance(i, j) / count
+                                         : std::numeric_limits<double>::quiet_NaN();
+        }
+}
@@ -0,0 +1,128 @@
+// Founder pair state encoding of the haplotype dosages of a marker
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <cmath>
+#include <algorithm>
+#include "PairStates.h"
+
+
+PairStates::PairStates(size_t n_samples, size_t k_founders, double tolerance)
+    : n_samples_(n_samples), k_founders_(k_founders),
+        n_states_(k_founders * (k_founders + 1) / 2), tolerance_(tolerance),
+        state_index_(k_founders * k_founders, EXACT_STATE),
+        codes_(n_samples, EXACT_STATE), exact_offset_(n_samples, 0) {
+
+    if (tolerance < 0)
+        throw std::runtime_error("Pair state tolerance must not be negative");
+
+    if (k_founders == 0 || n_states_ >= EXACT_STATE)
+        throw std::runtime_error("Too many founders for pair state codes");
+
+    for (size_t a = 0; a < k_founders; a++)
+        for (size_t b = a; b < k_founders; b++) {
+            state_index_[a * k_founders + b] = state_a_.size();
+            state_index_[b * k_founders + a] = state_a_.size();
+            state_a_.push_back(a);
+            state_b_.push_back(b);
+        }
+
+    table_.resize(n_states_ * n_states_);
+
+    size_t a { 0 }, b { 0 }, c { 0 }, d { 0 };
+    for (size_t s = 0; s < n_states_; s++)
+        for (size_t t = 0; t < n_states_; t++) {
+            a = state_a_[s];
+            b = state_b_[s];
+            c = state_a_[t];
+            d = state_b_[t];
+            table_[s * n_states_ + t] = (a == c) + (a == d) + (b == c) + (b == d);
+        }
+};
+
+
+// The nearest state in Euclidean distance is built from the two largest
+// dosages: either the heterozygote of both or the homozygote of the
+// largest.  It is accepted when every dosage is within tolerance.
+PairCode PairStates::nearest_state_(const double* x) const {
+
+    size_t first { 0 };
+    size_t second { k_founders_ > 1 ? size_t { 1 } : size_t { 0 } };
+
+    if (x[second] > x[first])
+        std::swap(first, second);
+
+    for (size_t k = 2; k < k_founders_; k++) {
+        if (x[k] > x[first]) {
+            second = first;
+            first = k;
+        } else if (x[k] > x[second])
+            second = k;
+    }
+
+    // |x - s|^2 = |x|^2 - 2 x . s + |s|^2, |x|^2 is common to both
+    const double het { 2 - 2 * (x[first] + x[second]) };
+    const double hom { 4 - 4 * x[first] };
+
+    const size_t a { first };
+    const size_t b { (het < hom && first != second) ? second : first };
+
+    for (size_t k = 0; k < k_founders_; k++) {
+        double target { static_cast<double>((k == a) + (k == b)) };
+
+        if (std::fabs(x[k] - target) > tolerance_)
+            return EXACT_STATE;
+    }
+
+    return state_index_[a * k_founders_ + b];
+}
+
+
+void PairStates::assign(const HaplotypeDataRecord& record) {
+
+    if (record.dims()[0] != n_samples_ || record.dims()[1] != k_founders_)
+        throw std::runtime_error("Pair states and record dimensions differ");
+
+    if (record.layout() != RecordLayout::sample_major)
+        throw std::runtime_error("Pair states require sample major records");
+
+    exact_values_.clear();
+
+    const double* row { nullptr };
+    for (size_t i = 0; i < n_samples_; i++) {
+
+        row = &record(i, 0);
+        codes_[i] = nearest_state_(row);
+
+        if (codes_[i] != EXACT_STATE)
+            continue;
+
+        exact_offset_[i] = exact_values_.size();
+        exact_values_.insert(exact_values_.end(), row, row + k_founders_);
+    }
+}
+
+
+size_t PairStates::n_samples() const { return n_samples_; }
+size_t PairStates::k_founders() const { return k_founders_; }
+size_t PairStates::n_states() const { return n_states_; }
+double PairStates::tolerance() const { return tolerance_; }
+size_t PairStates::n_exact() const { return exact_values_.size() / k_founders_; }
+const PairCode* PairStates::codes() const { return codes_.data(); }
+size_t PairStates::state_a(PairCode s) const { return state_a_[s]; }
+size_t PairStates::state_b(PairCode s) const { return state_b_[s]; }
+const uint8_t* PairStates::table() const { return table_.data(); }
+
+
+PairCode PairStates::state(size_t a, size_t b) const {
+    if (a >= k_founders_ || b >= k_founders_)
+        throw std::out_of_range("Founder index out of range");
+    return state_index_[a * k_founders_ + b];
+}
+
+
+const double* PairStates::exact(size_t i) const {
+    return &exact_values_[exact_offset_[i]];
+}
@@ -0,0 +1,224 @@
+// Run time instrumentation of the hgrm phases
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <ctime>
+#include <stdexcept>
+#include <sys/resource.h>
+#include "Profiler.h"
+
+
+const char* phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::read: return "read";
+        case Phase::tokenize: return "tokenize";
+        case Phase::parse: return "parse";
+        case Phase::accumulate: return "accumulate";
+        case Phase::write: return "write";
+    }
+    return "unknown";
+}
+
+
+double thread_cpu_seconds() {
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+PhaseCounters::PhaseCounters(const std::string& name)
+    : name_(name), wall_start_(std::chrono::steady_clock::now()) {};
+
+
+void PhaseCounters::add(Phase phase, std::chrono::steady_clock::duration dt,
+                        size_t bytes, size_t markers) {
+    PhaseStats& s { stats_[static_cast<size_t>(phase)] };
+    s.seconds += std::chrono::duration<double>(dt).count();
+    s.bytes += bytes;
+    s.markers += markers;
+    s.calls++;
+}
+
+
+const PhaseStats& PhaseCounters::stats(Phase phase) const {
+    return stats_[static_cast<size_t>(phase)];
+}
+
+
+const std::string& PhaseCounters::name() const { return name_; }
+
+
+void PhaseCounters::start() {
+    wall_start_ = std::chrono::steady_clock::now();
+    cpu_start_ = thread_cpu_seconds();
+}
+
+
+void PhaseCounters::stop() {
+    wall_seconds_ = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - wall_start_).count();
+    cpu_seconds_ = thread_cpu_seconds() - cpu_start_;
+}
+
+
+double PhaseCounters::wall_seconds() const { return wall_seconds_; }
+double PhaseCounters::cpu_seconds() const { return cpu_seconds_; }
+
+
+ScopedPhase::ScopedPhase(PhaseCounters* counters, Phase phase)
+    : counters_(counters), phase_(phase) {
+    if (counters_)
+        start_ = std::chrono::steady_clock::now();
+}
+
+
+ScopedPhase::~ScopedPhase() {
+    if (counters_)
+        counters_->add(phase_, std::chrono::steady_clock::now() - start_,
+                       bytes_, markers_);
+}
+
+
+void ScopedPhase::add_bytes(size_t n) { bytes_ += n; }
+void ScopedPhase::add_markers(size_t n) { markers_ += n; }
+
+
+Profiler::Profiler() : start_(std::chrono::steady_clock::now()) {};
+
+
+PhaseCounters* Profiler::register_thread(const std::string& name) {
+    std::lock_guard<std::mutex> lock { mutex_ };
+    threads_.push_back(std::make_unique<PhaseCounters>(name));
+    threads_.back()->start();
+    return threads_.back().get();
+}
+
+
+PhaseStats Profiler::total(Phase phase) const {
+    std::lock_guard<std::mutex> lock { mutex_ };
+
+    PhaseStats sum;
+    for (const auto& t : threads_) {
+        const PhaseStats& s { t->stats(phase) };
+        sum.seconds += s.seconds;
+        sum.bytes += s.bytes;
+        sum.markers += s.markers;
+        sum.calls += s.calls;
+    }
+
+    return sum;
+}
+
+
+double Profiler::wall_seconds() const {
+    return std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_).count();
+}
+
+
+long Profiler::peak_rss_kb() {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+
+    // kilobytes on Linux
+    return usage.ru_maxrss;
+}
+
+
+void Profiler::write_json(const char* filename,
+                          const std::vector<std::pair<std::string, std::string>>& extra) const {
+
+    FILE* fout { std::fopen(filename, "w") };
+
+    if (!fout)
+        throw std::runtime_error("Error in opening file for writing.");
+
+    const double wall { wall_seconds() };
+
+    std::fprintf(fout, "{\n");
+
+    for (const auto& kv : extra)
+        std::fprintf(fout, "  \"%s\": %s,\n", kv.first.c_str(), kv.second.c_str());
+
+    std::fprintf(fout, "  \"wall_seconds\": %.6f,\n", wall);
+    std::fprintf(fout, "  \"peak_rss_kb\": %ld,\n", peak_rss_kb());
+
+    std::fprintf(fout, "  \"phases\": {\n");
+    for (size_t p = 0; p < N_PHASES; p++) {
+        const Phase phase { static_cast<Phase>(p) };
+        const PhaseStats s { total(phase) };
+
+        std::fprintf(fout, "    \"%s\": { \"seconds\": %.6f, \"bytes\": %zu, "
+                           "\"markers\": %zu, \"calls\": %zu, "
+                           "\"bytes_per_second\": %.1f, \"markers_per_second\": %.1f }%s\n",
+                     phase_name(phase), s.seconds, s.bytes, s.markers, s.calls,
+                     s.seconds > 0 ? s.bytes / s.seconds : 0,
+                     s.seconds > 0 ? s.markers / s.seconds : 0,
+                     p + 1 < N_PHASES ? "," : "");
+    }
+    std::fprintf(fout, "  },\n");
+
+    std::lock_guard<std::mutex> lock { mutex_ };
+
+    std::fprintf(fout, "  \"threads\": [\n");
+    for (size_t i = 0; i < threads_.size(); i++) {
+        const PhaseCounters& t { *threads_[i] };
+
+        std::fprintf(fout, "    { \"name\": \"%s\", \"wall_seconds\": %.6f, "
+                           "\"cpu_seconds\": %.6f, \"utilization\": %.4f }%s\n",
+                     t.name().c_str(), t.wall_seconds(), t.cpu_seconds(),
+                     t.wall_seconds() > 0 ? t.cpu_seconds() / t.wall_seconds() : 0,
+                     i + 1 < threads_.size() ? "," : "");
+    }
+    std::fprintf(fout, "  ]\n}\n");
+
+    std::fclose(fout);
+}
+
+
+ProgressReporter::ProgressReporter(size_t total_bytes, size_t marker_interval)
+    : total_bytes_(total_bytes),
+        marker_interval_(marker_interval > 0 ? marker_interval : 1),
+        next_report_(marker_interval_),
+        start_(std::chrono::steady_clock::now()) {};
+
+
+void ProgressReporter::update(size_t m_markers, size_t bytes_done) {
+
+    if (m_markers < next_report_)
+        return;
+
+    std::lock_guard<std::mutex> lock { mutex_ };
+
+    // another thread reported this interval
+    if (m_markers < next_report_)
+        return;
+
+    next_report_.store((m_markers / marker_interval_ + 1) * marker_interval_);
+
+    const double elapsed { std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start_).count() };
+
+    if (total_bytes_ == 0 || bytes_done == 0) {
+        std::fprintf(stderr, "Completed %zu marker loci, elapsed time %lld second(s)\n",
+                     m_markers, static_cast<long long>(elapsed));
+        return;
+    }
+
+    const double fraction { static_cast<double>(bytes_done) / total_bytes_ };
+
+    std::fprintf(stderr, "Completed %zu marker loci, %.1f%% of input, "
+                         "elapsed time %lld second(s), remaining %lld second(s)\n",
+                 m_markers, 100 * fraction, static_cast<long long>(elapsed),
+                 static_cast<long long>(fraction < 1 ? elapsed * (1 - fraction) / fraction : 0));
+}
+
+
+void ProgressReporter::add(size_t markers, size_t bytes) {
+    update(markers_done_ += markers, bytes_done_ += bytes);
+}
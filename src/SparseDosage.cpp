@@ -0,0 +1,94 @@
+// Sparse representation of the haplotype dosages of a marker
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <cmath>
+#include <algorithm>
+#include "SparseDosage.h"
+
+
+SparseDosage::SparseDosage(size_t n_samples, size_t k_founders, double epsilon)
+    : n_samples_(n_samples), k_founders_(k_founders), epsilon_(epsilon),
+        founder_start_(k_founders + 1, 0), sample_start_(n_samples + 1, 0),
+        fill_(k_founders, 0) {
+
+    if (epsilon < 0)
+        throw std::runtime_error("Sparse dosage epsilon must not be negative");
+
+    // room for two haplotypes per sample without reallocation
+    founder_samples_.reserve(2 * n_samples);
+    founder_values_.reserve(2 * n_samples);
+    sample_founders_.reserve(2 * n_samples);
+    sample_values_.reserve(2 * n_samples);
+};
+
+
+void SparseDosage::assign(const HaplotypeDataRecord& record) {
+
+    if (record.dims()[0] != n_samples_ || record.dims()[1] != k_founders_)
+        throw std::runtime_error("Sparse dosage and record dimensions differ");
+
+    if (record.layout() != RecordLayout::sample_major)
+        throw std::runtime_error("Sparse dosage requires sample major records");
+
+    sample_founders_.clear();
+    sample_values_.clear();
+    std::fill(founder_start_.begin(), founder_start_.end(), 0);
+
+    // by sample, and count the entries of each founder
+    const double* row { nullptr };
+    for (size_t i = 0; i < n_samples_; i++) {
+
+        sample_start_[i] = sample_founders_.size();
+        row = &record(i, 0);
+
+        for (size_t k = 0; k < k_founders_; k++) {
+            if (std::fabs(row[k]) <= epsilon_ || row[k] == 0)
+                continue;
+
+            sample_founders_.push_back(k);
+            sample_values_.push_back(row[k]);
+            founder_start_[k + 1]++;
+        }
+    }
+    sample_start_[n_samples_] = sample_founders_.size();
+
+    for (size_t k = 0; k < k_founders_; k++)
+        founder_start_[k + 1] += founder_start_[k];
+
+    // by founder, samples are visited in order so each list is sorted
+    founder_samples_.resize(sample_founders_.size());
+    founder_values_.resize(sample_founders_.size());
+    std::copy(founder_start_.begin(), founder_start_.end() - 1, fill_.begin());
+
+    size_t pos { 0 };
+    for (size_t i = 0; i < n_samples_; i++)
+        for (size_t e = sample_start_[i]; e < sample_start_[i + 1]; e++) {
+            pos = fill_[sample_founders_[e]]++;
+            founder_samples_[pos] = i;
+            founder_values_[pos] = sample_values_[e];
+        }
+}
+
+
+size_t SparseDosage::n_samples() const { return n_samples_; }
+size_t SparseDosage::k_founders() const { return k_founders_; }
+double SparseDosage::epsilon() const { return epsilon_; }
+size_t SparseDosage::n_nonzero() const { return sample_founders_.size(); }
+
+
+double SparseDosage::density() const {
+    if (n_samples_ == 0 || k_founders_ == 0)
+        return 0;
+    return static_cast<double>(n_nonzero()) / (n_samples_ * k_founders_);
+}
+
+
+const size_t* SparseDosage::founder_start() const { return founder_start_.data(); }
+const size_t* SparseDosage::founder_samples() const { return founder_samples_.data(); }
+const double* SparseDosage::founder_values() const { return founder_values_.data(); }
+const size_t* SparseDosage::sample_start() const { return sample_start_.data(); }
+const size_t* SparseDosage::sample_founders() const { return sample_founders_.data(); }
+const double* SparseDosage::sample_values() const { return sample_values_.data(); }
@@ -0,0 +1,387 @@
+// Sequential file reads kept in flight with io_uring
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "UringReader.h"
+
+
+namespace {
+
+const size_t DIRECT_ALIGNMENT { 4096 };
+const size_t MAX_QUEUE_DEPTH { 4096 };
+
+
+int uring_setup(unsigned entries, io_uring_params& params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+
+int uring_enter(int ring, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring, to_submit, min_complete,
+                                    flags, nullptr, 0));
+}
+
+
+// the kernel supports IORING_OP_READ, added in Linux 5.6
+bool supports_read(int ring) {
+    const size_t n_ops { 256 };
+    std::vector<char> memory(sizeof(io_uring_probe) + n_ops * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe { reinterpret_cast<io_uring_probe*>(memory.data()) };
+
+    if (syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, n_ops) < 0)
+        return false;
+
+    return probe->last_op >= IORING_OP_READ
+            && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+}
+
+}
+
+
+bool UringReader::available() {
+    static const bool is_available { [] {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        int ring { uring_setup(1, params) };
+        if (ring < 0)
+            return false;
+
+        bool read { supports_read(ring) };
+        close(ring);
+        return read;
+    }() };
+
+    return is_available;
+}
+
+
+UringReader::UringReader(const char* filename, const UringOptions& options)
+    : options_(options) {
+
+    if (options_.queue_depth == 0 || options_.queue_depth > MAX_QUEUE_DEPTH)
+        throw std::runtime_error("Queue depth must be between 1 and 4096");
+
+    if (options_.block_size == 0 || options_.block_size % DIRECT_ALIGNMENT != 0)
+        throw std::runtime_error("Read block size must be a multiple of 4096 bytes");
+
+    if (options_.direct) {
+        file_ = open(filename, O_RDONLY | O_DIRECT);
+        direct_ = file_ >= 0;
+    }
+
+    // file systems without O_DIRECT are read through the page cache
+    if (file_ < 0)
+        file_ = open(filename, O_RDONLY);
+
+    if (file_ < 0)
+        throw std::runtime_error("File Access error");
+
+    struct stat st;
+    if (fstat(file_, &st) != 0) {
+        close_();
+        throw std::runtime_error("File Access error");
+    }
+    file_size_ = st.st_size;
+
+    try {
+        setup_ring_();
+    } catch (...) {
+        close_();
+        throw;
+    }
+
+    const size_t bytes { options_.queue_depth * options_.block_size };
+    memory_ = std::unique_ptr<char, void(*)(void*)>(
+                static_cast<char*>(std::aligned_alloc(DIRECT_ALIGNMENT, bytes)), std::free);
+
+    if (!memory_) {
+        close_();
+        throw std::bad_alloc();
+    }
+
+    blocks_.resize(options_.queue_depth);
+    for (size_t b = 0; b < blocks_.size(); b++)
+        blocks_[b].data = memory_.get() + b * options_.block_size;
+
+    seek(0);
+}
+
+
+UringReader::~UringReader() {
+    // the kernel may write the buffers until the reads complete
+    try {
+        while (n_in_flight_ > 0)
+            wait_();
+    } catch (...) {}
+
+    close_();
+}
+
+
+void UringReader::setup_ring_() {
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    ring_ = uring_setup(options_.queue_depth, params);
+
+    if (ring_ < 0)
+        throw std::runtime_error("io_uring is not available");
+
+    if (!supports_read(ring_))
+        throw std::runtime_error("io_uring does not support reads");
+
+    sq_ring_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+
+    const bool single_mmap { (params.features & IORING_FEAT_SINGLE_MMAP) != 0 };
+
+    if (single_mmap)
+        sq_ring_bytes_ = cq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+
+    sq_ring_ = mmap(nullptr, sq_ring_bytes_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        throw std::runtime_error("Unable to map io_uring submission queue");
+    }
+
+    if (single_mmap)
+        cq_ring_ = sq_ring_;
+    else {
+        cq_ring_ = mmap(nullptr, cq_ring_bytes_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            throw std::runtime_error("Unable to map io_uring completion queue");
+        }
+    }
+
+    sqes_ = mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+        sqes_ = nullptr;
+        throw std::runtime_error("Unable to map io_uring submission entries");
+    }
+
+    char* sq { static_cast<char*>(sq_ring_) };
+    char* cq { static_cast<char*>(cq_ring_) };
+
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+}
+
+
+void UringReader::close_() {
+    if (sqes_ != nullptr)
+        munmap(sqes_, sqes_bytes_);
+
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+        munmap(cq_ring_, cq_ring_bytes_);
+
+    if (sq_ring_ != nullptr)
+        munmap(sq_ring_, sq_ring_bytes_);
+
+    sqes_ = cq_ring_ = sq_ring_ = nullptr;
+
+    if (ring_ >= 0)
+        close(ring_);
+
+    if (file_ >= 0)
+        close(file_);
+
+    ring_ = file_ = -1;
+}
+
+
+void UringReader::submit_(Block& block, size_t block_number) {
+
+    block.number = block_number;
+    block.offset = block_number * options_.block_size;
+    block.length = 0;
+    block.in_flight = true;
+
+    // the only producer, so the tail is ours to read
+    const unsigned tail { *sq_tail_ };
+    const unsigned index { tail & *sq_mask_ };
+
+    io_uring_sqe* sqe { static_cast<io_uring_sqe*>(sqes_) + index };
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = file_;
+    sqe->addr = reinterpret_cast<uint64_t>(block.data);
+    sqe->len = options_.block_size;
+    sqe->off = block.offset;
+    sqe->user_data = &block - blocks_.data();
+
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted { 0 };
+    while ((submitted = uring_enter(ring_, 1, 0, 0)) < 0 && errno == EINTR);
+
+    if (submitted != 1) {
+        block.in_flight = false;
+        throw std::runtime_error("io_uring read could not be submitted");
+    }
+
+    n_in_flight_++;
+}
+
+
+// wait for at least one read and process every completion
+void UringReader::wait_() {
+
+    unsigned head { *cq_head_ };
+    unsigned tail { __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) };
+
+    while (head == tail) {
+        if (uring_enter(ring_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            throw std::runtime_error("Waiting for io_uring reads failed");
+
+        tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    }
+
+    const io_uring_cqe* cqes { static_cast<const io_uring_cqe*>(cqes_) };
+    std::vector<std::pair<size_t, long>> completed;
+
+    for (; head != tail; head++) {
+        const io_uring_cqe& cqe { cqes[head & *cq_mask_] };
+        completed.push_back({ cqe.user_data, cqe.res });
+    }
+
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    for (const auto& [b, result] : completed)
+        complete_(blocks_.at(b), result);
+}
+
+
+void UringReader::complete_(Block& block, long result) {
+
+    block.in_flight = false;
+    n_in_flight_--;
+
+    if (result < 0)
+        throw std::runtime_error(std::string("File read error: ") + std::strerror(-result));
+
+    block.length = result;
+
+    // short reads before the end of the file are completed in place.
+    // O_DIRECT reads must start at an aligned offset, so the remainder
+    // is read from the last aligned position, reading the overlap again.
+    ssize_t n { 0 };
+    size_t start { 0 };
+
+    while (block.length < options_.block_size
+            && block.offset + block.length < file_size_) {
+
+        start = direct_ ? block.length / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT : block.length;
+
+        n = pread(file_, block.data + start, options_.block_size - start,
+                  block.offset + start);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0 || start + n <= block.length)
+            throw std::runtime_error("File read error");
+
+        block.length = start + n;
+    }
+}
+
+
+void UringReader::seek(size_t offset, size_t readahead_end) {
+
+    while (n_in_flight_ > 0)
+        wait_();
+
+    current_block_ = offset / options_.block_size;
+    block_pos_ = offset % options_.block_size;
+    next_block_ = current_block_;
+    readahead_end_ = std::min(readahead_end, file_size_);
+
+    for (Block& block : blocks_) {
+        block.number = SIZE_MAX;
+        block.length = 0;
+    }
+
+    request_ahead_();
+}
+
+
+// keep up to queue_depth blocks requested, up to the read ahead end
+void UringReader::request_ahead_() {
+    while (next_block_ < current_block_ + blocks_.size()
+            && next_block_ * options_.block_size < readahead_end_) {
+        submit_(blocks_[next_block_ % blocks_.size()], next_block_);
+        next_block_++;
+    }
+}
+
+
+size_t UringReader::read(char* dst, size_t n) {
+
+    while (current_block_ * options_.block_size < file_size_) {
+
+        Block& block { blocks_[current_block_ % blocks_.size()] };
+
+        // past the read ahead end blocks are requested when needed
+        if (block.number != current_block_) {
+            while (block.in_flight)
+                wait_();
+
+            submit_(block, current_block_);
+            next_block_ = std::max(next_block_, current_block_ + 1);
+        }
+
+        while (block.in_flight)
+            wait_();
+
+        if (block_pos_ < block.length) {
+            const size_t count { std::min(n, block.length - block_pos_) };
+            std::memcpy(dst, block.data + block_pos_, count);
+            block_pos_ += count;
+            return count;
+        }
+
+        // a short block is the last of the file
+        if (block.length < options_.block_size)
+            return 0;
+
+        // the block is consumed, reuse it for the next request
+        current_block_++;
+        block_pos_ = 0;
+        request_ahead_();
+    }
+
+    return 0;
+}
+
+
+size_t UringReader::file_size() const { return file_size_; }
+bool UringReader::direct() const { return direct_; }
@@ -0,0 +1,295 @@
+// Simulated STITCH style haplotype dosage VCFs
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "VcfSimulator.h"
+
+const static size_t OUTPUT_BUFFER_SIZE { 1 << 22 };
+const static size_t MAX_NUMBER_CHARS { 32 };
+
+
+namespace {
+
+size_t format_uint(char* buf, uint64_t x) {
+    char digits[MAX_NUMBER_CHARS];
+    size_t n { 0 };
+
+    do {
+        digits[n++] = '0' + x % 10;
+        x /= 10;
+    } while (x > 0);
+
+    for (size_t i = 0; i < n; i++)
+        buf[i] = digits[n - 1 - i];
+
+    return n;
+}
+
+
+// Non-negative number rounded to three decimals, without trailing
+// zeros, e.g. 1, 0.5, 0.989
+size_t format_fixed3(char* buf, double x) {
+    uint64_t v { static_cast<uint64_t>(std::llround(x > 0 ? x * 1000 : 0)) };
+    size_t n { format_uint(buf, v / 1000) };
+
+    uint64_t frac { v % 1000 };
+    if (frac == 0)
+        return n;
+
+    buf[n++] = '.';
+    buf[n++] = '0' + frac / 100;
+    if (frac % 100 == 0)
+        return n;
+
+    buf[n++] = '0' + (frac / 10) % 10;
+    if (frac % 10 == 0)
+        return n;
+
+    buf[n++] = '0' + frac % 10;
+    return n;
+}
+
+}
+
+
+VcfSimulator::VcfSimulator(const SimulationParams& params)
+    : params_(params),
+        rng_(params.seed),
+        block_(params.block_length >= 1 ? 1 / params.block_length : 1),
+        founder_(2 * params.n_samples),
+        next_break_(2 * params.n_samples),
+        hd_(params.n_samples * params.k_founders),
+        hd_text_(params.n_samples),
+        ds_(params.n_samples),
+        alleles_(params.k_founders),
+        out_(OUTPUT_BUFFER_SIZE) {
+
+    if (params_.n_samples == 0 || params_.k_founders == 0)
+        throw std::runtime_error("Simulation must have more than zero samples and founders");
+
+    if (params_.block_length < 1)
+        throw std::runtime_error("Mean block length must be at least one marker");
+
+    if (params_.noise < 0 || params_.noise > 1)
+        throw std::runtime_error("Noise must be between 0 and 1");
+
+    if (params_.spacing < 1)
+        throw std::runtime_error("Marker spacing must be at least 1 bp");
+
+    std::uniform_int_distribution<size_t> founder { 0, params_.k_founders - 1 };
+
+    for (size_t h = 0; h < founder_.size(); h++) {
+        founder_[h] = founder(rng_);
+        next_break_[h] = 1 + block_(rng_);
+    }
+
+    for (size_t i = 0; i < params_.n_samples; i++)
+        new_block_(i);
+}
+
+
+size_t VcfSimulator::bytes_written() const { return bytes_written_; }
+
+
+void VcfSimulator::new_block_(size_t sample) {
+
+    const size_t k { params_.k_founders };
+    double* hd { &hd_[sample * k] };
+
+    double total { 0 };
+    for (size_t f = 0; f < k; f++) {
+        hd[f] = unif_(rng_);
+        total += hd[f];
+    }
+
+    for (size_t f = 0; f < k; f++) {
+        hd[f] = params_.noise * 2 * hd[f] / total;
+        hd[f] += (1 - params_.noise) * ((founder_[2 * sample] == f)
+                                        + (founder_[2 * sample + 1] == f));
+    }
+
+    char buf[MAX_NUMBER_CHARS];
+    std::string& text { hd_text_[sample] };
+    text.clear();
+
+    for (size_t f = 0; f < k; f++) {
+        if (f > 0)
+            text.push_back(',');
+        text.append(buf, format_fixed3(buf, hd[f]));
+    }
+}
+
+
+void VcfSimulator::put_(char c) {
+    if (out_pos_ == out_.size())
+        flush_();
+    out_[out_pos_++] = c;
+}
+
+
+void VcfSimulator::put_(const char* s, size_t n) {
+    if (out_pos_ + n > out_.size())
+        flush_();
+
+    if (n > out_.size()) {
+        std::fwrite(s, 1, n, fout_);
+        bytes_written_ += n;
+        return;
+    }
+
+    std::memcpy(&out_[out_pos_], s, n);
+    out_pos_ += n;
+}
+
+
+void VcfSimulator::put_(const std::string& s) { put_(s.data(), s.size()); }
+
+
+void VcfSimulator::flush_() {
+    if (out_pos_ == 0)
+        return;
+
+    if (std::fwrite(out_.data(), 1, out_pos_, fout_) != out_pos_)
+        throw std::runtime_error("Error writing simulated VCF");
+
+    bytes_written_ += out_pos_;
+    out_pos_ = 0;
+}
+
+
+void VcfSimulator::write_header_() {
+    char buf[256];
+
+    put_(std::string("##fileformat=VCFv4.2\n"
+                     "##source=hgrm_simulate\n"
+                     "##FILTER=<ID=PASS,Description=\"All filters passed\">\n"
+                     "##INFO=<ID=INFO_SCORE,Number=.,Type=Float,Description=\"Info score\">\n"
+                     "##INFO=<ID=EAF,Number=.,Type=Float,Description=\"Estimated allele frequency\">\n"
+                     "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Best Guessed Genotype\">\n"
+                     "##FORMAT=<ID=GP,Number=3,Type=Float,Description=\"Posterior genotype probability of 0/0, 0/1, and 1/1\">\n"
+                     "##FORMAT=<ID=DS,Number=1,Type=Float,Description=\"Dosage\">\n"));
+
+    std::snprintf(buf, sizeof(buf),
+                  "##FORMAT=<ID=HD,Number=%zu,Type=Float,Description=\"Ancestral haplotype dosages for one through K haplotypes\">\n"
+                  "##contig=<ID=%s>\n",
+                  params_.k_founders, params_.chrom.c_str());
+    put_(buf, std::strlen(buf));
+
+    put_(std::string("#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT"));
+
+    for (size_t i = 0; i < params_.n_samples; i++) {
+        std::snprintf(buf, sizeof(buf), "\tS%06zu", i + 1);
+        put_(buf, std::strlen(buf));
+    }
+
+    put_('\n');
+}
+
+
+void VcfSimulator::write_marker_(size_t marker, long pos) {
+
+    const size_t n { params_.n_samples };
+    const size_t k { params_.k_founders };
+    std::uniform_int_distribution<size_t> founder { 0, k - 1 };
+
+    // recombination breakpoints
+    for (size_t h = 0; h < founder_.size(); h++) {
+        if (marker < next_break_[h])
+            continue;
+
+        founder_[h] = founder(rng_);
+        next_break_[h] = marker + 1 + block_(rng_);
+        new_block_(h / 2);
+    }
+
+    // founder alleles, with a random alternate allele frequency
+    const double alt_freq { 0.05 + 0.9 * unif_(rng_) };
+    for (size_t f = 0; f < k; f++)
+        alleles_[f] = unif_(rng_) < alt_freq;
+
+    double ds_sum { 0 };
+    for (size_t i = 0; i < n; i++) {
+        ds_[i] = 0;
+        for (size_t f = 0; f < k; f++)
+            ds_[i] += alleles_[f] ? hd_[i * k + f] : 0;
+
+        ds_sum += ds_[i];
+    }
+
+    char buf[256];
+    size_t len { 0 };
+
+    len = std::snprintf(buf, sizeof(buf),
+                        "%s\t%ld\t.\tA\tG\t.\tPASS\tEAF=%.5f;INFO_SCORE=%.5f\tGT:GP:DS:HD",
+                        params_.chrom.c_str(), pos, ds_sum / (2 * n),
+                        1 - params_.noise * unif_(rng_));
+    put_(buf, len);
+
+    double p { 0 };
+    double gp[3];
+    for (size_t i = 0; i < n; i++) {
+
+        p = std::min(std::max(ds_[i] / 2, 0.0), 1.0);
+        gp[0] = (1 - p) * (1 - p);
+        gp[1] = 2 * p * (1 - p);
+        gp[2] = p * p;
+
+        if (gp[0] >= gp[1] && gp[0] >= gp[2])
+            put_("\t0/0:", 5);
+        else if (gp[1] >= gp[2])
+            put_("\t0/1:", 5);
+        else
+            put_("\t1/1:", 5);
+
+        len = format_fixed3(buf, gp[0]);
+        buf[len++] = ',';
+        len += format_fixed3(buf + len, gp[1]);
+        buf[len++] = ',';
+        len += format_fixed3(buf + len, gp[2]);
+        buf[len++] = ':';
+        len += format_fixed3(buf + len, ds_[i]);
+        buf[len++] = ':';
+        put_(buf, len);
+
+        put_(hd_text_[i]);
+    }
+
+    put_('\n');
+}
+
+
+void VcfSimulator::write(FILE* fout) {
+
+    fout_ = fout;
+    write_header_();
+
+    std::uniform_int_distribution<long> gap { 1, 2 * params_.spacing - 1 };
+    long pos { 0 };
+
+    for (size_t marker = 0; marker < params_.n_markers; marker++) {
+        pos += gap(rng_);
+        write_marker_(marker, pos);
+    }
+
+    flush_();
+    fout_ = nullptr;
+}
+
+
+void write_simulated_vcf(const char* filename, const SimulationParams& params) {
+
+    FILE* fout { std::fopen(filename, "w") };
+
+    if (!fout)
+        throw std::runtime_error("Error in opening file for writing.");
+
+    VcfSimulator simulator { params };
+    simulator.write(fout);
+
+    std::fclose(fout);
+}
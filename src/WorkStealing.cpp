@@ -0,0 +1,218 @@
+// Work stealing over chunks of VCF files
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "WorkStealing.h"
+
+
+std::vector<VcfChunk> split_vcf_chunks(const std::vector<size_t>& data_offsets,
+                                       const std::vector<size_t>& file_sizes,
+                                       size_t chunk_bytes) {
+
+    if (data_offsets.size() != file_sizes.size())
+        throw std::runtime_error("Number of data offsets and file sizes differ");
+
+    std::vector<VcfChunk> chunks;
+
+    for (size_t f = 0; f < file_sizes.size(); f++) {
+
+        const size_t begin { data_offsets[f] };
+        const size_t end { file_sizes[f] };
+
+        if (chunk_bytes == 0 || end <= begin + chunk_bytes) {
+            chunks.push_back({ f, begin, end });
+            continue;
+        }
+
+        for (size_t b = begin; b < end; b += chunk_bytes)
+            chunks.push_back({ f, b, std::min(b + chunk_bytes, end) });
+    }
+
+    return chunks;
+}
+
+
+WorkStealingScheduler::WorkStealingScheduler(size_t n_workers, size_t n_tasks) {
+
+    if (n_workers == 0)
+        throw std::runtime_error("Scheduler requires at least one worker");
+
+    for (size_t w = 0; w < n_workers; w++)
+        queues_.push_back(std::make_unique<TaskQueue>());
+
+    // contiguous blocks, worker w starts with tasks [w n / W, (w + 1) n / W)
+    for (size_t w = 0; w < n_workers; w++)
+        for (size_t t = w * n_tasks / n_workers; t < (w + 1) * n_tasks / n_workers; t++)
+            queues_[w]->tasks.push_back(t);
+}
+
+
+bool WorkStealingScheduler::next(size_t worker, size_t& task) {
+
+    TaskQueue& own { *queues_.at(worker) };
+
+    {
+        std::lock_guard<std::mutex> lock { own.mutex };
+
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return steal_(worker, task);
+}
+
+
+bool WorkStealingScheduler::steal_(size_t worker, size_t& task) {
+
+    while (true) {
+
+        // the longest queue, its size may change before it is locked
+        size_t victim { worker };
+        size_t longest { 0 };
+
+        for (size_t w = 0; w < queues_.size(); w++) {
+            if (w == worker)
+                continue;
+
+            std::lock_guard<std::mutex> lock { queues_[w]->mutex };
+            if (queues_[w]->tasks.size() > longest) {
+                longest = queues_[w]->tasks.size();
+                victim = w;
+            }
+        }
+
+        if (longest == 0)
+            return false;
+
+        std::lock_guard<std::mutex> lock { queues_[victim]->mutex };
+
+        if (queues_[victim]->tasks.empty())
+            continue;
+
+        task = queues_[victim]->tasks.back();
+        queues_[victim]->tasks.pop_back();
+        n_steals_++;
+        return true;
+    }
+}
+
+
+size_t WorkStealingScheduler::n_workers() const { return queues_.size(); }
+size_t WorkStealingScheduler::n_steals() const { return n_steals_; }
+
+
+Barrier::Barrier(size_t n_threads) : n_threads_(n_threads) {
+    if (n_threads_ == 0)
+        throw std::runtime_error("Barrier requires at least one thread");
+
+    pthread_mutex_init(&mutex_, nullptr);
+    pthread_cond_init(&arrived_, nullptr);
+}
+
+
+Barrier::~Barrier() {
+    pthread_cond_destroy(&arrived_);
+    pthread_mutex_destroy(&mutex_);
+}
+
+
+bool Barrier::wait() {
+    pthread_mutex_lock(&mutex_);
+
+    if (!aborted_ && ++n_waiting_ == n_threads_) {
+        n_waiting_ = 0;
+        generation_++;
+        pthread_cond_broadcast(&arrived_);
+    } else {
+        const size_t generation { generation_ };
+
+        while (generation_ == generation && !aborted_)
+            pthread_cond_wait(&arrived_, &mutex_);
+    }
+
+    const bool passed { !aborted_ };
+    pthread_mutex_unlock(&mutex_);
+
+    return passed;
+}
+
+
+void Barrier::abort() {
+    pthread_mutex_lock(&mutex_);
+    aborted_ = true;
+    pthread_cond_broadcast(&arrived_);
+    pthread_mutex_unlock(&mutex_);
+}
+
+
+bool pin_thread(size_t index) {
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return false;
+
+    const size_t n_cpus { static_cast<size_t>(CPU_COUNT(&allowed)) };
+    if (n_cpus == 0)
+        return false;
+
+    // the (index mod n_cpus)-th allowed CPU
+    size_t remaining { index % n_cpus };
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || remaining-- > 0)
+            continue;
+
+        cpu_set_t target;
+        CPU_ZERO(&target);
+        CPU_SET(cpu, &target);
+
+        return pthread_setaffinity_np(pthread_self(), sizeof(target), &target) == 0;
+    }
+#endif
+
+    return false;
+}
+
+
+void run_workers(size_t n_threads, const std::function<void(size_t)>& worker) {
+
+    if (n_threads == 1) {
+        worker(0);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(n_threads);
+    std::vector<std::thread> threads;
+
+    for (size_t w = 0; w < n_threads; w++)
+        threads.emplace_back([&worker, &errors, w] {
+            try {
+                worker(w);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        });
+
+    for (std::thread& t : threads)
+        t.join();
+
+    for (std::exception_ptr& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
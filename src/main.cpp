@@ -22,150 +22,1722 @@
 // (Jan 2025), with minor recommendations incorporated.
 //
 #include <cstdio>
+#include <cmath>
 #include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <atomic>
 #include "HaplotypeVcfParser.h"
+#include "LowRank.h"
+#include "GrmAccumulator.h"
+#include "GrmIO.h"
+#include "CompressedOutput.h"
+#include "Profiler.h"
+#include "WorkStealing.h"
 
 
 
 size_t MARKER_PRINT_INTERVAL { 1000 };
 char HELP_LONG_FLAG[] { "--help" };
 char HELP_SHORT_FLAG[] { "-h" };
+char KEEP_FLAG[] { "--keep" };
+char REMOVE_FLAG[] { "--remove" };
+char THIN_FLAG[] { "--thin" };
+char MIN_SPACING_FLAG[] { "--min-spacing" };
+char REQUIRE_PASS_FLAG[] { "--require-pass" };
+char MIN_INFO_SCORE_FLAG[] { "--min-info-score" };
+char MIN_EAF_FLAG[] { "--min-eaf" };
+char MAX_EAF_FLAG[] { "--max-eaf" };
+char PCS_FLAG[] { "--pcs" };
+char OVERSAMPLE_FLAG[] { "--oversample" };
+char POWER_ITERS_FLAG[] { "--power-iters" };
+char SEED_FLAG[] { "--seed" };
+char BINARY_FLAG[] { "--binary" };
+char EXTEND_FLAG[] { "--extend" };
+char UPDATE_FLAG[] { "--update" };
+char ADD_FLAG[] { "--add" };
+char SUBTRACT_FLAG[] { "--subtract" };
+char METRICS_FLAG[] { "--metrics" };
+char SPARSE_FLAG[] { "--sparse" };
+char PAIR_STATES_FLAG[] { "--pair-states" };
+char CHANGE_POINTS_FLAG[] { "--change-points" };
+char NORMALIZE_FLAG[] { "--normalize" };
+char PAIR_COUNTS_FLAG[] { "--pair-counts" };
+char VCF_FLAG[] { "--vcf" };
+char VCF_LIST_FLAG[] { "--vcf-list" };
+char THREADS_FLAG[] { "--threads" };
+char PIN_THREADS_FLAG[] { "--pin-threads" };
+char HUGE_PAGES_FLAG[] { "--huge-pages" };
+char IO_URING_FLAG[] { "--io-uring" };
+char DIRECT_IO_FLAG[] { "--direct-io" };
+char PANEL_FLAG[] { "--panel" };
+char DETERMINISTIC_FLAG[] { "--deterministic" };
+char GRM_SPARSE_FLAG[] { "--grm-sparse" };
+char OUT_COMPRESS_FLAG[] { "--out-compress" };
+char MMAP_OUTPUT_FLAG[] { "--mmap-output" };
+char DS_GRM_FLAG[] { "--ds-grm" };
 
-int main(int argc, char* argv[])
+const size_t DEFAULT_OVERSAMPLE { 10 };
+const size_t DEFAULT_POWER_ITERS { 2 };
+const unsigned long DEFAULT_SEED { 20250109 };
+
+// parsed records held by --deterministic between reading and adding
+const size_t DETERMINISTIC_BATCH_BYTES { size_t { 64 } << 20 };
+
+// text formatted and compressed by one worker of --out-compress
+const size_t COMPRESS_CHUNK_BYTES { size_t { 1 } << 20 };
+
+
+struct Options
 {
+    char* input { nullptr };
+    char* output { nullptr };
+    char* keep_file { nullptr };
+    char* remove_file { nullptr };
+    MarkerFilter marker_filter;
+    size_t n_pcs { 0 };
+    size_t oversample { DEFAULT_OVERSAMPLE };
+    size_t power_iters { DEFAULT_POWER_ITERS };
+    unsigned long seed { DEFAULT_SEED };
+    bool binary { false };
+    char* extend_file { nullptr };
+    char* update_file { nullptr };
+    std::vector<char*> add_files;
+    std::vector<char*> subtract_files;
+    char* metrics_file { nullptr };
+    bool sparse { false };
+    double sparse_epsilon { 0 };
+    bool pair_states { false };
+    double pair_tolerance { 0 };
+    bool change_points { false };
+    double change_tolerance { 0 };
+    Normalization normalize { Normalization::none };
+    bool pair_counts { false };
+    std::vector<std::string> input_files;
+    size_t threads { 1 };
+    bool pin_threads { false };
+    bool huge_pages { false };
+    size_t uring_depth { 0 };          // 0 reads with stdio
+    bool direct_io { false };
+    size_t panel_markers { 0 };
+    bool deterministic { false };
+    bool grm_sparse { false };
+    double grm_sparse_threshold { 0 };
+    Compression compression { Compression::none };
+    bool mmap_output { false };
+    char* ds_output { nullptr };
+    bool help { false };
+};
 
-    if (argc != 2 && argc != 3)
-        throw std::runtime_error("Must specify vcf");
-
-    if (argc == 2 
-            && (strcmp(argv[1], HELP_SHORT_FLAG) == 0
-                || strcmp(argv[1], HELP_LONG_FLAG) == 0)) {
-        printf("hgrm - Compute GRM from expected haplotype counts.\n"
-               "Usage\n"
-               "\n"
-               "  hgrm <input_vcf_filename> [<output_matrix_filename>]\n"
-               "\n"
-               "Options\n"
-               "  output_matrix_filename   Filename to print covariance matrix\n"
-               "\n"
-               "Description\n"
-               "  A program to compute a genetic relationship matrix from a vcf\n"
-               "  with expected haplotype counts record per sample per locus.\n");
 
+void print_help() {
+    printf("hgrm - Compute GRM from expected haplotype counts.\n"
+           "Usage\n"
+           "\n"
+           "  hgrm [options] <input_vcf_filename> [<output_matrix_filename>]\n"
+           "  hgrm [options] --vcf <vcf> [--vcf <vcf> ...] [<output_matrix_filename>]\n"
+           "  hgrm [options] --vcf-list <file> [<output_matrix_filename>]\n"
+           "  hgrm --update <grm.bin> [--add <vcf>] [--subtract <vcf>] [options]\n"
+           "       <output_matrix_filename>\n"
+           "\n"
+           "Options\n"
+           "  output_matrix_filename   Filename to print covariance matrix\n"
+           "  --vcf <vcf>              Input VCF, may be repeated, e.g. one per\n"
+           "                           chromosome\n"
+           "  --vcf-list <file>        File with one input VCF per line\n"
+           "  --threads <t>            Threads computing the GRM (1)\n"
+           "  --pin-threads            Pin each thread to its own CPU\n"
+           "  --deterministic          Sum every GRM entry in marker order, so\n"
+           "                           the GRM is bitwise identical for any\n"
+           "                           number of threads, dense kernel only\n"
+           "  --huge-pages             Back large matrices with reserved 2 MB\n"
+           "                           huge pages when available\n"
+           "  --io-uring <depth>       Read VCFs with io_uring, keeping depth 1 MB\n"
+           "                           reads in flight\n"
+           "  --direct-io              With --io-uring, bypass the page cache\n"
+           "  --panel <m>              Parse dosages founder major in to panels\n"
+           "                           of m markers, each added to the GRM at\n"
+           "                           once, dense kernel only\n"
+           "  --ds-grm <file>          Also compute the GRM of the SNP dosages\n"
+           "                           (DS), parsed in the same pass, and write\n"
+           "                           it to file in the format of the GRM\n"
+           "  --keep <file>            Only use samples listed in file\n"
+           "  --remove <file>          Exclude samples listed in file\n"
+           "  --thin <n>               Keep every nth marker passing filters\n"
+           "  --min-spacing <bp>       Minimum distance between kept markers\n"
+           "  --require-pass           Only use markers with FILTER == PASS\n"
+           "  --min-info-score <x>     Minimum INFO_SCORE of the INFO column\n"
+           "  --min-eaf <x>            Minimum EAF of the INFO column\n"
+           "  --max-eaf <x>            Maximum EAF of the INFO column\n"
+           "  --pcs <r>                Write the top r eigenpairs of the GRM to\n"
+           "                           <output>.eigenval and <output>.eigenvec\n"
+           "                           instead of the GRM\n"
+           "  --oversample <p>         Extra sketch columns for --pcs (10)\n"
+           "  --power-iters <q>        Power iterations for --pcs (2)\n"
+           "  --seed <s>               Random seed for --pcs\n"
+           "  --binary                 Write the GRM in binary format\n"
+           "  --mmap-output            Accumulate the GRM in the binary output\n"
+           "                           file, mapped in to memory, implies\n"
+           "                           --binary, with --threads the dense\n"
+           "                           kernel without --panel\n"
+           "  --grm-sparse <x>         Write only the diagonal and the pairs\n"
+           "                           above x, as GCTA sparse <output>.grm.sp\n"
+           "                           and <output>.grm.id\n"
+           "  --out-compress <c>       Compress the text GRM with gzip (BGZF)\n"
+           "                           or zstd, by --threads threads\n"
+           "  --extend <grm.bin>       Extend an existing binary GRM with the\n"
+           "                           VCF samples it does not contain, the VCF\n"
+           "                           must hold the same markers\n"
+           "  --update <grm.bin>       Add to or subtract from an existing\n"
+           "                           binary GRM the markers of VCFs given by\n"
+           "  --add <vcf>              (may be repeated) and\n"
+           "  --subtract <vcf>         (may be repeated)\n"
+           "  --sparse <eps>           Drop haplotype dosages at most eps and\n"
+           "                           accumulate from the remaining ones,\n"
+           "                           0 keeps every nonzero dosage\n"
+           "  --pair-states <tol>      Code samples whose dosages are within tol\n"
+           "                           of a founder pair by that pair\n"
+           "  --normalize <mode>       none (default), center or standardize\n"
+           "                           the GRM, divided by the number of markers\n"
+           "  --pair-counts            Divide each GRM entry by the number of\n"
+           "                           markers at which both samples have\n"
+           "                           haplotype dosages, instead of all markers\n"
+           "  --change-points <tol>    Update only the GRM rows of samples whose\n"
+           "                           dosages changed by more than tol\n"
+           "  --metrics <file>         Write run time, throughput and memory\n"
+           "                           use of each phase as JSON\n"
+           "\n"
+           "Description\n"
+           "  A program to compute a genetic relationship matrix from a vcf\n"
+           "  with expected haplotype counts record per sample per locus.\n"
+           "  Sample files have one identifier per line, or PLINK style\n"
+           "  FID IID columns.  Progress is written to standard error.\n");
+}
 
-        return 0;
+
+// Return the value following the flag at argv[i] and advance i
+char* option_value(int argc, char* argv[], int& i) {
+    if (i + 1 >= argc)
+        throw std::runtime_error("Option requires a value");
+    return argv[++i];
+}
+
+
+// Threads add to bands of rows of one GRM, rather than each to its own
+// partial GRM, with the dense kernel without panels
+bool banded_kernel(const Options& opts) {
+    return !opts.sparse && !opts.pair_states && !opts.change_points
+            && opts.panel_markers == 0;
+}
+
+
+// Flags may appear anywhere, remaining arguments are the input
+// and optional output filenames in that order.
+Options parse_args(int argc, char* argv[]) {
+
+    Options opts;
+    std::vector<char*> positional;
+    double min_eaf { 0 };
+    double max_eaf { 1 };
+    bool use_eaf { false };
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], HELP_SHORT_FLAG) == 0
+                || strcmp(argv[i], HELP_LONG_FLAG) == 0) {
+            opts.help = true;
+            return opts;
+        }
+
+        if (strcmp(argv[i], KEEP_FLAG) == 0)
+            opts.keep_file = option_value(argc, argv, i);
+        else if (strcmp(argv[i], REMOVE_FLAG) == 0)
+            opts.remove_file = option_value(argc, argv, i);
+        else if (strcmp(argv[i], THIN_FLAG) == 0)
+            opts.marker_filter.every_nth(std::atol(option_value(argc, argv, i)));
+        else if (strcmp(argv[i], MIN_SPACING_FLAG) == 0)
+            opts.marker_filter.min_spacing(std::atol(option_value(argc, argv, i)));
+        else if (strcmp(argv[i], REQUIRE_PASS_FLAG) == 0)
+            opts.marker_filter.require_pass(true);
+        else if (strcmp(argv[i], MIN_INFO_SCORE_FLAG) == 0)
+            opts.marker_filter.min_info_score(std::atof(option_value(argc, argv, i)));
+        else if (strcmp(argv[i], MIN_EAF_FLAG) == 0) {
+            min_eaf = std::atof(option_value(argc, argv, i));
+            use_eaf = true;
+        } else if (strcmp(argv[i], MAX_EAF_FLAG) == 0) {
+            max_eaf = std::atof(option_value(argc, argv, i));
+            use_eaf = true;
+        } else if (strcmp(argv[i], PCS_FLAG) == 0)
+            opts.n_pcs = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], OVERSAMPLE_FLAG) == 0)
+            opts.oversample = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], POWER_ITERS_FLAG) == 0)
+            opts.power_iters = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], SEED_FLAG) == 0)
+            opts.seed = std::strtoul(option_value(argc, argv, i), nullptr, 10);
+        else if (strcmp(argv[i], BINARY_FLAG) == 0)
+            opts.binary = true;
+        else if (strcmp(argv[i], MMAP_OUTPUT_FLAG) == 0)
+            opts.binary = opts.mmap_output = true;
+        else if (strcmp(argv[i], DS_GRM_FLAG) == 0)
+            opts.ds_output = option_value(argc, argv, i);
+        else if (strcmp(argv[i], GRM_SPARSE_FLAG) == 0) {
+            opts.grm_sparse = true;
+            opts.grm_sparse_threshold = std::atof(option_value(argc, argv, i));
+        } else if (strcmp(argv[i], OUT_COMPRESS_FLAG) == 0)
+            opts.compression = parse_compression(option_value(argc, argv, i));
+        else if (strcmp(argv[i], EXTEND_FLAG) == 0)
+            opts.extend_file = option_value(argc, argv, i);
+        else if (strcmp(argv[i], UPDATE_FLAG) == 0)
+            opts.update_file = option_value(argc, argv, i);
+        else if (strcmp(argv[i], ADD_FLAG) == 0)
+            opts.add_files.push_back(option_value(argc, argv, i));
+        else if (strcmp(argv[i], SUBTRACT_FLAG) == 0)
+            opts.subtract_files.push_back(option_value(argc, argv, i));
+        else if (strcmp(argv[i], SPARSE_FLAG) == 0) {
+            opts.sparse = true;
+            opts.sparse_epsilon = std::atof(option_value(argc, argv, i));
+        } else if (strcmp(argv[i], PAIR_STATES_FLAG) == 0) {
+            opts.pair_states = true;
+            opts.pair_tolerance = std::atof(option_value(argc, argv, i));
+        } else if (strcmp(argv[i], NORMALIZE_FLAG) == 0)
+            opts.normalize = parse_normalization(option_value(argc, argv, i));
+        else if (strcmp(argv[i], PAIR_COUNTS_FLAG) == 0)
+            opts.pair_counts = true;
+        else if (strcmp(argv[i], VCF_FLAG) == 0)
+            opts.input_files.push_back(option_value(argc, argv, i));
+        else if (strcmp(argv[i], VCF_LIST_FLAG) == 0) {
+            for (const std::string& name : read_lines(option_value(argc, argv, i)))
+                opts.input_files.push_back(name);
+        } else if (strcmp(argv[i], THREADS_FLAG) == 0)
+            opts.threads = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], PIN_THREADS_FLAG) == 0)
+            opts.pin_threads = true;
+        else if (strcmp(argv[i], HUGE_PAGES_FLAG) == 0)
+            opts.huge_pages = true;
+        else if (strcmp(argv[i], IO_URING_FLAG) == 0)
+            opts.uring_depth = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], DIRECT_IO_FLAG) == 0)
+            opts.direct_io = true;
+        else if (strcmp(argv[i], DETERMINISTIC_FLAG) == 0)
+            opts.deterministic = true;
+        else if (strcmp(argv[i], PANEL_FLAG) == 0)
+            opts.panel_markers = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], CHANGE_POINTS_FLAG) == 0) {
+            opts.change_points = true;
+            opts.change_tolerance = std::atof(option_value(argc, argv, i));
+        } else if (strcmp(argv[i], METRICS_FLAG) == 0)
+            opts.metrics_file = option_value(argc, argv, i);
+        else if (argv[i][0] == '-' && argv[i][1] == '-')
+            throw std::runtime_error("Unknown option");
+        else
+            positional.push_back(argv[i]);
     }
 
-    char* filename_input { argv[1] };
-    char* filename_output { nullptr };
+    if (use_eaf)
+        opts.marker_filter.eaf_range(min_eaf, max_eaf);
 
-    if(argc == 3)
-        filename_output = argv[2];
+    if (opts.sparse + opts.pair_states + opts.change_points > 1)
+        throw std::runtime_error("--sparse, --pair-states and --change-points are exclusive");
 
+    if (opts.change_points && opts.extend_file != nullptr)
+        throw std::runtime_error("--change-points is not supported with --extend");
 
-    const std::chrono::time_point timer
-    { std::chrono::steady_clock::now() };
+    // the corrections of a normalized GRM are not stored with it, so a
+    // binary GRM is always the unnormalized sum
+    if ((opts.normalize != Normalization::none || opts.pair_counts)
+            && (opts.binary || opts.extend_file != nullptr || opts.update_file != nullptr
+                || opts.n_pcs > 0))
+        throw std::runtime_error("--normalize and --pair-counts are not supported "
+                                 "with --binary, --mmap-output, --extend, --update or --pcs");
 
+    if (opts.normalize == Normalization::standardize
+            && (opts.pair_states || opts.change_points))
+        throw std::runtime_error("--normalize standardize requires the dense or --sparse kernel");
 
-    fprintf(stdout, "Allocating memory\n");
+    if (opts.threads == 0)
+        throw std::runtime_error("--threads must be at least 1");
 
-    // open VCF file and parse meta data and header
-    HaplotypeVcfParser vcf_data { filename_input, 100000 };
+    if (opts.direct_io && opts.uring_depth == 0)
+        throw std::runtime_error("--direct-io requires --io-uring");
 
+    if (opts.panel_markers > 0
+            && (opts.sparse || opts.pair_states || opts.change_points
+                || opts.normalize == Normalization::standardize))
+        throw std::runtime_error("--panel requires the dense kernel without standardize");
 
-    // instantiate matrices to hold calculations
-    Matrix covariance { vcf_data.n_samples(), vcf_data.n_samples() };
+    if (opts.deterministic && !banded_kernel(opts))
+        throw std::runtime_error("--deterministic requires the dense kernel without --panel");
 
-    // instantiate record object
-    HaplotypeDataRecord record { vcf_data.n_samples(), vcf_data.k_founders() };
+    if (opts.mmap_output
+            && (opts.extend_file != nullptr || opts.update_file != nullptr || opts.n_pcs > 0))
+        throw std::runtime_error("--mmap-output is not supported with --extend, --update or --pcs");
+
+    // other workers would each hold a partial GRM in memory
+    if (opts.mmap_output && opts.threads > 1 && !banded_kernel(opts))
+        throw std::runtime_error("--mmap-output with --threads requires the dense kernel "
+                                 "without --panel");
+
+    if (opts.ds_output != nullptr
+            && (opts.extend_file != nullptr || opts.update_file != nullptr || opts.n_pcs > 0))
+        throw std::runtime_error("--ds-grm is not supported with --extend, --update or --pcs");
+
+    if ((opts.threads > 1 || !opts.input_files.empty() || opts.panel_markers > 0)
+            && (opts.extend_file != nullptr || opts.update_file != nullptr || opts.n_pcs > 0))
+        throw std::runtime_error("--threads, --vcf, --vcf-list and --panel are not supported "
+                                 "with --extend, --update or --pcs");
+
+    // the VCFs of an update are given by --add and --subtract
+    if (opts.update_file != nullptr) {
+        if (positional.size() != 1)
+            throw std::runtime_error("--update requires only an output filename");
+
+        if (opts.add_files.empty() && opts.subtract_files.empty())
+            throw std::runtime_error("--update requires --add or --subtract");
+
+        opts.output = positional[0];
+        return opts;
+    }
+
+    if (!opts.add_files.empty() || !opts.subtract_files.empty())
+        throw std::runtime_error("--add and --subtract require --update");
+
+    // inputs given by --vcf or --vcf-list leave only the output
+    if (!opts.input_files.empty()) {
+        if (positional.size() > 1)
+            throw std::runtime_error("--vcf and --vcf-list take only an output filename");
+
+        if (positional.size() == 1)
+            opts.output = positional[0];
+
+    } else {
+        if (positional.size() != 1 && positional.size() != 2)
+            throw std::runtime_error("Must specify vcf");
+
+        opts.input = positional[0];
+        opts.input_files.push_back(opts.input);
+
+        if (positional.size() == 2)
+            opts.output = positional[1];
+    }
+
+    if (opts.n_pcs > 0 && opts.output == nullptr)
+        throw std::runtime_error("--pcs requires an output filename prefix");
+
+    if (opts.binary && opts.output == nullptr)
+        throw std::runtime_error("--binary requires an output filename");
+
+    if (opts.grm_sparse && (opts.output == nullptr || opts.binary || opts.n_pcs > 0))
+        throw std::runtime_error("--grm-sparse requires an output filename prefix, "
+                                 "without --binary or --pcs");
+
+    if (opts.compression != Compression::none && (opts.binary || opts.grm_sparse))
+        throw std::runtime_error("--out-compress applies to the text GRM, "
+                                 "not --binary or --grm-sparse");
+
+    if (!compression_available(opts.compression))
+        throw std::runtime_error("hgrm was built without zstd, use --out-compress gzip");
+
+    return opts;
+}
+
+
+// Timing and instrumentation shared by the stages of a run.  Status
+// messages go to standard error so they never mix with a GRM written
+// to standard output.
+struct Run
+{
+    std::chrono::steady_clock::time_point timer { std::chrono::steady_clock::now() };
+    Profiler profiler;
+    PhaseCounters* counters { profiler.register_thread("main") };
+};
+
+
+long long elapsed_seconds(const std::chrono::steady_clock::time_point& timer) {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - timer).count();
+}
+
+
+// Read through io_uring when --io-uring is given, the first parser
+// for which it is unavailable prints a warning
+void use_uring(const Options& opts, HaplotypeVcfParser& vcf_data) {
+    static std::atomic<bool> warned { false };
+
+    if (opts.uring_depth == 0)
+        return;
+
+    UringOptions options;
+    options.queue_depth = opts.uring_depth;
+    options.direct = opts.direct_io;
+
+    if (!vcf_data.use_uring(options) && !warned.exchange(true))
+        fprintf(stderr, "Warning: io_uring is not available, reading with stdio\n");
+}
+
+
+// Attach the main thread counters to the parser and record
+void instrument(Run& run, HaplotypeVcfParser& vcf_data, HaplotypeDataRecord& record) {
+    vcf_data.set_profiler(run.counters);
+    record.set_profiler(run.counters);
+}
+
+
+// Kernel and normalization of the GRM chosen by --sparse,
+// --pair-states, --change-points, --normalize and --pair-counts
+GrmOptions grm_options(const Options& opts) {
+    GrmOptions options;
+
+    if (opts.sparse) {
+        options.kernel = GrmKernel::sparse;
+        options.tolerance = opts.sparse_epsilon;
+    } else if (opts.pair_states) {
+        options.kernel = GrmKernel::pair_states;
+        options.tolerance = opts.pair_tolerance;
+    } else if (opts.change_points) {
+        options.kernel = GrmKernel::change_points;
+        options.tolerance = opts.change_tolerance;
+    }
+
+    options.normalize = opts.normalize;
+    options.pair_counts = opts.pair_counts;
+    options.panel_markers = opts.panel_markers;
+    return options;
+}
+
+
+// The GRM of a worker, that of worker 0, which the others are summed
+// in to, accumulated in the output file with --mmap-output
+std::unique_ptr<GrmAccumulator> make_accumulator(const Options& opts,
+                                                 const HaplotypeVcfParser& vcf_data,
+                                                 size_t worker) {
+    if (opts.mmap_output && worker == 0)
+        return std::make_unique<GrmAccumulator>(
+                    vcf_data.n_samples(), vcf_data.k_founders(), grm_options(opts),
+                    create_grm_mapped(opts.output, vcf_data.sample_names()));
+
+    return std::make_unique<GrmAccumulator>(vcf_data.n_samples(), vcf_data.k_founders(),
+                                            grm_options(opts));
+}
+
+
+// --ds-grm: the SNP dosage GRM, one dosage per sample, with the dense
+// kernel and the normalization and panels of the haplotype GRM
+std::unique_ptr<GrmAccumulator> make_ds_accumulator(const Options& opts,
+                                                    const HaplotypeVcfParser& vcf_data) {
+    if (opts.ds_output == nullptr)
+        return nullptr;
+
+    GrmOptions options { grm_options(opts) };
+    options.kernel = GrmKernel::dense;
+    options.tolerance = 0;
+
+    return std::make_unique<GrmAccumulator>(vcf_data.n_samples(), 1, options);
+}
+
+
+// --ds-grm: the DS of the lines parsed by record go to a record of its own
+std::unique_ptr<HaplotypeDataRecord> make_ds_record(const Options& opts,
+                                                    const HaplotypeVcfParser& vcf_data,
+                                                    HaplotypeDataRecord& record) {
+    if (opts.ds_output == nullptr)
+        return nullptr;
+
+    auto ds_record { std::make_unique<HaplotypeDataRecord>(vcf_data.n_samples(), 1) };
+    record.set_snp_dosages(ds_record.get());
+    return ds_record;
+}
+
+
+MarkerKernel make_kernel(const Options& opts, const HaplotypeVcfParser& vcf_data) {
+    const GrmOptions options { grm_options(opts) };
+    return MarkerKernel { vcf_data.n_samples(), vcf_data.k_founders(),
+                          options.kernel, options.tolerance };
+}
+
+
+void report_change_points(const MarkerKernel& kernel) {
+    if (kernel.change_points() == nullptr)
+        return;
+
+    fprintf(stderr, "%zu sample dosage changes over %zu marker loci\n",
+            kernel.change_points()->n_changes(), kernel.change_points()->n_markers());
+}
+
+
+// Add contributions still held by the kernel after the last marker
+void finish_markers(MarkerKernel& kernel, Matrix& covariance, double weight=1) {
+    kernel.flush(covariance, weight);
+    report_change_points(kernel);
+}
+
+
+// Top eigenpairs of the GRM by randomized subspace iteration.  Each
+// pass streams the VCF once, only n_samples by (r + oversample)
+// matrices are held in memory.  Returns the number of markers.
+size_t compute_pcs(const Options& opts,
+                HaplotypeVcfParser& vcf_data,
+                HaplotypeDataRecord& record,
+                Run& run) {
+
+    RandomizedEigen eigen { vcf_data.n_samples(), opts.n_pcs,
+                            opts.oversample, opts.seed };
+
+    const size_t n_passes { RandomizedEigen::n_passes(opts.power_iters) };
+    size_t m_markers { 0 };
+
+    for (size_t pass = 0; pass < n_passes; pass++) {
+
+        fprintf(stderr, "Pass %zu of %zu over markers, elapsed time %lld second(s)\n",
+                pass + 1, n_passes, elapsed_seconds(run.timer));
+
+        if (pass > 0)
+            vcf_data.rewind();
+
+        eigen.start_pass();
+
+        ProgressReporter progress { vcf_data.file_size(), MARKER_PRINT_INTERVAL };
+        m_markers = 0;
+
+        while (vcf_data.load_record(record)) {
+            {
+                ScopedPhase timed { run.counters, Phase::accumulate };
+                timed.add_markers(1);
+                eigen.add_marker(record);
+            }
+            progress.update(++m_markers, vcf_data.bytes_read());
+        }
+
+        if (pass + 1 < n_passes) {
+            ScopedPhase timed { run.counters, Phase::accumulate };
+            eigen.end_pass();
+        }
+    }
+
+    {
+        ScopedPhase timed { run.counters, Phase::accumulate };
+        eigen.finalize();
+    }
+
+    ScopedPhase timed { run.counters, Phase::write };
+
+    std::string prefix { opts.output };
+    FILE* fout { nullptr };
 
-    // analyze each line, i.e. position, in the VCF
-    size_t m_markers { 1 };
+    if ((fout = fopen((prefix + ".eigenval").c_str(), "w")) == nullptr)
+        throw std::runtime_error("Error in opening file for writing.");
 
-    double sum { 0 };
-    const double* rowi { nullptr };
-    const double* rowj { nullptr };
-    double* rowi_cov { nullptr };
-    const size_t k_founders { vcf_data.k_founders() };
-    const size_t n_samples { vcf_data.n_samples() };
+    for (double value : eigen.eigenvalues())
+        fprintf(fout, "%0.6g\n", value);
 
-    std::chrono::steady_clock::duration delta_t
-        { std::chrono::steady_clock::now() - timer };
+    timed.add_bytes(ftell(fout));
+    fclose(fout);
+
+    if ((fout = fopen((prefix + ".eigenvec").c_str(), "w")) == nullptr)
+        throw std::runtime_error("Error in opening file for writing.");
+
+    const Matrix& vectors { eigen.eigenvectors() };
+    for (size_t i = 0; i < vcf_data.n_samples(); i++) {
+
+        fprintf(fout, "%s", vcf_data.sample_names()[i].c_str());
+
+        for (size_t c = 0; c < eigen.rank(); c++)
+            fprintf(fout, ",%0.6g", vectors(i, c));
+
+        fprintf(fout, "\n");
+    }
+
+    timed.add_bytes(ftell(fout));
+    fclose(fout);
+
+    return m_markers;
+}
+
+
+// GCTA sparse files of the GRM thresholded at --grm-sparse
+void write_sparse_files(const Options& opts,
+                        const Matrix& covariance,
+                        const std::vector<std::string>& sample_names,
+                        ScopedPhase& timed) {
+
+    const std::string prefix { opts.output };
+    FILE* fout { nullptr };
+
+    if ((fout = fopen((prefix + ".grm.id").c_str(), "w")) == nullptr)
+        throw std::runtime_error("Error in opening file for writing.");
+
+    write_grm_ids(fout, sample_names);
+    timed.add_bytes(ftell(fout));
+    fclose(fout);
+
+    if ((fout = fopen((prefix + ".grm.sp").c_str(), "w")) == nullptr)
+        throw std::runtime_error("Error in opening file for writing.");
+
+    size_t n_pairs { write_grm_sparse(fout, covariance, opts.grm_sparse_threshold) };
+    timed.add_bytes(ftell(fout));
+
+    if (ferror(fout)) {
+        fclose(fout);
+        throw std::runtime_error("Error writing sparse GRM");
+    }
+
+    fclose(fout);
+
+    fprintf(stderr, "Kept %zu of %zu GRM entries\n", n_pairs,
+            covariance.dims()[0] * (covariance.dims()[0] + 1) / 2);
+}
+
+
+// Text GRM in chunks of rows, each formatted and compressed by one of
+// the --threads workers
+void write_compressed_grm(const Options& opts,
+                          const Matrix& covariance,
+                          FILE* fout,
+                          ScopedPhase& timed) {
 
-    fprintf(stdout, "Computing matrix, elapsed time %lld second(s)\n",
-            std::chrono::duration_cast<std::chrono::seconds>(delta_t).count());
+    const size_t n { covariance.dims()[0] };
+    const size_t rows { std::max(COMPRESS_CHUNK_BYTES / (8 * n + 1), size_t { 1 }) };
+
+    size_t n_bytes { write_compressed_chunks(fout, opts.compression, (n + rows - 1) / rows,
+                                             [&](size_t c, std::string& text) {
+                                                 format_grm_rows(covariance, c * rows,
+                                                                 std::min(n, (c + 1) * rows),
+                                                                 text);
+                                             }, opts.threads) };
+
+    timed.add_bytes(n_bytes);
+}
+
+
+void write_grm(const Options& opts,
+               const Matrix& covariance,
+               const std::vector<std::string>& sample_names,
+               size_t m_markers,
+               Run& run) {
+
+    if (opts.output != nullptr)
+        fprintf(stderr, "Writing results to file %s, elapsed time %lld second(s)\n",
+                opts.output, elapsed_seconds(run.timer));
+
+    ScopedPhase timed { run.counters, Phase::write };
+
+    if (opts.binary) {
+        GrmBinaryHeader header { make_grm_header(sample_names, m_markers) };
+        write_grm_binary(opts.output, covariance, sample_names, m_markers);
+        timed.add_bytes(header.data_offset + covariance.size() * sizeof(double));
+        return;
+    }
+
+    if (opts.grm_sparse) {
+        write_sparse_files(opts, covariance, sample_names, timed);
+        return;
+    }
+
+    FILE* fout = stdout;
+
+    if (opts.output != nullptr
+            && (fout = fopen(opts.output, "w")) == nullptr)
+        throw std::runtime_error("Error in opening file for writing.");
+
+    if (opts.compression != Compression::none) {
+        write_compressed_grm(opts, covariance, fout, timed);
+        if (fout != stdout)
+            fclose(fout);
+        return;
+    }
+
+    write_grm_text(fout, covariance);
+
+    // not available when writing to a pipe
+    long n_bytes { ftell(fout) };
+    if (n_bytes > 0)
+        timed.add_bytes(n_bytes);
+
+    fclose(fout);
+}
+
+
+// --mmap-output: the GRM is already in the output file, only changed
+// pages and the number of markers are written
+void sync_grm(const Options& opts, GrmAccumulator& grm, Run& run) {
+
+    fprintf(stderr, "Syncing results to file %s, elapsed time %lld second(s)\n",
+            opts.output, elapsed_seconds(run.timer));
+
+    ScopedPhase timed { run.counters, Phase::write };
+
+    std::unique_ptr<Matrix> covariance { grm.release() };
+    sync_grm_mapped(opts.output, *covariance, grm.n_markers());
+}
+
+
+// Partial GRM of one worker, summed over the chunks it processed
+struct WorkerState
+{
+    std::unique_ptr<GrmAccumulator> grm;
+    std::unique_ptr<GrmAccumulator> ds_grm;     // --ds-grm
+    size_t n_accepted { 0 };
+    size_t n_rejected { 0 };
+};
+
+
+// Add the markers remaining in the parser's range to the worker state,
+// and with --ds-grm their SNP dosages, parsed in to ds_record
+void accumulate_markers(HaplotypeVcfParser& vcf_data,
+                        HaplotypeDataRecord& record,
+                        HaplotypeDataRecord* ds_record,
+                        WorkerState& state,
+                        PhaseCounters* counters,
+                        ProgressReporter& progress) {
+
+    size_t bytes_done { vcf_data.bytes_read() };
+
+    // with --panel lines are parsed in to the panel of the worker
+    state.grm->attach(record);
+
+    if (ds_record != nullptr)
+        state.ds_grm->attach(*ds_record);
 
     while(vcf_data.load_record(record)) {
+        {
+            ScopedPhase timed { counters, Phase::accumulate };
+            timed.add_markers(1);
+            state.grm->add(record);
+
+            if (ds_record != nullptr)
+                state.ds_grm->add(*ds_record);
+        }
+        progress.add(1, vcf_data.bytes_read() - bytes_done);
+        bytes_done = vcf_data.bytes_read();
+    }
+
+    state.n_accepted += vcf_data.marker_filter().n_accepted();
+    state.n_rejected += vcf_data.marker_filter().n_rejected();
+}
+
 
-        // for each founder, compute first and second moments
-        for (size_t i = 0; i < n_samples; i++) {
+// Extend an existing binary GRM with the samples of the VCF that it
+// does not contain.  Only the rows of the new samples are computed,
+// at O(n_new n k) per marker, the block of the existing samples is
+// copied from the file.  The VCF must hold the markers used for the
+// existing GRM.
+size_t extend_grm(const Options& opts,
+                  const char* grm_filename,
+                  HaplotypeVcfParser& vcf_data,
+                  HaplotypeDataRecord& record,
+                  Matrix& covariance,
+                  Run& run) {
 
-            rowi = &record(i, 0);
-            rowi_cov = &covariance(i, 0);
+    GrmBinary old_grm { read_grm_binary(grm_filename) };
+
+    const std::vector<std::string>& names { vcf_data.sample_names() };
+    const size_t n_samples { names.size() };
+
+    // index of each VCF sample in the existing GRM, or -1 if new
+    std::unordered_map<std::string, size_t> old_index;
+    for (size_t i = 0; i < old_grm.sample_ids.size(); i++)
+        old_index[old_grm.sample_ids[i]] = i;
+
+    std::vector<long> vcf_to_old(n_samples, -1);
+    std::vector<size_t> new_samples;
+
+    for (size_t i = 0; i < n_samples; i++) {
+        auto found { old_index.find(names[i]) };
+
+        if (found != old_index.end())
+            vcf_to_old[i] = found->second;
+        else
+            new_samples.push_back(i);
+    }
+
+    if (new_samples.empty())
+        throw std::runtime_error("VCF has no samples that are not in the existing GRM");
+
+    fprintf(stderr, "Extending GRM of %zu samples with %zu new samples\n",
+            n_samples - new_samples.size(), new_samples.size());
+
+    Matrix cross { new_samples.size(), n_samples };
+    MarkerKernel kernel { make_kernel(opts, vcf_data) };
+    ProgressReporter progress { vcf_data.file_size(), MARKER_PRINT_INTERVAL };
+    size_t m_markers { 0 };
+
+    while(vcf_data.load_record(record)) {
+        {
+            ScopedPhase timed { run.counters, Phase::accumulate };
+            timed.add_markers(1);
+            kernel.add_rows(record, new_samples, cross);
+        }
+        progress.update(++m_markers, vcf_data.bytes_read());
+    }
 
-            for (size_t j = i; j < n_samples; j++) {
+    if (m_markers != old_grm.n_markers)
+        throw std::runtime_error("Number of markers differs from the existing GRM");
 
-                rowj = &record(j,0);
-                sum = 0;
+    // old by old block
+    size_t a { 0 };
+    size_t b { 0 };
+    for (size_t i = 0; i < n_samples; i++) {
+        if (vcf_to_old[i] < 0)
+            continue;
 
-                for (int k = 0; k < k_founders; k++)
-                    sum += rowi[k] * rowj[k];
+        for (size_t j = i; j < n_samples; j++) {
+            if (vcf_to_old[j] < 0)
+                continue;
 
-                rowi_cov[j] += sum;
+            a = std::min(vcf_to_old[i], vcf_to_old[j]);
+            b = std::max(vcf_to_old[i], vcf_to_old[j]);
+            covariance(i, j) = (*old_grm.covariance)(a, b);
+        }
+    }
+
+    // rows of the new samples
+    for (size_t r = 0; r < new_samples.size(); r++)
+        for (size_t j = 0; j < n_samples; j++) {
+            a = std::min(new_samples[r], j);
+            b = std::max(new_samples[r], j);
+            covariance(a, b) = cross(r, j);
+        }
+
+    return m_markers;
+}
+
+
+// Add (weight 1) or subtract (weight -1) the markers of a VCF to the
+// covariance of the samples in sample_ids, returns the number of markers.
+size_t update_grm_with_vcf(char* filename,
+                           double weight,
+                           const Options& opts,
+                           const std::vector<std::string>& sample_ids,
+                           Matrix& covariance,
+                           Run& run) {
+
+    fprintf(stderr, "%s markers of %s, elapsed time %lld second(s)\n",
+            weight > 0 ? "Adding" : "Subtracting", filename, elapsed_seconds(run.timer));
+
+    SampleSelection selection;
+    selection.keep = sample_ids;
+    selection.has_keep = true;
+
+    HaplotypeVcfParser vcf_data { filename, 100000, selection };
+    vcf_data.set_marker_filter(opts.marker_filter);
+
+    const std::vector<std::string>& names { vcf_data.sample_names() };
+
+    if (names.size() != sample_ids.size())
+        throw std::runtime_error("VCF does not contain every sample of the GRM");
+
+    HaplotypeDataRecord record { vcf_data.n_samples(),
+                                 vcf_data.k_founders(),
+                                 vcf_data.sample_mask() };
+
+    instrument(run, vcf_data, record);
+    use_uring(opts, vcf_data);
+
+    MarkerKernel kernel { make_kernel(opts, vcf_data) };
+    ProgressReporter progress { vcf_data.file_size(), MARKER_PRINT_INTERVAL };
+    size_t m_markers { 0 };
+
+    // the usual case, VCF and GRM list samples in the same order
+    if (names == sample_ids) {
+        while (vcf_data.load_record(record)) {
+            {
+                ScopedPhase timed { run.counters, Phase::accumulate };
+                timed.add_markers(1);
+                kernel.add_marker(record, covariance, weight);
             }
+            progress.update(++m_markers, vcf_data.bytes_read());
         }
 
-        if (m_markers % MARKER_PRINT_INTERVAL == 0) {
-            delta_t = std::chrono::steady_clock::now() - timer;
+        ScopedPhase timed { run.counters, Phase::accumulate };
+        finish_markers(kernel, covariance, weight);
 
-            fprintf(stdout, "Completed %zu marker loci, elapsed time %lld second(s)\n",
-                    m_markers,
-                    std::chrono::duration_cast<std::chrono::seconds>(delta_t).count());
+        return m_markers;
+    }
+
+    Matrix partial { names.size(), names.size() };
+    while (vcf_data.load_record(record)) {
+        {
+            ScopedPhase timed { run.counters, Phase::accumulate };
+            timed.add_markers(1);
+            kernel.add_marker(record, partial);
         }
+        progress.update(++m_markers, vcf_data.bytes_read());
+    }
 
-        m_markers++;
+    finish_markers(kernel, partial);
+
+    std::unordered_map<std::string, size_t> grm_index;
+    for (size_t i = 0; i < sample_ids.size(); i++)
+        grm_index[sample_ids[i]] = i;
+
+    std::vector<size_t> vcf_to_grm(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+        vcf_to_grm[i] = grm_index[names[i]];
+
+    size_t a { 0 };
+    size_t b { 0 };
+    for (size_t i = 0; i < names.size(); i++)
+        for (size_t j = i; j < names.size(); j++) {
+            a = std::min(vcf_to_grm[i], vcf_to_grm[j]);
+            b = std::max(vcf_to_grm[i], vcf_to_grm[j]);
+            covariance(a, b) += weight * partial(i, j);
+        }
+
+    return m_markers;
+}
 
+
+// Incremental update of a binary GRM, e.g. when a chromosome has been
+// re-imputed its previous VCF is subtracted and the new one added.
+// Only the changed markers are read.  Returns the number of markers
+// of the updated GRM.
+size_t update_grm(const Options& opts, GrmBinary& grm, Run& run) {
+
+    long long m_markers { static_cast<long long>(grm.n_markers) };
+
+    for (char* filename : opts.subtract_files)
+        m_markers -= update_grm_with_vcf(filename, -1, opts, grm.sample_ids,
+                                         *grm.covariance, run);
+
+    for (char* filename : opts.add_files)
+        m_markers += update_grm_with_vcf(filename, 1, opts, grm.sample_ids,
+                                         *grm.covariance, run);
+
+    if (m_markers < 0)
+        throw std::runtime_error("More markers subtracted than are in the GRM");
+
+    fprintf(stderr, "Updated GRM has %lld marker loci\n", m_markers);
+
+    return m_markers;
+}
+
+
+// JSON string value
+std::string quoted(const char* value) {
+    std::string out { "\"" };
+
+    for (const char* c = value; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            out += '\\';
+        out += *c;
     }
 
+    return out + "\"";
+}
 
-    FILE* fout = stdout;
 
-    if (argc == 3 && filename_output != nullptr) {
+// Stop the timers, report the run time and write the metrics file if
+// one was requested
+void finish_run(const Options& opts, Run& run,
+                size_t n_samples, size_t k_founders, size_t m_markers) {
+
+    run.counters->stop();
+
+    fprintf(stderr, "Done, elapsed time %lld second(s)\n", elapsed_seconds(run.timer));
+
+    if (opts.metrics_file == nullptr)
+        return;
+
+    const char* mode { opts.update_file != nullptr ? "update"
+                       : opts.extend_file != nullptr ? "extend"
+                       : opts.n_pcs > 0 ? "pcs" : "grm" };
+
+    std::string inputs { "[" };
+
+    for (size_t i = 0; i < opts.input_files.size(); i++)
+        inputs += (i > 0 ? ", " : "") + quoted(opts.input_files[i].c_str());
+
+    inputs += "]";
+
+    run.profiler.write_json(opts.metrics_file, {
+        {"mode", quoted(mode)},
+        {"input", inputs},
+        {"n_threads", std::to_string(opts.threads)},
+        {"deterministic", opts.deterministic ? "true" : "false"},
+        {"output", quoted(opts.output != nullptr ? opts.output : "")},
+        {"n_samples", std::to_string(n_samples)},
+        {"k_founders", std::to_string(k_founders)},
+        {"n_markers", std::to_string(m_markers)}
+    });
+}
+
+
+// Row boundaries splitting the upper triangle of an n x n matrix in to
+// n_bands bands of about equal area
+std::vector<size_t> upper_row_bands(size_t n, size_t n_bands) {
+    std::vector<size_t> bounds(n_bands + 1, n);
+
+    // rows i and below hold (n - i)^2 / 2 entries
+    for (size_t b = 0; b < n_bands; b++)
+        bounds[b] = n - static_cast<size_t>(std::round(
+                            n * std::sqrt(1 - static_cast<double>(b) / n_bands)));
+
+    return bounds;
+}
+
+
+// Chunks of the input files for n_threads workers taking them by work
+// stealing
+std::vector<VcfChunk> split_input_chunks(const Options& opts,
+                                         const std::vector<std::unique_ptr<HaplotypeVcfParser>>& headers,
+                                         size_t n_threads) {
+    std::vector<size_t> data_offsets;
+    std::vector<size_t> file_sizes;
+    size_t total_bytes { 0 };
+
+    for (const auto& header : headers) {
+        data_offsets.push_back(header->data_offset());
+        file_sizes.push_back(header->file_size());
+        total_bytes += header->file_size();
+    }
+
+    // thinning and minimum spacing depend on the preceding markers, so
+    // they need each file read in one piece
+    size_t chunk_bytes { 0 };
+
+    if (n_threads > 1 && !opts.marker_filter.sequential())
+        chunk_bytes = std::clamp(total_bytes / (16 * n_threads),
+                                 size_t { 4 } << 20, size_t { 256 } << 20);
+
+    return split_vcf_chunks(data_offsets, file_sizes, chunk_bytes);
+}
+
+
+// Each file is split in to chunks of records that the workers process
+// by work stealing, each in to its own partial GRM, for one thread or
+// kernels that can not add by bands of rows.  A partial GRM is
+// allocated by its worker, so its pages are first written by, and
+// placed on the memory node of, the thread that updates them.  The
+// partial GRMs are summed in to that of worker 0 in worker order.
+void accumulate_chunks(const Options& opts,
+                       const std::vector<std::unique_ptr<HaplotypeVcfParser>>& headers,
+                       std::vector<WorkerState>& states,
+                       const std::vector<PhaseCounters*>& counters,
+                       ProgressReporter& progress,
+                       Run& run) {
+
+    const size_t n_files { headers.size() };
+    const size_t n_threads { states.size() };
+    const HaplotypeVcfParser& first { *headers[0] };
 
-        if ((fout = fopen(filename_output, "w")) == nullptr)
-            throw std::runtime_error("Error in opening file for writing.");
+    const std::vector<VcfChunk> chunks { split_input_chunks(opts, headers, n_threads) };
+    WorkStealingScheduler scheduler { n_threads, chunks.size() };
 
-        delta_t = std::chrono::steady_clock::now() - timer;
-        fprintf(stdout, "Writing results to file %s, elapsed time %lld second(s)\n",
-                filename_output,
-                std::chrono::duration_cast<std::chrono::seconds>(delta_t).count());
+    run_workers(n_threads, [&](size_t worker) {
+        if (opts.pin_threads && !pin_thread(worker) && worker == 0)
+            fprintf(stderr, "Warning: threads could not be pinned to CPUs\n");
 
-    } else if (argc == 3 && filename_output == nullptr)
-        throw std::runtime_error("Output filename is not specified");
+        if (worker > 0)
+            counters[worker]->start();
 
+        WorkerState& state { states[worker] };
+        state.grm = make_accumulator(opts, first, worker);
+        state.ds_grm = make_ds_accumulator(opts, first);
 
-    size_t i { 0 };
-    size_t j { 0 };
-    for (i = 0; i < n_samples; i++) {
+        // parsers are opened on the first chunk of each file
+        std::vector<std::unique_ptr<HaplotypeVcfParser>> parsers(n_files);
+        std::vector<std::unique_ptr<HaplotypeDataRecord>> records(n_files);
+        std::vector<std::unique_ptr<HaplotypeDataRecord>> ds_records(n_files);
+        size_t task { 0 };
+
+        while (scheduler.next(worker, task)) {
+            const VcfChunk& chunk { chunks[task] };
+
+            if (!parsers[chunk.file]) {
+                parsers[chunk.file] = std::make_unique<HaplotypeVcfParser>(
+                                            100000, *headers[chunk.file]);
+                records[chunk.file] = std::make_unique<HaplotypeDataRecord>(
+                                            first.n_samples(), first.k_founders(),
+                                            headers[chunk.file]->sample_mask());
+                parsers[chunk.file]->set_profiler(counters[worker]);
+                use_uring(opts, *parsers[chunk.file]);
+                records[chunk.file]->set_profiler(counters[worker]);
+                ds_records[chunk.file] = make_ds_record(opts, first, *records[chunk.file]);
+            }
 
-        for (j = 0; j < n_samples-1; j++) {
-            if (j < i)
-                fprintf(fout, "%0.5f,", covariance(j,i));
-            else
-                fprintf(fout, "%0.5f,", covariance(i,j));
+            parsers[chunk.file]->set_range(chunk.begin, chunk.end);
 
+            accumulate_markers(*parsers[chunk.file], *records[chunk.file],
+                               ds_records[chunk.file].get(), state, counters[worker],
+                               progress);
         }
 
-        fprintf(fout,"%0.5f\n", covariance(i, j));
+        {
+            ScopedPhase timed { counters[worker], Phase::accumulate };
+            state.grm->flush();
+
+            if (state.ds_grm)
+                state.ds_grm->flush();
+        }
+
+        report_change_points(state.grm->kernel());
+
+        if (worker > 0)
+            counters[worker]->stop();
+    });
+
+    if (scheduler.n_steals() > 0)
+        fprintf(stderr, "%zu chunks in %zu files, %zu stolen between threads\n",
+                chunks.size(), n_files, scheduler.n_steals());
+
+    GrmAccumulator& total { *states[0].grm };
+
+    {
+        ScopedPhase timed { run.counters, Phase::accumulate };
+
+        // each thread adds the partial GRMs over one band of rows, in
+        // worker order
+        const std::vector<size_t> bands { upper_row_bands(first.n_samples(), n_threads) };
+
+        run_workers(n_threads, [&](size_t t) {
+            if (opts.pin_threads)
+                pin_thread(t);
+
+            for (size_t w = 1; w < n_threads; w++) {
+                total.merge_rows(*states[w].grm, bands[t], bands[t + 1]);
+
+                if (states[0].ds_grm)
+                    states[0].ds_grm->merge_rows(*states[w].ds_grm, bands[t], bands[t + 1]);
+            }
+        });
+
+        for (size_t t = 1; t < n_threads; t++) {
+            total.merge_totals(*states[t].grm);
+
+            if (states[0].ds_grm)
+                states[0].ds_grm->merge_totals(*states[t].ds_grm);
+
+            states[0].n_accepted += states[t].n_accepted;
+            states[0].n_rejected += states[t].n_rejected;
+            states[t].grm.reset();
+            states[t].ds_grm.reset();
+        }
     }
+}
 
-    fclose(fout);
 
+// Records parsed by one worker of accumulate_shared in a round, all
+// from one file, so parsed with its sample columns
+struct SharedBatch
+{
+    std::vector<std::unique_ptr<HaplotypeDataRecord>> records;
+    std::vector<std::unique_ptr<HaplotypeDataRecord>> ds_records;
+    std::vector<std::vector<double>> founder_weights;
+    std::vector<std::vector<double>> ds_weights;
+    size_t n_records { 0 };
+    size_t file { SIZE_MAX };       // file of the records
+    size_t task { 0 };              // chunk being parsed
+    bool in_chunk { false };
+};
+
+
+// As accumulate_chunks, the workers take chunks of the files by work
+// stealing, but all add to one GRM.  In each round every worker parses
+// a batch of records from its chunks, worker 0 adds the totals of the
+// batches in worker order, and then each worker adds every batch to its
+// own band of rows.  The pages of a band are first written by, and so
+// placed on the memory node of, the worker that updates them, and the
+// GRM takes one n x n matrix for any number of threads.  Requires a
+// banded_kernel.
+void accumulate_shared(const Options& opts,
+                       const std::vector<std::unique_ptr<HaplotypeVcfParser>>& headers,
+                       std::vector<WorkerState>& states,
+                       const std::vector<PhaseCounters*>& counters,
+                       ProgressReporter& progress) {
+
+    const size_t n_files { headers.size() };
+    const size_t n_threads { states.size() };
+    const HaplotypeVcfParser& first { *headers[0] };
+    const size_t n_samples { first.n_samples() };
+    const size_t k_founders { first.k_founders() };
+
+    const std::vector<VcfChunk> chunks { split_input_chunks(opts, headers, n_threads) };
+    WorkStealingScheduler scheduler { n_threads, chunks.size() };
+
+    // the parsed records of a round are held by all workers together
+    const size_t batch_size { std::clamp(DETERMINISTIC_BATCH_BYTES
+                                            / (n_threads * n_samples * k_founders
+                                               * sizeof(double)),
+                                         size_t { 16 }, size_t { 1024 }) };
+
+    WorkerState& state { states[0] };
+    state.grm = make_accumulator(opts, first, 0);
+    state.ds_grm = make_ds_accumulator(opts, first);
+
+    std::vector<SharedBatch> batches(n_threads);
+    const std::vector<size_t> bands { upper_row_bands(n_samples, n_threads) };
+    Barrier barrier { n_threads };
+
+    run_workers(n_threads, [&](size_t worker) {
+        if (opts.pin_threads && !pin_thread(worker) && worker == 0)
+            fprintf(stderr, "Warning: threads could not be pinned to CPUs\n");
+
+        if (worker > 0)
+            counters[worker]->start();
+
+        SharedBatch& batch { batches[worker] };
+        std::vector<std::unique_ptr<HaplotypeVcfParser>> parsers(n_files);
+
+        // records for the lines of file
+        auto use_file = [&](size_t file) {
+            batch.records.resize(batch_size);
+            batch.ds_records.resize(batch_size);
+            batch.founder_weights.resize(batch_size);
+            batch.ds_weights.resize(batch_size);
+
+            for (size_t l = 0; l < batch_size; l++) {
+                batch.records[l] = std::make_unique<HaplotypeDataRecord>(
+                                        n_samples, k_founders, headers[file]->sample_mask());
+                batch.records[l]->set_profiler(counters[worker]);
+                batch.ds_records[l] = make_ds_record(opts, first, *batch.records[l]);
+            }
+
+            batch.file = file;
+        };
+
+        try {
+            while (true) {
+                batch.n_records = 0;
+                size_t batch_bytes { 0 };
+
+                while (batch.n_records < batch_size) {
+                    if (!batch.in_chunk) {
+                        if (!scheduler.next(worker, batch.task))
+                            break;
+
+                        const VcfChunk& chunk { chunks[batch.task] };
+
+                        if (!parsers[chunk.file]) {
+                            parsers[chunk.file] = std::make_unique<HaplotypeVcfParser>(
+                                                        100000, *headers[chunk.file]);
+                            parsers[chunk.file]->set_profiler(counters[worker]);
+                            use_uring(opts, *parsers[chunk.file]);
+                        }
+
+                        parsers[chunk.file]->set_range(chunk.begin, chunk.end);
+                        batch.in_chunk = true;
+                    }
+
+                    const size_t file { chunks[batch.task].file };
+
+                    // a chunk of another file waits for the next round
+                    if (file != batch.file) {
+                        if (batch.n_records > 0)
+                            break;
+
+                        use_file(file);
+                    }
+
+                    HaplotypeVcfParser& parser { *parsers[file] };
+                    const size_t before { parser.bytes_read() };
+                    const bool loaded { parser.load_record(*batch.records[batch.n_records]) };
+                    batch_bytes += parser.bytes_read() - before;
+
+                    if (loaded) {
+                        batch.n_records++;
+                        continue;
+                    }
+
+                    states[worker].n_accepted += parser.marker_filter().n_accepted();
+                    states[worker].n_rejected += parser.marker_filter().n_rejected();
+                    batch.in_chunk = false;
+                }
+
+                progress.add(batch.n_records, batch_bytes);
+
+                if (!barrier.wait())
+                    break;
+
+                size_t n_round { 0 };
+                for (const SharedBatch& b : batches)
+                    n_round += b.n_records;
+
+                if (n_round == 0)
+                    break;
+
+                if (worker == 0) {
+                    ScopedPhase timed { counters[0], Phase::accumulate };
+
+                    for (SharedBatch& b : batches)
+                        for (size_t l = 0; l < b.n_records; l++) {
+                            state.grm->add_totals(*b.records[l], b.founder_weights[l]);
+
+                            if (state.ds_grm)
+                                state.ds_grm->add_totals(*b.ds_records[l], b.ds_weights[l]);
+                        }
+                }
+
+                if (!barrier.wait())
+                    break;
+
+                {
+                    ScopedPhase timed { counters[worker], Phase::accumulate };
+                    timed.add_markers(batch.n_records);
+
+                    for (const SharedBatch& b : batches)
+                        for (size_t l = 0; l < b.n_records; l++) {
+                            state.grm->add_rows(*b.records[l], b.founder_weights[l],
+                                                bands[worker], bands[worker + 1]);
+
+                            if (state.ds_grm)
+                                state.ds_grm->add_rows(*b.ds_records[l], b.ds_weights[l],
+                                                       bands[worker], bands[worker + 1]);
+                        }
+                }
+
+                // the records are parsed again only once every band is added
+                if (!barrier.wait())
+                    break;
+            }
+        } catch (...) {
+            barrier.abort();
+            throw;
+        }
+
+        if (worker > 0)
+            counters[worker]->stop();
+    });
+
+    if (scheduler.n_steals() > 0)
+        fprintf(stderr, "%zu chunks in %zu files, %zu stolen between threads\n",
+                chunks.size(), n_files, scheduler.n_steals());
+
+    for (size_t t = 1; t < n_threads; t++) {
+        state.n_accepted += states[t].n_accepted;
+        state.n_rejected += states[t].n_rejected;
+    }
+}
+
+
+// --deterministic: the markers are taken in file order in batches.
+// Worker 0 reads the lines of a batch, every worker parses some of
+// them, worker 0 adds the totals of each marker in order, and then each
+// worker adds the whole batch to its own band of rows of the one GRM.
+// Every entry is so summed in marker order, exactly as by one thread,
+// and the GRM is bitwise identical for any number of threads.  Worker 0
+// reads the next batch while the others finish their bands.
+void accumulate_in_order(const Options& opts,
+                         const std::vector<std::unique_ptr<HaplotypeVcfParser>>& headers,
+                         std::vector<WorkerState>& states,
+                         const std::vector<PhaseCounters*>& counters,
+                         ProgressReporter& progress) {
+
+    const size_t n_files { headers.size() };
+    const size_t n_threads { states.size() };
+    const HaplotypeVcfParser& first { *headers[0] };
+    const size_t n_samples { first.n_samples() };
+    const size_t k_founders { first.k_founders() };
+
+    // the batch size does not change the sums, it bounds the memory of
+    // the parsed records
+    const size_t batch_size { std::clamp(DETERMINISTIC_BATCH_BYTES
+                                            / (n_samples * k_founders * sizeof(double)),
+                                         size_t { 16 }, size_t { 1024 }) };
+
+    WorkerState& state { states[0] };
+    state.grm = make_accumulator(opts, first, 0);
+    state.ds_grm = make_ds_accumulator(opts, first);
+
+    std::vector<std::string> lines(batch_size);
+    std::vector<std::unique_ptr<HaplotypeDataRecord>> records(batch_size);
+    std::vector<std::unique_ptr<HaplotypeDataRecord>> ds_records(batch_size);
+    std::vector<std::vector<double>> founder_weights(batch_size);
+    std::vector<std::vector<double>> ds_weights(batch_size);
+
+    // record l is always parsed by worker l % n_threads
+    for (size_t l = 0; l < batch_size; l++) {
+        records[l] = std::make_unique<HaplotypeDataRecord>(n_samples, k_founders,
+                                                           first.sample_mask());
+        records[l]->set_profiler(counters[l % n_threads]);
+        ds_records[l] = make_ds_record(opts, first, *records[l]);
+    }
+
+    for (const auto& header : headers) {
+        header->set_profiler(counters[0]);
+        use_uring(opts, *header);
+    }
+
+    const std::vector<size_t> bands { upper_row_bands(n_samples, n_threads) };
+    Barrier barrier { n_threads };
+
+    size_t n_lines { 0 };
+    size_t batch_bytes { 0 };
+    size_t file { 0 };
+
+    run_workers(n_threads, [&](size_t worker) {
+        if (opts.pin_threads && !pin_thread(worker) && worker == 0)
+            fprintf(stderr, "Warning: threads could not be pinned to CPUs\n");
+
+        if (worker > 0)
+            counters[worker]->start();
+
+        try {
+            while (true) {
+                if (worker == 0) {
+                    n_lines = 0;
+                    batch_bytes = 0;
+
+                    while (n_lines < batch_size && file < n_files) {
+                        const size_t before { headers[file]->bytes_read() };
+                        const char* line { headers[file]->next_line() };
+                        batch_bytes += headers[file]->bytes_read() - before;
+
+                        if (line == nullptr) {
+                            file++;
+                            continue;
+                        }
+
+                        lines[n_lines++].assign(line);
+                    }
+                }
+
+                if (!barrier.wait())
+                    break;
+
+                // worker 0 changes n_lines only after its own band
+                const size_t n_batch { n_lines };
+
+                if (n_batch == 0)
+                    break;
+
+                for (size_t l = worker; l < n_batch; l += n_threads)
+                    records[l]->parse_vcf_line(lines[l].c_str());
+
+                if (!barrier.wait())
+                    break;
+
+                if (worker == 0) {
+                    ScopedPhase timed { counters[0], Phase::accumulate };
+
+                    for (size_t l = 0; l < n_batch; l++) {
+                        state.grm->add_totals(*records[l], founder_weights[l]);
+
+                        if (state.ds_grm)
+                            state.ds_grm->add_totals(*ds_records[l], ds_weights[l]);
+                    }
+
+                    progress.add(n_batch, batch_bytes);
+                }
+
+                if (!barrier.wait())
+                    break;
+
+                {
+                    ScopedPhase timed { counters[worker], Phase::accumulate };
+                    timed.add_markers(n_batch);
+
+                    for (size_t l = 0; l < n_batch; l++) {
+                        state.grm->add_rows(*records[l], founder_weights[l],
+                                            bands[worker], bands[worker + 1]);
+
+                        if (state.ds_grm)
+                            state.ds_grm->add_rows(*ds_records[l], ds_weights[l],
+                                                   bands[worker], bands[worker + 1]);
+                    }
+                }
+            }
+        } catch (...) {
+            barrier.abort();
+            throw;
+        }
+
+        if (worker > 0)
+            counters[worker]->stop();
+    });
+
+    for (const auto& header : headers) {
+        state.n_accepted += header->marker_filter().n_accepted();
+        state.n_rejected += header->marker_filter().n_rejected();
+    }
+}
+
+
+// Compute, normalize and write the GRM of the input VCFs, by
+// accumulate_shared with threads and a banded_kernel, accumulate_chunks
+// otherwise or, with --deterministic, accumulate_in_order.  The files
+// must hold the same samples and number of founders.
+int compute_grm(const Options& opts, const SampleSelection& selection, Run& run) {
+
+    const size_t n_files { opts.input_files.size() };
+    const size_t n_threads { opts.threads };
+
+    fprintf(stderr, "Allocating memory\n");
+
+    // open each VCF file and parse meta data and header, opening
+    // counts the lines of the file, so files are opened concurrently
+    std::vector<std::unique_ptr<HaplotypeVcfParser>> headers(n_files);
+    std::vector<char*> filenames;
+
+    for (const std::string& name : opts.input_files)
+        filenames.push_back(const_cast<char*>(name.c_str()));
+
+    run_workers(std::min(n_threads, n_files), [&](size_t worker) {
+        for (size_t f = worker; f < n_files; f += std::min(n_threads, n_files)) {
+            headers[f] = std::make_unique<HaplotypeVcfParser>(filenames[f], 100000,
+                                                              selection);
+            headers[f]->set_marker_filter(opts.marker_filter);
+        }
+    });
+
+    const HaplotypeVcfParser& first { *headers[0] };
+
+    for (size_t f = 1; f < n_files; f++)
+        if (headers[f]->sample_names() != first.sample_names()
+                || headers[f]->k_founders() != first.k_founders())
+            throw std::runtime_error(opts.input_files[f]
+                                     + ": samples or founders differ from "
+                                     + opts.input_files[0]);
+
+    size_t total_bytes { 0 };
+    for (const auto& header : headers)
+        total_bytes += header->file_size();
+
+    ProgressReporter progress { total_bytes, MARKER_PRINT_INTERVAL };
+
+    std::vector<WorkerState> states(n_threads);
+    std::vector<PhaseCounters*> counters(n_threads, run.counters);
+
+    for (size_t t = 1; t < n_threads; t++)
+        counters[t] = run.profiler.register_thread("worker " + std::to_string(t));
+
+    fprintf(stderr, "Computing matrix, elapsed time %lld second(s)\n",
+            elapsed_seconds(run.timer));
+
+    // the other kernels sum in to a partial GRM per thread
+    if (!opts.deterministic && n_threads > 1 && !banded_kernel(opts)) {
+        const double n_bytes { static_cast<double>(n_threads)
+                                * (opts.ds_output != nullptr ? 2 : 1)
+                                * first.n_samples() * first.n_samples() * sizeof(double) };
+
+        fprintf(stderr, "Each of %zu threads holds a partial GRM, %.1f GB in total\n",
+                n_threads, n_bytes / (size_t { 1 } << 30));
+    }
+
+    if (opts.deterministic)
+        accumulate_in_order(opts, headers, states, counters, progress);
+    else if (n_threads > 1 && banded_kernel(opts))
+        accumulate_shared(opts, headers, states, counters, progress);
+    else
+        accumulate_chunks(opts, headers, states, counters, progress, run);
+
+    GrmAccumulator& total { *states[0].grm };
+
+    {
+        ScopedPhase timed { run.counters, Phase::accumulate };
+        total.finalize();
+
+        if (states[0].ds_grm)
+            states[0].ds_grm->finalize();
+    }
+
+    if (total.n_missing() > 0)
+        fprintf(stderr, "%zu missing sample haplotype dosages\n", total.n_missing());
+
+    if (opts.marker_filter.active())
+        fprintf(stderr, "Used %zu marker loci, %zu rejected by marker filters\n",
+                states[0].n_accepted, states[0].n_rejected);
+
+    if (opts.mmap_output)
+        sync_grm(opts, total, run);
+    else
+        write_grm(opts, total.matrix(), first.sample_names(), total.n_markers(), run);
+
+    // the SNP dosage GRM is written in the same format, never mapped
+    if (states[0].ds_grm) {
+        Options ds_opts { opts };
+        ds_opts.output = opts.ds_output;
+
+        write_grm(ds_opts, states[0].ds_grm->matrix(), first.sample_names(),
+                  states[0].ds_grm->n_markers(), run);
+    }
+
+    finish_run(opts, run, first.n_samples(), first.k_founders(), total.n_markers());
+
+    return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+
+    Options opts { parse_args(argc, argv) };
+
+    if (opts.help) {
+        print_help();
+        return 0;
+    }
+
+    char* filename_input { opts.input };
+
+    SampleSelection selection;
+
+    if (opts.keep_file != nullptr) {
+        selection.keep = read_sample_ids(opts.keep_file);
+        selection.has_keep = true;
+    }
+
+    if (opts.remove_file != nullptr)
+        selection.remove = read_sample_ids(opts.remove_file);
+
+
+    Matrix::use_huge_pages(opts.huge_pages);
+
+    Run run;
+
+    if (opts.extend_file == nullptr && opts.n_pcs == 0 && opts.update_file == nullptr)
+        return compute_grm(opts, selection, run);
+
+    if (opts.update_file != nullptr) {
+        GrmBinary grm { read_grm_binary(opts.update_file) };
+        size_t m_markers { update_grm(opts, grm, run) };
+
+        write_grm(opts, *grm.covariance, grm.sample_ids, m_markers, run);
+
+        finish_run(opts, run, grm.sample_ids.size(), 0, m_markers);
+        return 0;
+    }
+
+
+    fprintf(stderr, "Allocating memory\n");
+
+    // open VCF file and parse meta data and header
+    HaplotypeVcfParser vcf_data { filename_input, 100000, selection };
+    vcf_data.set_marker_filter(opts.marker_filter);
+
+
+    // instantiate record object
+    HaplotypeDataRecord record { vcf_data.n_samples(),
+                                 vcf_data.k_founders(),
+                                 vcf_data.sample_mask() };
+
+    instrument(run, vcf_data, record);
+    use_uring(opts, vcf_data);
+
+    if (opts.n_pcs > 0) {
+        size_t m_markers { compute_pcs(opts, vcf_data, record, run) };
+        finish_run(opts, run, vcf_data.n_samples(), vcf_data.k_founders(), m_markers);
+        return 0;
+    }
+
+    // instantiate matrices to hold calculations
+    Matrix covariance { vcf_data.n_samples(), vcf_data.n_samples() };
+
+    fprintf(stderr, "Computing matrix, elapsed time %lld second(s)\n",
+            elapsed_seconds(run.timer));
+
+    size_t m_markers { extend_grm(opts, opts.extend_file, vcf_data, record,
+                                  covariance, run) };
+
+    if (opts.marker_filter.active())
+        fprintf(stderr, "Used %zu marker loci, %zu rejected by marker filters\n",
+                vcf_data.marker_filter().n_accepted(),
+                vcf_data.marker_filter().n_rejected());
 
-    delta_t = std::chrono::steady_clock::now() - timer;
+    write_grm(opts, covariance, vcf_data.sample_names(), m_markers, run);
 
-    fprintf(stdout, "Done, elapsed time %lld second(s)\n",
-            std::chrono::duration_cast<std::chrono::seconds>(delta_t).count());
+    finish_run(opts, run, vcf_data.n_samples(), vcf_data.k_founders(), m_markers);
 
     return 0;
 }
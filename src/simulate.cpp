@@ -0,0 +1,105 @@
+// Write simulated haplotype dosage VCFs for benchmarking and testing
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// Input argument
+//    filename: output vcf, standard out when omitted or "-"
+//
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include "VcfSimulator.h"
+
+
+char SIM_HELP_LONG_FLAG[] { "--help" };
+char SIM_HELP_SHORT_FLAG[] { "-h" };
+char SAMPLES_FLAG[] { "--samples" };
+char FOUNDERS_FLAG[] { "--founders" };
+char MARKERS_FLAG[] { "--markers" };
+char BLOCK_LENGTH_FLAG[] { "--block-length" };
+char NOISE_FLAG[] { "--noise" };
+char SPACING_FLAG[] { "--spacing" };
+char CHROM_FLAG[] { "--chrom" };
+char SIM_SEED_FLAG[] { "--seed" };
+
+
+void print_help() {
+    printf("hgrm_simulate - Write a simulated haplotype dosage VCF.\n"
+           "Usage\n"
+           "\n"
+           "  hgrm_simulate [options] [<output_vcf_filename>]\n"
+           "\n"
+           "Options\n"
+           "  output_vcf_filename      Output file, standard out if omitted or -\n"
+           "  --samples <n>            Number of samples (100)\n"
+           "  --founders <K>           Number of founder haplotypes (8)\n"
+           "  --markers <m>            Number of markers (1000)\n"
+           "  --block-length <L>       Mean haplotype block length in markers (500)\n"
+           "  --noise <e>              Haplotype dosage noise, 0 to 1 (0.01)\n"
+           "  --spacing <bp>           Mean distance between markers (100)\n"
+           "  --chrom <name>           Chromosome name (chr1)\n"
+           "  --seed <s>               Random seed (1)\n"
+           "\n"
+           "Description\n"
+           "  Samples are mosaics of K founder haplotypes, written with\n"
+           "  GT:GP:DS:HD sample fields as produced by STITCH.\n");
+}
+
+
+char* option_value(int argc, char* argv[], int& i) {
+    if (i + 1 >= argc)
+        throw std::runtime_error("Option requires a value");
+    return argv[++i];
+}
+
+
+int main(int argc, char* argv[])
+{
+    SimulationParams params;
+    char* filename_output { nullptr };
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], SIM_HELP_SHORT_FLAG) == 0
+                || strcmp(argv[i], SIM_HELP_LONG_FLAG) == 0) {
+            print_help();
+            return 0;
+        }
+
+        if (strcmp(argv[i], SAMPLES_FLAG) == 0)
+            params.n_samples = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], FOUNDERS_FLAG) == 0)
+            params.k_founders = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], MARKERS_FLAG) == 0)
+            params.n_markers = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], BLOCK_LENGTH_FLAG) == 0)
+            params.block_length = std::atof(option_value(argc, argv, i));
+        else if (strcmp(argv[i], NOISE_FLAG) == 0)
+            params.noise = std::atof(option_value(argc, argv, i));
+        else if (strcmp(argv[i], SPACING_FLAG) == 0)
+            params.spacing = std::atol(option_value(argc, argv, i));
+        else if (strcmp(argv[i], CHROM_FLAG) == 0)
+            params.chrom = option_value(argc, argv, i);
+        else if (strcmp(argv[i], SIM_SEED_FLAG) == 0)
+            params.seed = std::strtoul(option_value(argc, argv, i), nullptr, 10);
+        else if (argv[i][0] == '-' && argv[i][1] == '-')
+            throw std::runtime_error("Unknown option");
+        else if (filename_output == nullptr)
+            filename_output = argv[i];
+        else
+            throw std::runtime_error("Only one output filename may be given");
+    }
+
+    if (filename_output == nullptr || strcmp(filename_output, "-") == 0) {
+        VcfSimulator simulator { params };
+        simulator.write(stdout);
+        fflush(stdout);
+        return 0;
+    }
+
+    write_simulated_vcf(filename_output, params);
+
+    return 0;
+}
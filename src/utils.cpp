@@ -1,4 +1,5 @@
 #include "../include/utils.h"
+#include <sys/stat.h>
 
 const static size_t DEFAULT_BUFFER_SIZE { 1000 };
 
@@ -52,7 +53,7 @@ void CharBuffer::append(char s) {
 
 void CharBuffer::reset(size_t buffer_size) {
     buffer_size_ = buffer_size;
-    buffer_ = std::make_unique<char[]>(buffer_size_);
+    buffer_ = std::make_unique<char[]>(buffer_size_+1);
     buffer_[0] = '\0';
     buffer_[buffer_size_] = '\0';
     buffer_idx_ = 0;
@@ -177,6 +178,29 @@ bool StringRecord::next_field() {
 }
 
 
+// Same field boundaries as next_field, but the characters are not
+// copied to the buffer.  Used to pass over sample columns that are
+// excluded from the analysis.
+bool StringRecord::skip_field() {
+    if (!str_ || idx_ == size())
+        return false;
+
+    for(; idx_ < size(); idx_++)
+        if (!is_delim_(str_[idx_]))
+            break;
+
+    buf_.reset();
+    for (; idx_ < size(); idx_++) {
+        if (is_delim_(str_[idx_])) {
+            idx_++;
+            break;
+        }
+    }
+
+    return true;
+}
+
+
 // bool StringRecord::is_delim_(char s) {
 //     return s == delim_;
 // }
@@ -245,6 +269,107 @@ size_t BufferedRead::get_line(CharBuffer& line_buffer) {
 }
 
 
+// Note:
+// The delimiter ending the last field is appended to line_buffer, and
+// the newline is left in the stream.  Return count == 0 indicates the
+// end of file.
+size_t BufferedRead::get_fields(CharBuffer& line_buffer, char delim, size_t n_fields) {
+
+    line_buffer.reset();
+
+    size_t count { 0 };
+    size_t n_delim { 0 };
+    size_t buff_length { 1 };
+    char c { '\0' };
+
+    if (buffer_[buffer_pos_] == '\0'
+            || buffer_pos_ == buff_size_)
+        buff_length = update_buffer_();
+
+    if (buff_length == 0)
+        return count;
+
+    while (buffer_[buffer_pos_] != '\n') {
+
+        c = buffer_[buffer_pos_++];
+        line_buffer.append(c);
+        count++;
+
+        if (buffer_[buffer_pos_] == '\0' || buffer_pos_ == buff_size_)
+            buff_length = update_buffer_();
+
+        if (buff_length == 0)
+            break;
+
+        if (c == delim && ++n_delim == n_fields)
+            break;
+    }
+
+    return count;
+}
+
+
+// Continue reading the current line in to line_buffer, without
+// resetting the buffer.
+size_t BufferedRead::append_line(CharBuffer& line_buffer) {
+
+    size_t count { 0 };
+    size_t buff_length { 1 };
+
+    if (buffer_[buffer_pos_] == '\0'
+            || buffer_pos_ == buff_size_)
+        buff_length = update_buffer_();
+
+    if (buff_length == 0)
+        return count;
+
+    while (buffer_[buffer_pos_] != '\n') {
+
+        line_buffer.append(buffer_[buffer_pos_++]);
+        count++;
+
+        if (buffer_[buffer_pos_] == '\0' || buffer_pos_ == buff_size_)
+            buff_length = update_buffer_();
+
+        if (buff_length == 0)
+            break;
+    }
+
+    if (buffer_[buffer_pos_] == '\n')
+        buffer_pos_++;
+
+    return count;
+}
+
+
+// Discard the remainder of the current line.  Only searches for the
+// newline, characters are neither copied nor inspected otherwise.
+size_t BufferedRead::skip_line() {
+
+    size_t count { 0 };
+    const char* newline { nullptr };
+
+    while (true) {
+        if (buffer_[buffer_pos_] == '\0' || buffer_pos_ == buff_size_)
+            if (update_buffer_() == 0)
+                return count;
+
+        newline = static_cast<const char*>(std::memchr(&buffer_[buffer_pos_], '\n',
+                                                       buffer_len_ - buffer_pos_));
+
+        if (newline != nullptr) {
+            count += newline - &buffer_[buffer_pos_];
+            buffer_pos_ = newline - buffer_.get() + 1;
+            return count;
+        }
+
+        // buffer_[buffer_len_] is the null terminator
+        count += buffer_len_ - buffer_pos_;
+        buffer_pos_ = buffer_len_;
+    }
+}
+
+
 char BufferedRead::get_char() {
     size_t buff_length { 1 };
 
@@ -266,24 +391,48 @@ size_t BufferedRead::update_buffer_() {
     if (std::ferror(fid_))
         throw std::runtime_error("File read error");
 
+    buffer_start_ += buffer_len_;
+
     // note, if end of file, then we set n = 0;
     size_t n { 0 };
-    if (!std::feof(fid_)) 
+    size_t count { 0 };
+
+    if (uring_) {
+        while (n < buff_size_
+                && (count = uring_->read(buffer_.get() + n, buff_size_ - n)) > 0)
+            n += count;
+    } else if (!std::feof(fid_)) 
         n = fread(buffer_.get(), sizeof(buffer_[0]), buff_size_, fid_);
 
     buffer_pos_ = 0;
+    buffer_len_ = n;
     buffer_[n] = '\0';
 
     return n;
 }
 
 
+void BufferedRead::seek(size_t n, size_t readahead_end) {
+    readahead_end_ = readahead_end;
+    seek(n);
+}
+
+
 void BufferedRead::seek(size_t n) {
 
     int c = 0;
     if ((c = std::fseek(fid_, n, SEEK_SET)) != 0)
         throw std::runtime_error("Failed to relocate file stream to position.");
 
+    if (uring_)
+        uring_->seek(n, readahead_end_);
+
+    // buffered characters are from the previous position
+    buffer_start_ = n;
+    buffer_pos_ = 0;
+    buffer_len_ = 0;
+    buffer_[buffer_pos_] = '\0';
+
 }
 
 
@@ -292,10 +441,135 @@ size_t BufferedRead::tell() {
 }
 
 
+size_t BufferedRead::offset() const {
+    return buffer_start_ + buffer_pos_;
+}
+
+
+size_t BufferedRead::file_size() const {
+    struct stat st;
+    if (fstat(fileno(fid_), &st) != 0)
+        return 0;
+    return st.st_size;
+}
+
+
+bool BufferedRead::use_uring(const UringOptions& options) {
+
+    if (!UringReader::available())
+        return false;
+
+    const size_t position { offset() };
+
+    try {
+        uring_ = std::make_unique<UringReader>(filename_, options);
+    } catch (const std::runtime_error&) {
+        uring_.reset();
+        return false;
+    }
+
+    seek(position);
+    return true;
+}
+
+
+bool BufferedRead::uses_uring() const { return uring_ != nullptr; }
+
+
 void BufferedRead::reset() {
     buffer_pos_ = 0;
+    buffer_len_ = 0;
     buffer_[buffer_pos_] = '\0';
     seek(0);
 }
 
 
+
+
+std::vector<std::string> read_sample_ids(const char* filename) {
+
+    FILE* fid { std::fopen(filename, "r") };
+
+    if (!fid)
+        throw std::runtime_error("Unable to open sample id file");
+
+    std::vector<std::string> ids;
+    std::string line;
+    int c { 0 };
+
+    while (true) {
+        c = std::fgetc(fid);
+
+        if (c != '\n' && c != EOF) {
+            line.push_back(static_cast<char>(c));
+            continue;
+        }
+
+        // split line in to white space delimited columns
+        std::vector<std::string> cols;
+        std::string col;
+        for (char s : line) {
+            if (std::isspace(s)) {
+                if (!col.empty())
+                    cols.push_back(col);
+                col.clear();
+            } else
+                col.push_back(s);
+        }
+        if (!col.empty())
+            cols.push_back(col);
+
+        if (cols.size() == 1)
+            ids.push_back(cols[0]);
+        else if (cols.size() == 2)
+            ids.push_back(cols[1]);
+        else if (cols.size() > 2) {
+            std::fclose(fid);
+            throw std::runtime_error("Sample id file must have one or two columns");
+        }
+
+        line.clear();
+
+        if (c == EOF)
+            break;
+    }
+
+    std::fclose(fid);
+    return ids;
+}
+
+
+std::vector<std::string> read_lines(const char* filename) {
+
+    FILE* fid { std::fopen(filename, "r") };
+
+    if (!fid)
+        throw std::runtime_error("Unable to open file");
+
+    std::vector<std::string> lines;
+    std::string line;
+    int c { 0 };
+
+    while (true) {
+        c = std::fgetc(fid);
+
+        if (c != '\n' && c != EOF) {
+            line.push_back(static_cast<char>(c));
+            continue;
+        }
+
+        size_t first { line.find_first_not_of(" \t\r") };
+        if (first != std::string::npos) {
+            size_t last { line.find_last_not_of(" \t\r") };
+            lines.push_back(line.substr(first, last - first + 1));
+        }
+
+        line.clear();
+
+        if (c == EOF)
+            break;
+    }
+
+    std::fclose(fid);
+    return lines;
+}
@@ -0,0 +1,91 @@
+#include "../include/ChangePointAccumulator.h"
+#include "../include/GrmKernels.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+
+
+TEST(TestChangePointAccumulator, MatchesDense) {
+    char fname[] { "../tests/test.vcf" };
+
+    HaplotypeVcfParser vcf_data { fname, 1000 };
+    const size_t n { vcf_data.n_samples() };
+    HaplotypeDataRecord record { n, vcf_data.k_founders() };
+
+    ChangePointAccumulator change_points { n, vcf_data.k_founders() };
+    Matrix dense { n, n };
+    Matrix delta { n, n };
+
+    while (vcf_data.load_record(record)) {
+        accumulate_upper(record, dense, 2);
+        change_points.add_marker(record, delta, 2);
+    }
+    change_points.flush(delta, 2);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++)
+            EXPECT_NEAR(delta(i, j), dense(i, j), 1e-9 * std::fabs(dense(i, j)));
+}
+
+
+TEST(TestChangePointAccumulator, OnlyChangedSamples) {
+    char first[] { "chr1 1 . A T Q F I HD 1,1,0 0,2,0 0,0,2\n" };
+    char second[] { "chr1 2 . A T Q F I HD 1,1,0 0,1,1 0,0,2\n" };
+
+    HaplotypeDataRecord record { 3, 3 };
+    ChangePointAccumulator change_points { 3, 3 };
+    Matrix cov { 3, 3 };
+
+    record.parse_vcf_line(first);
+    change_points.add_marker(record, cov);
+    EXPECT_EQ(change_points.n_changes(), 3);
+
+    for (size_t m = 0; m < 4; m++)
+        change_points.add_marker(record, cov);
+    EXPECT_EQ(change_points.n_changes(), 3);
+
+    record.parse_vcf_line(second);
+    change_points.add_marker(record, cov);
+    change_points.add_marker(record, cov);
+    EXPECT_EQ(change_points.n_changes(), 4);
+
+    // pending until flushed
+    EXPECT_DOUBLE_EQ(cov(0, 0), 0);
+    EXPECT_DOUBLE_EQ(cov(0, 1), 5 * 2);
+
+    change_points.flush(cov);
+
+    EXPECT_EQ(change_points.n_markers(), 7);
+    EXPECT_DOUBLE_EQ(cov(0, 0), 7 * 2);
+    EXPECT_DOUBLE_EQ(cov(0, 1), 5 * 2 + 2 * 1);
+    EXPECT_DOUBLE_EQ(cov(1, 1), 5 * 4 + 2 * 2);
+    EXPECT_DOUBLE_EQ(cov(1, 2), 2 * 2);
+    EXPECT_DOUBLE_EQ(cov(0, 2), 0);
+
+    // flushing twice adds nothing
+    change_points.flush(cov);
+    EXPECT_DOUBLE_EQ(cov(2, 2), 7 * 4);
+}
+
+
+TEST(TestChangePointAccumulator, Tolerance) {
+    char first[] { "chr1 1 . A T Q F I HD 1,1 0,2\n" };
+    char second[] { "chr1 2 . A T Q F I HD 1.01,0.99 0,2\n" };
+
+    HaplotypeDataRecord record { 2, 2 };
+    ChangePointAccumulator change_points { 2, 2, 0.05 };
+    Matrix cov { 2, 2 };
+
+    record.parse_vcf_line(first);
+    change_points.add_marker(record, cov);
+    record.parse_vcf_line(second);
+    change_points.add_marker(record, cov);
+    change_points.flush(cov);
+
+    EXPECT_EQ(change_points.n_changes(), 2);
+    EXPECT_DOUBLE_EQ(cov(0, 0), 2 * 2);
+
+    Matrix wrong { 3, 3 };
+    EXPECT_THROW(change_points.add_marker(record, wrong), std::runtime_error);
+    EXPECT_THROW(ChangePointAccumulator(2, 2, -1), std::runtime_error);
+}
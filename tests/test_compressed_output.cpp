@@ -0,0 +1,140 @@
+#include "../include/CompressedOutput.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <zlib.h>
+
+
+
+// every gzip member of data, concatenated
+std::string gunzip(const std::string& data) {
+    std::string out;
+    char buffer[4096];
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    EXPECT_EQ(inflateInit2(&stream, 16 + MAX_WBITS), Z_OK);
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = data.size();
+
+    while (stream.avail_in > 0) {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+
+        int status { inflate(&stream, Z_NO_FLUSH) };
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+
+        if (status == Z_STREAM_END)
+            inflateReset(&stream);
+        else if (status != Z_OK) {
+            ADD_FAILURE() << "inflate failed";
+            break;
+        }
+    }
+
+    inflateEnd(&stream);
+    return out;
+}
+
+
+std::string chunk_text(size_t c) {
+    std::string text;
+    for (size_t i = 0; i < 2000 + 37 * c; i++)
+        text += std::to_string((c * 7919 + i * 104729) % 100003) + (i % 10 == 9 ? "\n" : ",");
+    return text;
+}
+
+
+std::string read_file(FILE* fid) {
+    std::string data;
+    char buffer[4096];
+    size_t n { 0 };
+
+    std::rewind(fid);
+    while ((n = std::fread(buffer, 1, sizeof(buffer), fid)) > 0)
+        data.append(buffer, n);
+
+    return data;
+}
+
+
+TEST(TestCompressedOutput, ParseCompression) {
+    EXPECT_EQ(parse_compression("none"), Compression::none);
+    EXPECT_EQ(parse_compression("gzip"), Compression::gzip);
+    EXPECT_EQ(parse_compression("zstd"), Compression::zstd);
+    EXPECT_THROW(parse_compression("bzip2"), std::runtime_error);
+    EXPECT_TRUE(compression_available(Compression::gzip));
+}
+
+
+// more than 64 KB, split in to several BGZF blocks
+TEST(TestCompressedOutput, BgzfBlocks) {
+    std::string text;
+    for (size_t c = 0; c < 20; c++)
+        text += chunk_text(c);
+
+    std::string compressed;
+    compress_blocks(Compression::gzip, text.data(), text.size(), compressed);
+
+    EXPECT_EQ(gunzip(compressed), text);
+    EXPECT_LT(compressed.size(), text.size());
+
+    // each block records its size in the BC extra field
+    size_t n_blocks { 0 };
+    for (size_t pos = 0; pos < compressed.size(); n_blocks++) {
+        ASSERT_EQ(static_cast<unsigned char>(compressed[pos]), 0x1f);
+        ASSERT_EQ(compressed[pos + 12], 'B');
+        ASSERT_EQ(compressed[pos + 13], 'C');
+
+        pos += static_cast<unsigned char>(compressed[pos + 16])
+                + 256 * static_cast<unsigned char>(compressed[pos + 17]) + 1;
+    }
+
+    EXPECT_GE(n_blocks, text.size() / 0xff00);
+}
+
+
+// chunks are written in order whatever thread compressed them
+TEST(TestCompressedOutput, Chunks) {
+    const size_t n_chunks { 23 };
+    std::string expected;
+    for (size_t c = 0; c < n_chunks; c++)
+        expected += chunk_text(c);
+
+    for (size_t n_threads : { 1, 3 }) {
+        for (Compression compression : { Compression::none, Compression::gzip }) {
+            FILE* fid { std::tmpfile() };
+            size_t n_bytes { write_compressed_chunks(fid, compression, n_chunks,
+                                                     [](size_t c, std::string& text) {
+                                                         text = chunk_text(c);
+                                                     }, n_threads) };
+
+            std::string data { read_file(fid) };
+            std::fclose(fid);
+
+            EXPECT_EQ(n_bytes, data.size());
+            EXPECT_EQ(compression == Compression::gzip ? gunzip(data) : data, expected);
+        }
+    }
+}
+
+
+TEST(TestCompressedOutput, Zstd) {
+    std::string compressed;
+
+    if (!compression_available(Compression::zstd)) {
+        EXPECT_THROW(compress_blocks(Compression::zstd, "a", 1, compressed),
+                     std::runtime_error);
+        return;
+    }
+
+    std::string text { chunk_text(1) };
+    compress_blocks(Compression::zstd, text.data(), text.size(), compressed);
+
+    // zstd frame magic number
+    ASSERT_GE(compressed.size(), 4);
+    EXPECT_EQ(static_cast<unsigned char>(compressed[0]), 0x28);
+    EXPECT_EQ(static_cast<unsigned char>(compressed[3]), 0xfd);
+    EXPECT_LT(compressed.size(), text.size());
+}
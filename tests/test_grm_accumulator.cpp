@@ -0,0 +1,223 @@
+#include "../include/GrmAccumulator.h"
+#include "../include/GrmKernels.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+
+char VCF_NAME[] { "../tests/test.vcf" };
+
+
+void expect_upper_near(const double* a, const Matrix& b) {
+    const size_t n { b.dims()[0] };
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++)
+            EXPECT_NEAR(a[i * n + j], b(i, j), 1e-9 * (1 + std::fabs(b(i, j))));
+}
+
+
+TEST(TestGrmAccumulator, Dense) {
+    HaplotypeVcfParser vcf_data { VCF_NAME, 1000 };
+    const size_t n { vcf_data.n_samples() };
+    HaplotypeDataRecord record { n, vcf_data.k_founders() };
+
+    GrmAccumulator grm { n, vcf_data.k_founders() };
+    Matrix expected { n, n };
+
+    while (vcf_data.load_record(record)) {
+        grm.add(record);
+        accumulate_upper(record, expected);
+    }
+
+    grm.finalize();
+
+    EXPECT_TRUE(grm.finalized());
+    EXPECT_EQ(grm.n_markers(), 8);
+    EXPECT_EQ(grm.data(), grm.matrix().data());
+    expect_upper_near(grm.data(), expected);
+
+    EXPECT_THROW(grm.add(record), std::runtime_error);
+
+    std::unique_ptr<Matrix> released { grm.release() };
+    EXPECT_EQ(grm.data(), nullptr);
+    expect_upper_near(released->data(), expected);
+}
+
+
+TEST(TestGrmAccumulator, RawDosages) {
+    char line[] { "chr1 1 . A T Q F I HD 1,1 . 0.5,1.5\n" };
+
+    HaplotypeDataRecord record { 3, 2 };
+    record.parse_vcf_line(line);
+
+    const std::vector<double> dosages { 1, 1, 7, 7, 0.5, 1.5 };
+    const uint64_t valid { 0b101 };
+
+    GrmOptions options;
+    options.normalize = Normalization::center;
+    options.pair_counts = true;
+
+    GrmAccumulator from_record { 3, 2, options };
+    GrmAccumulator from_raw { 3, 2, options };
+
+    from_record.add(record);
+    from_raw.add(dosages.data(), &valid);
+
+    // every sample observed
+    char second[] { "chr1 2 . A T Q F I HD 2,0 0,2 1,1\n" };
+    const std::vector<double> second_dosages { 2, 0, 0, 2, 1, 1 };
+
+    record.parse_vcf_line(second);
+    from_record.add(record);
+    from_raw.add(second_dosages.data());
+
+    EXPECT_EQ(from_raw.n_missing(), 1);
+
+    from_record.finalize();
+    from_raw.finalize();
+    expect_upper_near(from_raw.data(), from_record.matrix());
+}
+
+
+// records parsed in to the panel, or copied when not attached
+TEST(TestGrmAccumulator, Panel) {
+    for (bool attach : { true, false }) {
+        HaplotypeVcfParser vcf_data { VCF_NAME, 1000 };
+        const size_t n { vcf_data.n_samples() };
+        const size_t k { vcf_data.k_founders() };
+        HaplotypeDataRecord record { n, k };
+
+        GrmOptions options;
+        options.normalize = Normalization::center;
+
+        GrmAccumulator expected { n, k, options };
+
+        options.panel_markers = 3;
+        GrmAccumulator grm { n, k, options };
+
+        if (attach) {
+            grm.attach(record);
+            EXPECT_EQ(record.layout(), RecordLayout::founder_major);
+        }
+
+        // add moves an attached record on to the next marker of the panel
+        while (vcf_data.load_record(record)) {
+            expected.add(record);
+            grm.add(record);
+        }
+
+        grm.finalize();
+        expected.finalize();
+
+        EXPECT_EQ(grm.n_markers(), 8);
+        expect_upper_near(grm.data(), expected.matrix());
+    }
+
+    GrmOptions options;
+    options.panel_markers = 4;
+    options.kernel = GrmKernel::sparse;
+    EXPECT_THROW(GrmAccumulator(3, 2, options), std::runtime_error);
+}
+
+
+// totals in marker order and products by bands of rows give the GRM of
+// add, bit for bit
+TEST(TestGrmAccumulator, Bands) {
+    for (Normalization normalize : { Normalization::none, Normalization::standardize }) {
+        HaplotypeVcfParser vcf_data { VCF_NAME, 1000 };
+        const size_t n { vcf_data.n_samples() };
+        const size_t k { vcf_data.k_founders() };
+        HaplotypeDataRecord record { n, k };
+
+        GrmOptions options;
+        options.normalize = normalize;
+        options.pair_counts = true;
+
+        GrmAccumulator expected { n, k, options };
+        GrmAccumulator banded { n, k, options };
+        std::vector<double> founder_weights;
+
+        while (vcf_data.load_record(record)) {
+            expected.add(record);
+            banded.add_totals(record, founder_weights);
+
+            EXPECT_EQ(founder_weights.size(),
+                      normalize == Normalization::standardize ? k : 0);
+
+            banded.add_rows(record, founder_weights, 4, n);
+            banded.add_rows(record, founder_weights, 0, 4);
+        }
+
+        expected.finalize();
+        banded.finalize();
+
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = i; j < n; j++)
+                EXPECT_EQ(banded.matrix()(i, j), expected.matrix()(i, j));
+    }
+
+    GrmOptions options;
+    options.kernel = GrmKernel::sparse;
+    GrmAccumulator sparse { 3, 2, options };
+    HaplotypeDataRecord record { 3, 2 };
+    std::vector<double> founder_weights;
+    EXPECT_THROW(sparse.add_totals(record, founder_weights), std::runtime_error);
+
+    GrmAccumulator dense { 3, 2 };
+    EXPECT_THROW(dense.add_rows(record, founder_weights, 2, 4), std::out_of_range);
+}
+
+
+// markers split between two accumulators, merged by rows and totals
+TEST(TestGrmAccumulator, Merge) {
+    for (GrmKernel kernel : { GrmKernel::dense, GrmKernel::sparse,
+                              GrmKernel::change_points }) {
+        HaplotypeVcfParser vcf_data { VCF_NAME, 1000 };
+        const size_t n { vcf_data.n_samples() };
+        const size_t k { vcf_data.k_founders() };
+        HaplotypeDataRecord record { n, k };
+
+        GrmOptions options;
+        options.kernel = kernel;
+        options.normalize = Normalization::center;
+
+        GrmAccumulator all { n, k, options };
+        GrmAccumulator first { n, k, options };
+        GrmAccumulator second { n, k, options };
+
+        for (size_t m = 0; vcf_data.load_record(record); m++) {
+            all.add(record);
+            (m < 3 ? first : second).add(record);
+        }
+
+        if (kernel == GrmKernel::change_points) {
+            EXPECT_THROW(first.merge(second), std::runtime_error);
+        }
+
+        second.flush();
+        first.merge_rows(second, 0, n / 2);
+        first.merge_rows(second, n / 2, n);
+        first.merge_totals(second);
+
+        all.finalize();
+        first.finalize();
+
+        EXPECT_EQ(first.n_markers(), all.n_markers());
+        expect_upper_near(first.data(), all.matrix());
+    }
+
+    GrmAccumulator a { 3, 2 };
+    GrmOptions options;
+    options.normalize = Normalization::center;
+    GrmAccumulator b { 3, 2, options };
+
+    EXPECT_THROW(a.merge(b), std::runtime_error);
+    EXPECT_THROW(a.merge(a), std::runtime_error);
+    EXPECT_THROW(a.merge_rows(GrmAccumulator { 3, 2 }, 0, 4), std::out_of_range);
+
+    options.kernel = GrmKernel::pair_states;
+    options.normalize = Normalization::standardize;
+    EXPECT_THROW(GrmAccumulator(3, 2, options), std::runtime_error);
+}
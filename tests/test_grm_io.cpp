@@ -0,0 +1,196 @@
+#include "../include/GrmIO.h"
+#include <gtest/gtest.h>
+
+
+
+TEST(TestGrmIO, BinaryRoundTrip) {
+    char fname[] { "test_grm_io_roundtrip.bin" };
+    std::vector<std::string> ids { "S01", "sample_two", "S3" };
+
+    Matrix a { 3, 3 };
+    double x { 1 };
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = i; j < 3; j++)
+            a(i, j) = x++ / 3;
+
+    write_grm_binary(fname, a, ids, 42);
+
+    GrmBinary grm { read_grm_binary(fname) };
+    std::remove(fname);
+
+    EXPECT_EQ(grm.n_markers, 42);
+    ASSERT_EQ(grm.sample_ids.size(), 3);
+    EXPECT_EQ(grm.sample_ids[1], "sample_two");
+
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = i; j < 3; j++)
+            EXPECT_EQ((*grm.covariance)(i, j), a(i, j));
+}
+
+
+// complete, unlike the file of an interrupted mapped run
+TEST(TestGrmIO, NoMarkers) {
+    char fname[] { "test_grm_io_no_markers.bin" };
+
+    write_grm_binary(fname, Matrix { 2, 2 }, { "a", "b" }, 0);
+
+    GrmBinary grm { read_grm_binary(fname) };
+    std::remove(fname);
+
+    EXPECT_EQ(grm.n_markers, 0);
+    EXPECT_EQ(grm.sample_ids.size(), 2);
+}
+
+
+TEST(TestGrmIO, Header) {
+    GrmBinaryHeader header { make_grm_header({ "a", "bc" }, 7) };
+
+    EXPECT_EQ(header.n_samples, 2);
+    EXPECT_EQ(header.n_markers, 7);
+    EXPECT_EQ(header.id_bytes, 5);
+    EXPECT_EQ(header.data_offset % GRM_DATA_ALIGNMENT, 0);
+    EXPECT_GE(header.data_offset, sizeof(GrmBinaryHeader) + header.id_bytes);
+}
+
+
+TEST(TestGrmIO, NotBinaryGrm) {
+    char fname[] { "test_grm_io_text.bin" };
+    FILE* fid { std::fopen(fname, "w") };
+    std::fprintf(fid, "1.0,2.0\n2.0,1.0\n");
+    std::fclose(fid);
+
+    EXPECT_THROW(read_grm_binary(fname), std::runtime_error);
+    std::remove(fname);
+}
+
+
+TEST(TestGrmIO, Text) {
+    Matrix a { 2, 2 };
+    a(0, 0) = 1;
+    a(0, 1) = 0.5;
+    a(1, 1) = 2;
+
+    FILE* fid { std::tmpfile() };
+    write_grm_text(fid, a);
+    std::rewind(fid);
+
+    char buf[100] { '\0' };
+    size_t n { std::fread(buf, 1, sizeof(buf) - 1, fid) };
+    std::fclose(fid);
+
+    EXPECT_EQ(std::string(buf, n), "1.00000,0.50000\n0.50000,2.00000\n");
+}
+
+
+TEST(TestGrmIO, Sparse) {
+    // more samples than a tile, so rows gather from several tiles
+    const size_t n { 600 };
+    Matrix a { n, n };
+
+    for (size_t i = 0; i < n; i++) {
+        a(i, i) = 1;
+        for (size_t j = i + 1; j < n; j++)
+            a(i, j) = (j - i) % 97 == 0 ? 0.25 : 0.01;
+    }
+
+    FILE* fid { std::tmpfile() };
+    size_t n_written { write_grm_sparse(fid, a, 0.1) };
+    std::rewind(fid);
+
+    size_t i { 0 };
+    size_t j { 0 };
+    double value { 0 };
+    size_t n_read { 0 };
+    size_t previous_i { 0 };
+    size_t previous_j { 0 };
+
+    while (std::fscanf(fid, "%zu %zu %lf", &i, &j, &value) == 3) {
+        ASSERT_GE(i, j);
+        EXPECT_EQ(value, i == j ? 1 : 0.25);
+        EXPECT_TRUE((i - j) % 97 == 0);
+
+        if (n_read > 0) {
+            EXPECT_TRUE(i > previous_i || (i == previous_i && j > previous_j));
+        }
+
+        previous_i = i;
+        previous_j = j;
+        n_read++;
+    }
+    std::fclose(fid);
+
+    size_t n_expected { n };
+    for (size_t d = 97; d < n; d += 97)
+        n_expected += n - d;
+
+    EXPECT_EQ(n_written, n_expected);
+    EXPECT_EQ(n_read, n_expected);
+
+    fid = std::tmpfile();
+    write_grm_ids(fid, { "a", "b" });
+    std::rewind(fid);
+
+    char buf[100] { '\0' };
+    size_t n_bytes { std::fread(buf, 1, sizeof(buf) - 1, fid) };
+    std::fclose(fid);
+
+    EXPECT_EQ(std::string(buf, n_bytes), "a\ta\nb\tb\n");
+}
+
+
+TEST(TestGrmIO, FormatRows) {
+    Matrix a { 3, 3 };
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = i; j < 3; j++)
+            a(i, j) = (i + 1) * 0.25 - j * 0.125;
+
+    FILE* fid { std::tmpfile() };
+    write_grm_text(fid, a);
+    std::rewind(fid);
+
+    char buf[200] { '\0' };
+    size_t n { std::fread(buf, 1, sizeof(buf) - 1, fid) };
+    std::fclose(fid);
+
+    std::string first;
+    std::string rest;
+    format_grm_rows(a, 0, 1, first);
+    format_grm_rows(a, 1, 3, rest);
+
+    EXPECT_EQ(first + rest, std::string(buf, n));
+    EXPECT_THROW(format_grm_rows(a, 2, 4, rest), std::out_of_range);
+}
+
+
+// accumulated in the file, complete once synced
+TEST(TestGrmIO, Mapped) {
+    char fname[] { "test_grm_io_mapped.bin" };
+    std::vector<std::string> ids { "S01", "sample_two", "S3" };
+
+    std::unique_ptr<Matrix> a { create_grm_mapped(fname, ids) };
+
+    double x { 1 };
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = i; j < 3; j++)
+            (*a)(i, j) += x++ / 3;
+
+    // as left by an interrupted run
+    a->sync();
+    EXPECT_THROW(read_grm_binary(fname), std::runtime_error);
+
+    sync_grm_mapped(fname, *a, 9);
+    a.reset();
+
+    GrmBinary grm { read_grm_binary(fname) };
+    std::remove(fname);
+
+    EXPECT_EQ(grm.n_markers, 9);
+    EXPECT_EQ(grm.sample_ids, ids);
+
+    x = 1;
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = i; j < 3; j++)
+            EXPECT_EQ((*grm.covariance)(i, j), x++ / 3);
+
+    EXPECT_THROW(create_grm_mapped("no_such_directory/grm.bin", ids), std::runtime_error);
+}
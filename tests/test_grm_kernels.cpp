@@ -0,0 +1,204 @@
+#include "../include/GrmKernels.h"
+#include <gtest/gtest.h>
+
+
+
+char RECORD_LINE[] { "chr12 1 . A T Q1 F1 INFO1 GT:AB:HD 0/0:2:1,0,1 0/0:1:0,2,0 1/0:0:0.5,0,2 1/1:1:2,0,0\n" };
+
+
+TEST(TestGrmKernels, AccumulateUpper) {
+    HaplotypeDataRecord record { 4, 3 };
+    record.parse_vcf_line(RECORD_LINE);
+
+    Matrix cov { 4, 4 };
+    accumulate_upper(record, cov);
+    accumulate_upper(record, cov);
+
+    for (size_t i = 0; i < 4; i++)
+        for (size_t j = i; j < 4; j++) {
+            double expected { 0 };
+            for (size_t k = 0; k < 3; k++)
+                expected += 2 * record(i, k) * record(j, k);
+
+            EXPECT_DOUBLE_EQ(cov(i, j), expected);
+        }
+
+    // lower triangle is not touched
+    EXPECT_EQ(cov(3, 0), 0);
+
+    Matrix wrong { 3, 3 };
+    EXPECT_THROW(accumulate_upper(record, wrong), std::runtime_error);
+}
+
+
+TEST(TestGrmKernels, AccumulateRows) {
+    HaplotypeDataRecord record { 4, 3 };
+    record.parse_vcf_line(RECORD_LINE);
+
+    Matrix full { 4, 4 };
+    accumulate_upper(record, full);
+
+    std::vector<size_t> rows { 2, 0 };
+    Matrix cross { 2, 4 };
+    accumulate_rows(record, rows, cross);
+
+    for (size_t r = 0; r < rows.size(); r++)
+        for (size_t j = 0; j < 4; j++)
+            EXPECT_DOUBLE_EQ(cross(r, j),
+                             rows[r] <= j ? full(rows[r], j) : full(j, rows[r]));
+}
+
+
+TEST(TestGrmKernels, AccumulateUpperWeight) {
+    HaplotypeDataRecord record { 4, 3 };
+    record.parse_vcf_line(RECORD_LINE);
+
+    Matrix cov { 4, 4 };
+    accumulate_upper(record, cov);
+    accumulate_upper(record, cov, 2);
+    accumulate_upper(record, cov, -3);
+
+    for (size_t i = 0; i < 4; i++)
+        for (size_t j = i; j < 4; j++)
+            EXPECT_DOUBLE_EQ(cov(i, j), 0);
+}
+
+
+TEST(TestGrmKernels, SparseMatchesDense) {
+    HaplotypeDataRecord record { 4, 3 };
+    record.parse_vcf_line(RECORD_LINE);
+
+    SparseDosage sparse { 4, 3 };
+    sparse.assign(record);
+
+    Matrix dense_cov { 4, 4 };
+    Matrix sparse_cov { 4, 4 };
+    accumulate_upper(record, dense_cov, 2);
+    accumulate_upper(sparse, sparse_cov, 2);
+
+    for (size_t i = 0; i < 4; i++)
+        for (size_t j = 0; j < 4; j++)
+            EXPECT_DOUBLE_EQ(sparse_cov(i, j), dense_cov(i, j));
+
+    std::vector<size_t> rows { 3, 1 };
+    Matrix dense_cross { 2, 4 };
+    Matrix sparse_cross { 2, 4 };
+    accumulate_rows(record, rows, dense_cross);
+    accumulate_rows(sparse, rows, sparse_cross);
+
+    for (size_t r = 0; r < 2; r++)
+        for (size_t j = 0; j < 4; j++)
+            EXPECT_DOUBLE_EQ(sparse_cross(r, j), dense_cross(r, j));
+
+    Matrix wrong { 3, 3 };
+    EXPECT_THROW(accumulate_upper(sparse, wrong), std::runtime_error);
+}
+
+
+TEST(TestGrmKernels, SparseEpsilon) {
+    char line[] { "chr1 1 . A T Q F I HD 0.001,1.998,0.001 1,0.01,0.99\n" };
+    HaplotypeDataRecord record { 2, 3 };
+    record.parse_vcf_line(line);
+
+    SparseDosage sparse { 2, 3, 0.05 };
+    sparse.assign(record);
+    EXPECT_EQ(sparse.n_nonzero(), 3);
+
+    Matrix cov { 2, 2 };
+    accumulate_upper(sparse, cov);
+
+    EXPECT_DOUBLE_EQ(cov(0, 0), 1.998 * 1.998);
+    EXPECT_DOUBLE_EQ(cov(0, 1), 0);
+    EXPECT_DOUBLE_EQ(cov(1, 1), 1 + 0.99 * 0.99);
+}
+
+
+TEST(TestGrmKernels, PairStates) {
+    char line[] { "chr1 1 . A T Q F I HD 0.02,1.97,0.01 0.95,0,1.05 0.6,0.7,0.7 1,0,1\n" };
+    HaplotypeDataRecord record { 4, 3 };
+    record.parse_vcf_line(line);
+
+    PairStates states { 4, 3, 0.1 };
+    states.assign(record);
+
+    Matrix cov { 4, 4 };
+    accumulate_upper(states, cov, 2);
+
+    // coded samples take the dot products of their states
+    EXPECT_DOUBLE_EQ(cov(0, 0), 8);
+    EXPECT_DOUBLE_EQ(cov(0, 1), 0);
+    EXPECT_DOUBLE_EQ(cov(1, 3), 4);
+    EXPECT_DOUBLE_EQ(cov(0, 2), 2 * 1.4);
+    EXPECT_DOUBLE_EQ(cov(1, 2), 2 * 1.3);
+    EXPECT_DOUBLE_EQ(cov(2, 2), 2 * (0.36 + 0.49 + 0.49));
+    EXPECT_DOUBLE_EQ(cov(2, 3), 2 * 1.3);
+
+    std::vector<size_t> rows { 2, 0 };
+    Matrix cross { 2, 4 };
+    accumulate_rows(states, rows, cross);
+
+    for (size_t r = 0; r < 2; r++)
+        for (size_t j = 0; j < 4; j++)
+            EXPECT_DOUBLE_EQ(2 * cross(r, j),
+                             rows[r] <= j ? cov(rows[r], j) : cov(j, rows[r]));
+}
+
+
+TEST(TestGrmKernels, FounderMajor) {
+    char second[] { "chr12 2 . A T Q1 F1 INFO1 HD 0,1,1 2,0,0 0,0,2 0.5,0.5,1\n" };
+
+    HaplotypeDataRecord rows { 4, 3 };
+    HaplotypeDataRecord columns { 4, 3 };
+    columns.set_layout(RecordLayout::founder_major);
+
+    DosagePanel panel { 4, 3, 2 };
+    Matrix expected { 4, 4 };
+    Matrix cov { 4, 4 };
+
+    const double founder_weights[] { 0.5, 2, 1 };
+    Matrix weighted { 4, 4 };
+    Matrix weighted_columns { 4, 4 };
+
+    for (char* line : { RECORD_LINE, second }) {
+        rows.parse_vcf_line(line);
+        accumulate_upper(rows, expected, 2);
+        accumulate_upper_weighted(rows, weighted, founder_weights);
+
+        columns.set_target(panel.next_marker());
+        columns.parse_vcf_line(line);
+        accumulate_upper(columns, cov, 2);
+        accumulate_upper_weighted(columns, weighted_columns, founder_weights);
+        panel.commit();
+    }
+
+    EXPECT_TRUE(panel.full());
+    EXPECT_EQ(panel.n_columns(), 6);
+    EXPECT_THROW(panel.next_marker(), std::runtime_error);
+
+    Matrix from_panel { 4, 4 };
+    accumulate_upper(panel, from_panel, 2);
+
+    for (size_t i = 0; i < 4; i++)
+        for (size_t j = i; j < 4; j++) {
+            EXPECT_DOUBLE_EQ(cov(i, j), expected(i, j));
+            EXPECT_DOUBLE_EQ(from_panel(i, j), expected(i, j));
+            EXPECT_DOUBLE_EQ(weighted_columns(i, j), weighted(i, j));
+        }
+
+    EXPECT_EQ(from_panel(3, 0), 0);
+
+    // records of either layout are copied in to a panel
+    panel.clear();
+    panel.append(rows);
+    panel.append(columns);
+
+    for (size_t i = 0; i < 4; i++)
+        for (size_t k = 0; k < 3; k++) {
+            EXPECT_DOUBLE_EQ(panel.column(k)[i], rows(i, k));
+            EXPECT_DOUBLE_EQ(panel.column(3 + k)[i], rows(i, k));
+        }
+
+    std::vector<size_t> selected { 0 };
+    Matrix cross { 1, 4 };
+    EXPECT_THROW(accumulate_rows(columns, selected, cross), std::runtime_error);
+}
@@ -0,0 +1,150 @@
+#include "../include/GrmNormalizer.h"
+#include "../include/GrmKernels.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+
+
+// normalized GRM of test.vcf by an explicit two pass computation
+Matrix two_pass_grm(Normalization mode) {
+    char fname[] { "../tests/test.vcf" };
+
+    HaplotypeVcfParser vcf_data { fname, 1000 };
+    const size_t n { vcf_data.n_samples() };
+    const size_t k { vcf_data.k_founders() };
+    HaplotypeDataRecord record { n, k };
+
+    Matrix grm { n, n };
+    size_t m_markers { 0 };
+    std::vector<double> mu(k), w(k);
+
+    while (vcf_data.load_record(record)) {
+        m_markers++;
+
+        for (size_t f = 0; f < k; f++) {
+            mu[f] = 0;
+            for (size_t i = 0; i < n; i++)
+                mu[f] += record(i, f) / n;
+
+            double p { mu[f] / 2 };
+            w[f] = 1;
+            if (mode == Normalization::standardize)
+                w[f] = 2 * p * (1 - p) > 1e-12 ? 1 / (2 * p * (1 - p)) : 0;
+        }
+
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = i; j < n; j++)
+                for (size_t f = 0; f < k; f++)
+                    grm(i, j) += w[f] * (record(i, f) - mu[f]) * (record(j, f) - mu[f]);
+    }
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++)
+            grm(i, j) /= m_markers;
+
+    return grm;
+}
+
+
+Matrix single_pass_grm(Normalization mode, bool sparse) {
+    char fname[] { "../tests/test.vcf" };
+
+    HaplotypeVcfParser vcf_data { fname, 1000 };
+    const size_t n { vcf_data.n_samples() };
+    const size_t k { vcf_data.k_founders() };
+    HaplotypeDataRecord record { n, k };
+    SparseDosage dosage { n, k };
+
+    GrmNormalizer normalizer { n, k, mode };
+    Matrix grm { n, n };
+
+    while (vcf_data.load_record(record)) {
+        normalizer.add_marker(record);
+        dosage.assign(record);
+
+        const double* weights { normalizer.founder_weights() };
+
+        if (weights == nullptr && sparse)
+            accumulate_upper(dosage, grm);
+        else if (weights == nullptr)
+            accumulate_upper(record, grm);
+        else if (sparse)
+            accumulate_upper_weighted(dosage, grm, weights);
+        else
+            accumulate_upper_weighted(record, grm, weights);
+    }
+
+    normalizer.finalize(grm);
+    return grm;
+}
+
+
+void expect_upper_near(const Matrix& a, const Matrix& b) {
+    const size_t n { a.dims()[0] };
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++)
+            EXPECT_NEAR(a(i, j), b(i, j), 1e-9 * (1 + std::fabs(b(i, j))));
+}
+
+
+TEST(TestGrmNormalizer, Center) {
+    Matrix expected { two_pass_grm(Normalization::center) };
+    expect_upper_near(single_pass_grm(Normalization::center, false), expected);
+    expect_upper_near(single_pass_grm(Normalization::center, true), expected);
+}
+
+
+TEST(TestGrmNormalizer, Standardize) {
+    Matrix expected { two_pass_grm(Normalization::standardize) };
+    expect_upper_near(single_pass_grm(Normalization::standardize, false), expected);
+    expect_upper_near(single_pass_grm(Normalization::standardize, true), expected);
+}
+
+
+TEST(TestGrmNormalizer, None) {
+    GrmNormalizer normalizer { 2, 2, Normalization::none };
+    EXPECT_EQ(normalizer.founder_weights(), nullptr);
+
+    Matrix cov { 2, 2 };
+    cov(0, 1) = 3;
+    normalizer.finalize(cov);
+    EXPECT_DOUBLE_EQ(cov(0, 1), 3);
+}
+
+
+TEST(TestGrmNormalizer, ParseNormalization) {
+    EXPECT_EQ(parse_normalization("none"), Normalization::none);
+    EXPECT_EQ(parse_normalization("center"), Normalization::center);
+    EXPECT_EQ(parse_normalization("standardize"), Normalization::standardize);
+    EXPECT_THROW(parse_normalization("scale"), std::runtime_error);
+}
+
+
+TEST(TestGrmNormalizer, PairCounts) {
+    char first[] { "chr1 1 . A T Q F I HD 2,0 0,2 .\n" };
+    char second[] { "chr1 2 . A T Q F I HD 2,0 0,2 1,1\n" };
+
+    HaplotypeDataRecord record { 3, 2 };
+    GrmNormalizer normalizer { 3, 2, Normalization::center };
+    PairCounts counts { 3 };
+    Matrix grm { 3, 3 };
+
+    for (char* line : { first, second }) {
+        record.parse_vcf_line(line);
+        counts.add_marker(record);
+        record.fill_missing_with_mean();
+        normalizer.add_marker(record);
+        accumulate_upper(record, grm);
+    }
+
+    normalizer.finalize(grm, &counts);
+
+    // both markers center samples 0 and 1 at (+-1, -+1)
+    EXPECT_DOUBLE_EQ(grm(0, 0), 2);
+    EXPECT_DOUBLE_EQ(grm(0, 1), -2);
+
+    // sample 2 is at the mean at either marker, observed once
+    EXPECT_DOUBLE_EQ(grm(2, 2), 0);
+    EXPECT_DOUBLE_EQ(grm(0, 2), 0);
+}
@@ -68,6 +68,214 @@ TEST(TestConstructorAssignment, Constructor) {
 
 
 
+TEST(TestConstructorAssignment, SampleMask) {
+
+    size_t num_founders { 3 };
+    std::vector<bool> mask { false, true, false, true };
+
+    char vcf_record[] { "chr12 1 . A T Q1 F1 INFO1 GT:AB:HD 0/0:2:1,0,1 0/0:1:0,2,0 1/0:0:0,0,2 1/1:1:2,0,0\n" };
+
+    HaplotypeDataRecord hap_record { 2, num_founders, mask };
+    hap_record.parse_vcf_line(vcf_record);
+
+    EXPECT_EQ(hap_record.dims()[0], 2);
+
+    EXPECT_EQ(hap_record(0,0), 0);
+    EXPECT_EQ(hap_record(0,1), 2);
+    EXPECT_EQ(hap_record(0,2), 0);
+
+    EXPECT_EQ(hap_record(1,0), 2);
+    EXPECT_EQ(hap_record(1,1), 0);
+    EXPECT_EQ(hap_record(1,2), 0);
+
+    // mask must agree with number of samples
+    EXPECT_THROW(HaplotypeDataRecord(3, num_founders, mask), std::runtime_error);
+
+    // mask shorter than the number of sample columns
+    HaplotypeDataRecord short_mask { 1, num_founders, { true, false } };
+    EXPECT_THROW(short_mask.parse_vcf_line(vcf_record), std::out_of_range);
+}
+
+
+TEST(TestConstructorAssignment, MissingValues) {
+
+    size_t num_founders { 3 };
+
+    char vcf_record[] { "chr12 1 . A T Q1 F1 INFO1 GT:AB:HD 0/0:2:1,0,1 ./. 1/0:0:. 1/1:1:2,.,0 0/1:1:0,1,1\n" };
+
+    HaplotypeDataRecord hap_record { 5, num_founders };
+    hap_record.parse_vcf_line(vcf_record);
+
+    EXPECT_EQ(hap_record.n_missing(), 3);
+    EXPECT_TRUE(hap_record.is_valid(0));
+    EXPECT_FALSE(hap_record.is_valid(1));
+    EXPECT_FALSE(hap_record.is_valid(2));
+    EXPECT_FALSE(hap_record.is_valid(3));
+    EXPECT_TRUE(hap_record.is_valid(4));
+    EXPECT_EQ(hap_record.valid_words()[0], 0b10001);
+
+    EXPECT_EQ(hap_record(3,0), 0);
+    EXPECT_EQ(hap_record(4,2), 1);
+
+    hap_record.fill_missing_with_mean();
+    EXPECT_DOUBLE_EQ(hap_record(1,0), 0.5);
+    EXPECT_DOUBLE_EQ(hap_record(2,1), 0.5);
+    EXPECT_DOUBLE_EQ(hap_record(3,2), 1);
+    EXPECT_EQ(hap_record(0,2), 1);
+
+    // the mask is reset by the next line
+    char complete[] { "chr12 2 . A T Q1 F1 INFO1 GT:AB:HD 0/0:2:1,0,1 0/0:2:1,0,1 0/0:2:1,0,1 0/0:2:1,0,1 0/0:2:1,0,1\n" };
+    hap_record.parse_vcf_line(complete);
+    EXPECT_EQ(hap_record.n_missing(), 0);
+    EXPECT_TRUE(hap_record.is_valid(1));
+
+    // a wrong number of dosages is still an error
+    char wrong[] { "chr12 3 . A T Q1 F1 INFO1 GT:AB:HD 0/0:2:1,0,1 0/0:2:1,0 0/0:2:1,0,1 0/0:2:1,0,1 0/0:2:1,0,1\n" };
+    EXPECT_THROW(hap_record.parse_vcf_line(wrong), std::runtime_error);
+}
+
+
+
+TEST(TestConstructorAssignment, FixedColumns) {
+    HaplotypeDataRecord record { 2, 2 };
+
+    EXPECT_EQ(record.chrom(), "");
+    EXPECT_EQ(record.pos(), -1);
+    EXPECT_EQ(record.ref(), '\0');
+
+    char line[] { "chr3 1042 rs7 A G 50 PASS EAF=0.25;FLAG;INFO_SCORE=0.9 GT:HD 0/1:1,1 1/1:0,2\n" };
+    record.parse_vcf_line(line);
+
+    // views of the record's copy, so the line may be reused
+    line[0] = 'X';
+
+    EXPECT_EQ(record.chrom(), "chr3");
+    EXPECT_EQ(record.pos(), 1042);
+    EXPECT_EQ(record.id(), "rs7");
+    EXPECT_EQ(record.ref(), 'A');
+    EXPECT_EQ(record.alt(), 'G');
+    EXPECT_EQ(record.qual(), "50");
+    EXPECT_EQ(record.filter(), "PASS");
+    EXPECT_EQ(record.format(), "GT:HD");
+
+    EXPECT_EQ(record.info("EAF"), "0.25");
+    EXPECT_EQ(record.info("INFO_SCORE"), "0.9");
+    EXPECT_EQ(record.info("INFO"), "");
+    EXPECT_EQ(record.info("FLAG"), "");
+    EXPECT_DOUBLE_EQ(record(1, 1), 2);
+
+    // the index of HD follows a change of FORMAT
+    char moved[] { "chr3 1043 . A G . PASS . HD:GT 2,0 .\n" };
+    record.parse_vcf_line(moved);
+
+    EXPECT_EQ(record.pos(), 1043);
+    EXPECT_DOUBLE_EQ(record(0, 0), 2);
+    EXPECT_FALSE(record.is_valid(1));
+
+    char no_hd[] { "chr3 1044 . A G . PASS . GT 0/1 1/1\n" };
+    EXPECT_THROW(record.parse_vcf_line(no_hd), std::runtime_error);
+
+    char short_line[] { "chr3 1045 . A G\n" };
+    EXPECT_THROW(record.parse_vcf_line(short_line), std::runtime_error);
+}
+
+
+TEST(TestConstructorAssignment, FounderMajor) {
+    char line[] { "chr1 5 . A T . PASS . GT:HD 0/1:1,0.5,0.5 ./.:. 1/1:0,2,0\n" };
+
+    HaplotypeDataRecord rows { 3, 3 };
+    HaplotypeDataRecord columns { 3, 3 };
+    columns.set_layout(RecordLayout::founder_major);
+
+    EXPECT_THROW(rows.founder_data(0), std::runtime_error);
+    EXPECT_EQ(columns.layout(), RecordLayout::founder_major);
+    EXPECT_EQ(columns.founder_stride(), 8);
+
+    rows.parse_vcf_line(line);
+    columns.parse_vcf_line(line);
+
+    EXPECT_EQ(columns.pos(), 5);
+    EXPECT_FALSE(columns.is_valid(1));
+
+    for (size_t i = 0; i < 3; i++)
+        for (size_t k = 0; k < 3; k++) {
+            EXPECT_DOUBLE_EQ(columns(i, k), rows(i, k));
+            EXPECT_DOUBLE_EQ(columns.founder_data(k)[i], rows(i, k));
+        }
+
+    // aligned columns with zero padding
+    for (size_t k = 0; k < 3; k++) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(columns.founder_data(k)) % 64, 0);
+
+        for (size_t i = 3; i < columns.founder_stride(); i++)
+            EXPECT_EQ(columns.founder_data(k)[i], 0);
+    }
+
+    columns.fill_missing_with_mean();
+    EXPECT_DOUBLE_EQ(columns(1, 1), 1.25);
+
+    // lines parsed in to storage of the caller
+    alignas(64) double target[3 * 8] {};
+    columns.set_target(target);
+    columns.parse_vcf_line(line);
+
+    EXPECT_EQ(columns.target(), target);
+    EXPECT_DOUBLE_EQ(target[1 * 8 + 2], 2);
+    EXPECT_DOUBLE_EQ(target[2 * 8 + 0], 0.5);
+    EXPECT_THROW(columns.set_target(target + 1), std::runtime_error);
+
+    columns.set_target(nullptr);
+    EXPECT_NE(columns.target(), target);
+    EXPECT_THROW(rows.set_target(target), std::runtime_error);
+}
+
+
+TEST(TestConstructorAssignment, SnpDosages) {
+    char line[] { "chr1 5 . A T . PASS . GT:DS:HD 0/1:0.9:1,1 ./.:.:0,2 1/1:1.8:. 0/0\n" };
+
+    HaplotypeDataRecord record { 4, 2 };
+    HaplotypeDataRecord dosages { 4, 1 };
+
+    EXPECT_THROW(record.set_snp_dosages(&record), std::runtime_error);
+
+    record.set_snp_dosages(&dosages);
+    record.parse_vcf_line(line);
+
+    // the haplotype dosages are unchanged
+    EXPECT_EQ(record.n_missing(), 2);
+    EXPECT_DOUBLE_EQ(record(1, 1), 2);
+    EXPECT_FALSE(record.is_valid(2));
+
+    EXPECT_EQ(dosages.n_missing(), 2);
+    EXPECT_DOUBLE_EQ(dosages(0, 0), 0.9);
+    EXPECT_FALSE(dosages.is_valid(1));
+    EXPECT_DOUBLE_EQ(dosages(2, 0), 1.8);
+    EXPECT_FALSE(dosages.is_valid(3));
+
+    // DS after HD, in to a founder major record
+    char after[] { "chr1 6 . A T . PASS . HD:DS 1,1:1 0,2:0.2 2,0:2 .:0.5\n" };
+    HaplotypeDataRecord columns { 4, 1 };
+    columns.set_layout(RecordLayout::founder_major);
+    record.set_snp_dosages(&columns);
+    record.parse_vcf_line(after);
+
+    EXPECT_EQ(record.n_missing(), 1);
+    EXPECT_DOUBLE_EQ(record(2, 0), 2);
+    EXPECT_EQ(columns.n_missing(), 0);
+    EXPECT_DOUBLE_EQ(columns.founder_data(0)[1], 0.2);
+    EXPECT_DOUBLE_EQ(columns.founder_data(0)[3], 0.5);
+
+    char no_ds[] { "chr1 7 . A T . PASS . GT:HD 0/1:1,1 0/1:1,1 0/1:1,1 0/1:1,1\n" };
+    EXPECT_THROW(record.parse_vcf_line(no_ds), std::runtime_error);
+
+    record.set_snp_dosages(nullptr);
+    record.parse_vcf_line(no_ds);
+    EXPECT_EQ(record.n_missing(), 0);
+
+    HaplotypeDataRecord wide { 4, 2 };
+    EXPECT_THROW(record.set_snp_dosages(&wide), std::runtime_error);
+}
+
 // TEST(TestConstructorAssignment, CopyConstructor) {
 //     
 //     size_t num_vcf_columns { 13 };
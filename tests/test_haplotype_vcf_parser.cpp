@@ -114,3 +114,47 @@ TEST(TestHaplotypeVCFParser, LoadRecord) {
     EXPECT_EQ(record(10,7),0.407);
 
 }
+
+TEST(TestHaplotypeVCFParser, SampleSelection) {
+
+    SampleSelection selection;
+    selection.keep = { "S02", "S04", "S11", "not_in_vcf" };
+    selection.remove = { "S04" };
+
+    HaplotypeVcfParser vcf { VCF_NAME, 100000, selection };
+
+    EXPECT_EQ(vcf.n_sample_columns(), 11);
+    EXPECT_EQ(vcf.n_samples(), 2);
+    EXPECT_EQ(vcf.sample_names()[0], "S02");
+    EXPECT_EQ(vcf.sample_names()[1], "S11");
+
+    HaplotypeDataRecord record { vcf.n_samples(),
+                                 vcf.k_founders(),
+                                 vcf.sample_mask() };
+
+    EXPECT_TRUE(vcf.load_record(record));
+    EXPECT_EQ(record.dims()[0], 2);
+    EXPECT_EQ(record.pos(), 788);
+
+    // S02
+    EXPECT_EQ(record(0,0), 0.001);
+    EXPECT_EQ(record(0,3), 0.989);
+    EXPECT_EQ(record(0,6), 1);
+
+    // S11
+    EXPECT_EQ(record(1,0), 0.592);
+    EXPECT_EQ(record(1,2), 1);
+    EXPECT_EQ(record(1,7), 0.407);
+
+    selection.keep = { "S99" };
+    selection.remove.clear();
+    EXPECT_THROW(HaplotypeVcfParser(VCF_NAME, 100000, selection), std::runtime_error);
+
+    // a keep list that was given empty, e.g. an empty --keep file
+    selection.keep.clear();
+    selection.has_keep = true;
+    EXPECT_THROW(HaplotypeVcfParser(VCF_NAME, 100000, selection), std::runtime_error);
+
+    selection.has_keep = false;
+    EXPECT_EQ(HaplotypeVcfParser(VCF_NAME, 100000, selection).n_samples(), 11);
+}
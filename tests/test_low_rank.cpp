@@ -0,0 +1,160 @@
+#include "../include/LowRank.h"
+#include "../include/VcfSimulator.h"
+#include <cmath>
+#include <gtest/gtest.h>
+
+
+
+char LOW_RANK_VCF_NAME[] { "../tests/test.vcf" };
+
+
+TEST(TestLowRank, Orthonormalize) {
+    Matrix a { 4, 3 };
+
+    double x { 1 };
+    for (size_t i = 0; i < 4; i++)
+        for (size_t j = 0; j < 3; j++)
+            a(i, j) = (x++) * (i == j ? 3 : 1);
+
+    orthonormalize_columns(a);
+
+    for (size_t p = 0; p < 3; p++)
+        for (size_t q = 0; q < 3; q++) {
+            double dot { 0 };
+            for (size_t i = 0; i < 4; i++)
+                dot += a(i, p) * a(i, q);
+
+            EXPECT_NEAR(dot, p == q ? 1 : 0, 1e-12);
+        }
+}
+
+
+TEST(TestLowRank, SymmetricEigen) {
+    // eigenvalues 4 and 2 with eigenvectors (1,1) and (1,-1)
+    Matrix a { 2, 2 };
+    a(0, 0) = 3;
+    a(0, 1) = 1;
+    a(1, 0) = 1;
+    a(1, 1) = 3;
+
+    Matrix vectors { 2, 2 };
+    std::vector<double> values;
+    symmetric_eigen(a, values, vectors);
+
+    ASSERT_EQ(values.size(), 2);
+    EXPECT_NEAR(values[0], 4, 1e-12);
+    EXPECT_NEAR(values[1], 2, 1e-12);
+    EXPECT_NEAR(std::fabs(vectors(0, 0)), std::sqrt(0.5), 1e-12);
+    EXPECT_NEAR(vectors(0, 0), vectors(1, 0), 1e-12);
+    EXPECT_NEAR(vectors(0, 1), -vectors(1, 1), 1e-12);
+}
+
+
+// Compare the randomized eigenpairs to those of the full GRM
+TEST(TestLowRank, RandomizedEigenMatchesFullGrm) {
+
+    HaplotypeVcfParser vcf { LOW_RANK_VCF_NAME };
+    HaplotypeDataRecord record { vcf.n_samples(), vcf.k_founders() };
+
+    const size_t n { vcf.n_samples() };
+    const size_t rank { 3 };
+
+    Matrix grm { n, n };
+    while (vcf.load_record(record))
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                for (size_t k = 0; k < vcf.k_founders(); k++)
+                    grm(i, j) += record(i, k) * record(j, k);
+
+    Matrix grm_copy { grm };
+    Matrix vectors { n, n };
+    std::vector<double> values;
+    symmetric_eigen(grm_copy, values, vectors);
+
+    RandomizedEigen eigen { n, rank, 4, 1 };
+
+    for (size_t pass = 0; pass < 4; pass++) {
+        vcf.rewind();
+        eigen.start_pass();
+
+        while (vcf.load_record(record))
+            eigen.add_marker(record);
+
+        if (pass < 3)
+            eigen.end_pass();
+    }
+
+    eigen.finalize();
+
+    ASSERT_EQ(eigen.eigenvalues().size(), rank);
+
+    for (size_t c = 0; c < rank; c++) {
+        EXPECT_NEAR(eigen.eigenvalues()[c], values[c], 1e-6 * values[0]);
+
+        // eigenvectors agree up to sign
+        double dot { 0 };
+        for (size_t i = 0; i < n; i++)
+            dot += eigen.eigenvectors()(i, c) * vectors(i, c);
+
+        EXPECT_NEAR(std::fabs(dot), 1, 1e-4);
+    }
+}
+
+
+// Without power iterations the range finder pass still gives the top
+// eigenvalues of a GRM whose founder structure fits in the sketch
+TEST(TestLowRank, NoPowerIterations) {
+    char fname[] { "test_low_rank_sim.vcf" };
+
+    SimulationParams params;
+    params.n_samples = 150;
+    params.n_markers = 300;
+    params.block_length = 1e6;      // no breakpoints, G has about rank k
+    params.seed = 28;
+    write_simulated_vcf(fname, params);
+
+    HaplotypeVcfParser vcf { fname };
+    HaplotypeDataRecord record { vcf.n_samples(), vcf.k_founders() };
+    const size_t n { vcf.n_samples() };
+    const size_t rank { 3 };
+
+    Matrix grm { n, n };
+    while (vcf.load_record(record))
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                for (size_t k = 0; k < vcf.k_founders(); k++)
+                    grm(i, j) += record(i, k) * record(j, k);
+
+    Matrix vectors { n, n };
+    std::vector<double> values;
+    symmetric_eigen(grm, values, vectors);
+
+    // l = 13 of 150 columns, enough for the 8 founders
+    RandomizedEigen eigen { n, rank, 10, 1 };
+    const size_t n_passes { RandomizedEigen::n_passes(0) };
+
+    EXPECT_EQ(n_passes, 2);
+
+    for (size_t pass = 0; pass < n_passes; pass++) {
+        vcf.rewind();
+        eigen.start_pass();
+
+        while (vcf.load_record(record))
+            eigen.add_marker(record);
+
+        if (pass + 1 < n_passes)
+            eigen.end_pass();
+    }
+
+    eigen.finalize();
+    std::remove(fname);
+
+    for (size_t c = 0; c < rank; c++)
+        EXPECT_NEAR(eigen.eigenvalues()[c], values[c], 1e-3 * values[c]);
+}
+
+
+TEST(TestLowRank, InvalidRank) {
+    EXPECT_THROW(RandomizedEigen(5, 6, 2, 1), std::runtime_error);
+    EXPECT_THROW(RandomizedEigen(5, 0, 2, 1), std::runtime_error);
+}
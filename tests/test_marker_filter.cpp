@@ -0,0 +1,105 @@
+#include "../include/MarkerFilter.h"
+#include "../include/HaplotypeVcfParser.h"
+#include <gtest/gtest.h>
+
+
+
+char FILTER_VCF_NAME[] { "../tests/test.vcf" };
+
+
+TEST(TestMarkerFilter, Inactive) {
+    MarkerFilter filter;
+    EXPECT_FALSE(filter.active());
+
+    filter.require_pass(true);
+    EXPECT_TRUE(filter.active());
+
+    EXPECT_THROW(filter.every_nth(0), std::runtime_error);
+    EXPECT_THROW(filter.eaf_range(0.5, 0.1), std::runtime_error);
+}
+
+
+TEST(TestMarkerFilter, InfoValue) {
+    char info[] { "EAF=0.01487;INFO_SCORE=0.17212;HWE=1" };
+    double value { 0 };
+
+    EXPECT_TRUE(MarkerFilter::info_value(info, std::strlen(info), "EAF", value));
+    EXPECT_DOUBLE_EQ(value, 0.01487);
+
+    EXPECT_TRUE(MarkerFilter::info_value(info, std::strlen(info), "INFO_SCORE", value));
+    EXPECT_DOUBLE_EQ(value, 0.17212);
+
+    EXPECT_TRUE(MarkerFilter::info_value(info, std::strlen(info), "HWE", value));
+    EXPECT_DOUBLE_EQ(value, 1);
+
+    EXPECT_FALSE(MarkerFilter::info_value(info, std::strlen(info), "HW", value));
+    EXPECT_FALSE(MarkerFilter::info_value(info, std::strlen(info), "PAF", value));
+}
+
+
+TEST(TestMarkerFilter, Accept) {
+    char pass[] { "chr1\t100\t.\tA\tG\t.\tPASS\tEAF=0.2;INFO_SCORE=0.9\tGT:HD\t" };
+    char fail[] { "chr1\t150\t.\tA\tG\t.\tq10\tEAF=0.2;INFO_SCORE=0.9\tGT:HD\t" };
+    char close[] { "chr1\t120\t.\tA\tG\t.\tPASS\tEAF=0.2;INFO_SCORE=0.9\tGT:HD\t" };
+    char far[] { "chr1\t200\t.\tA\tG\t.\tPASS\tEAF=0.2;INFO_SCORE=0.3\tGT:HD\t" };
+    char other_chrom[] { "chr2\t101\t.\tA\tG\t.\tPASS\tEAF=0.2;INFO_SCORE=0.9\tGT:HD\t" };
+
+    MarkerFilter filter;
+    filter.require_pass(true);
+    filter.min_spacing(50);
+    filter.min_info_score(0.5);
+
+    EXPECT_TRUE(filter.accept(pass));
+    EXPECT_FALSE(filter.accept(fail));
+    EXPECT_FALSE(filter.accept(close));
+    EXPECT_FALSE(filter.accept(far));
+    EXPECT_TRUE(filter.accept(other_chrom));
+
+    EXPECT_EQ(filter.n_accepted(), 2);
+    EXPECT_EQ(filter.n_rejected(), 3);
+
+    char truncated[] { "chr1\t100\t.\tA" };
+    EXPECT_THROW(filter.accept(truncated), std::runtime_error);
+}
+
+
+TEST(TestMarkerFilter, ParserThinning) {
+
+    HaplotypeVcfParser vcf { FILTER_VCF_NAME };
+    MarkerFilter filter;
+    filter.every_nth(3);
+    vcf.set_marker_filter(filter);
+
+    HaplotypeDataRecord record { vcf.n_samples(), vcf.k_founders() };
+
+    std::vector<long> positions;
+    while (vcf.load_record(record))
+        positions.push_back(record.pos());
+
+    ASSERT_GE(positions.size(), 3);
+    EXPECT_EQ(positions[0], 788);
+    EXPECT_EQ(positions[1], 1661);
+    EXPECT_EQ(positions[2], 2090);
+
+    // sample data of the kept markers is parsed as usual
+    EXPECT_EQ(vcf.marker_filter().n_accepted(), positions.size());
+}
+
+
+TEST(TestMarkerFilter, ParserEaf) {
+
+    HaplotypeVcfParser vcf { FILTER_VCF_NAME };
+    MarkerFilter filter;
+    filter.eaf_range(0.9, 1.0);
+    vcf.set_marker_filter(filter);
+
+    HaplotypeDataRecord record { vcf.n_samples(), vcf.k_founders() };
+
+    ASSERT_TRUE(vcf.load_record(record));
+    EXPECT_EQ(record.pos(), 1335);
+    EXPECT_EQ(record(0,0), 1.004);
+    EXPECT_EQ(record(10,7), 0.407);
+
+    ASSERT_TRUE(vcf.load_record(record));
+    EXPECT_EQ(record.pos(), 1661);
+}
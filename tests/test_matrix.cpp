@@ -1,6 +1,8 @@
 
 #include "../include/Matrix.h"
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <unistd.h>
 
 
 TEST(TestMatrix, initialize) {
@@ -85,3 +87,61 @@ TEST(TestMatrix, dim_and_size) {
 
     EXPECT_EQ(a.size(), n_row * m_col);
 }
+
+
+TEST(TestMatrix, mapped) {
+    // larger than 2 MB, so mapped rather than taken from the heap
+    for (bool huge_pages : { false, true }) {
+        Matrix::use_huge_pages(huge_pages);
+
+        Matrix a { 600, 600 };
+
+        EXPECT_EQ(a(0, 0), 0);
+        EXPECT_EQ(a(599, 599), 0);
+
+        a(300, 7) = 2.5;
+        Matrix b { a };
+        Matrix c { std::move(b) };
+
+        EXPECT_EQ(c(300, 7), 2.5);
+        EXPECT_EQ(c(599, 599), 0);
+    }
+
+    Matrix::use_huge_pages(false);
+}
+
+
+TEST(TestMatrix, file) {
+    char fname[] { "test_matrix_file.bin" };
+    const size_t offset { 4096 + 64 };
+    const size_t bytes { offset + 3 * 4 * sizeof(double) };
+
+    FILE* fid { std::fopen(fname, "w+b") };
+    ASSERT_NE(fid, nullptr);
+    ASSERT_EQ(ftruncate(fileno(fid), bytes), 0);
+
+    {
+        Matrix a { 3, 4, fileno(fid), offset };
+        EXPECT_EQ(a(2, 3), 0);
+
+        a(1, 2) = 1.5;
+        a(2, 3) = -2;
+        a.sync();
+
+        Matrix b { a };
+        b.sync();
+        EXPECT_EQ(b(1, 2), 1.5);
+    }
+
+    double values[12] { 0 };
+    ASSERT_EQ(std::fseek(fid, offset, SEEK_SET), 0);
+    ASSERT_EQ(std::fread(values, sizeof(double), 12, fid), 12);
+    std::fclose(fid);
+    std::remove(fname);
+
+    EXPECT_EQ(values[1 * 4 + 2], 1.5);
+    EXPECT_EQ(values[2 * 4 + 3], -2);
+    EXPECT_EQ(values[0], 0);
+
+    EXPECT_THROW(Matrix(3, 4, -1, 0), std::runtime_error);
+}
@@ -0,0 +1,104 @@
+#include "../include/PairCounts.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include <vector>
+
+
+
+TEST(TestPairCounts, MatchesDirectCount) {
+    const size_t n { 70 };
+    HaplotypeDataRecord record { n, 2 };
+    PairCounts counts { n };
+
+    std::vector<size_t> expected(n * n, 0);
+
+    // more than one batch of markers with missing samples, and markers
+    // without any
+    for (size_t m = 0; m < 150; m++) {
+
+        std::string line { "chr1 " + std::to_string(m + 1) + " . A T Q F I HD" };
+        std::vector<bool> valid(n);
+
+        for (size_t i = 0; i < n; i++) {
+            valid[i] = m % 3 == 0 || (i * 7 + m * 13) % 5 != 0;
+            line += valid[i] ? " 1,1" : " .";
+        }
+        line += "\n";
+
+        record.parse_vcf_line(line.c_str());
+        counts.add_marker(record);
+
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = i; j < n; j++)
+                expected[i * n + j] += valid[i] && valid[j];
+    }
+
+    EXPECT_EQ(counts.n_markers(), 150);
+    EXPECT_GT(counts.n_missing(), 0);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++) {
+            EXPECT_EQ(counts(i, j), expected[i * n + j]);
+            EXPECT_EQ(counts(j, i), expected[i * n + j]);
+        }
+
+    EXPECT_THROW(counts(n, 0), std::out_of_range);
+}
+
+
+TEST(TestPairCounts, Normalize) {
+    char first[] { "chr1 1 . A T Q F I HD 1,1 . 0,2\n" };
+    char second[] { "chr1 2 . A T Q F I HD 1,1 0,2 .\n" };
+
+    HaplotypeDataRecord record { 3, 2 };
+    PairCounts counts { 3 };
+
+    record.parse_vcf_line(first);
+    counts.add_marker(record);
+    record.parse_vcf_line(second);
+    counts.add_marker(record);
+
+    EXPECT_EQ(counts(0, 0), 2);
+    EXPECT_EQ(counts(0, 1), 1);
+    EXPECT_EQ(counts(1, 2), 0);
+
+    Matrix cov { 3, 3 };
+    cov(0, 0) = 4;
+    cov(0, 1) = 3;
+    cov(1, 2) = 0;
+    counts.normalize(cov);
+
+    EXPECT_DOUBLE_EQ(cov(0, 0), 2);
+    EXPECT_DOUBLE_EQ(cov(0, 1), 3);
+    EXPECT_TRUE(std::isnan(cov(1, 2)));
+}
+
+
+TEST(TestPairCounts, Merge) {
+    char lines[][64] { "chr1 1 . A T Q F I HD 1,1 . 0,2\n",
+                       "chr1 2 . A T Q F I HD 1,1 0,2 .\n",
+                       "chr1 3 . A T Q F I HD 1,1 0,2 2,0\n" };
+
+    HaplotypeDataRecord record { 3, 2 };
+    PairCounts all { 3 };
+    PairCounts first { 3 };
+    PairCounts second { 3 };
+
+    for (size_t m = 0; m < 3; m++) {
+        record.parse_vcf_line(lines[m]);
+        all.add_marker(record);
+        (m == 1 ? first : second).add_marker(record);
+    }
+
+    first.merge(second);
+
+    EXPECT_EQ(first.n_markers(), all.n_markers());
+    EXPECT_EQ(first.n_missing(), all.n_missing());
+
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = i; j < 3; j++)
+            EXPECT_EQ(first(i, j), all(i, j));
+
+    EXPECT_THROW(first.merge(PairCounts { 2 }), std::runtime_error);
+}
@@ -0,0 +1,48 @@
+#include "../include/PairStates.h"
+#include <gtest/gtest.h>
+
+
+
+TEST(TestPairStates, Table) {
+    PairStates states { 1, 3, 0.1 };
+
+    EXPECT_EQ(states.n_states(), 6);
+    EXPECT_EQ(states.state(0, 2), states.state(2, 0));
+    EXPECT_THROW(states.state(0, 3), std::out_of_range);
+
+    const uint8_t* table { states.table() };
+    const size_t s { states.n_states() };
+
+    PairCode hom0 { states.state(0, 0) };
+    PairCode het01 { states.state(0, 1) };
+    PairCode het12 { states.state(1, 2) };
+
+    EXPECT_EQ(table[hom0 * s + hom0], 4);
+    EXPECT_EQ(table[hom0 * s + het01], 2);
+    EXPECT_EQ(table[het01 * s + het01], 2);
+    EXPECT_EQ(table[het01 * s + het12], 1);
+    EXPECT_EQ(table[hom0 * s + het12], 0);
+}
+
+
+TEST(TestPairStates, Assign) {
+    char line[] { "chr1 1 . A T Q F I HD 0.02,1.97,0.01 0.95,0,1.05 0.6,0.7,0.7 0,0,0.9\n" };
+    HaplotypeDataRecord record { 4, 3 };
+    record.parse_vcf_line(line);
+
+    PairStates states { 4, 3, 0.1 };
+    states.assign(record);
+
+    EXPECT_EQ(states.codes()[0], states.state(1, 1));
+    EXPECT_EQ(states.codes()[1], states.state(0, 2));
+    EXPECT_EQ(states.codes()[2], EXACT_STATE);
+    EXPECT_EQ(states.codes()[3], EXACT_STATE);
+    EXPECT_EQ(states.n_exact(), 2);
+
+    EXPECT_DOUBLE_EQ(states.exact(2)[1], 0.7);
+    EXPECT_DOUBLE_EQ(states.exact(3)[2], 0.9);
+
+    HaplotypeDataRecord wrong { 3, 3 };
+    EXPECT_THROW(states.assign(wrong), std::runtime_error);
+    EXPECT_THROW(PairStates(4, 3, -1), std::runtime_error);
+}
@@ -0,0 +1,323 @@
+// Performance regression tests, built with -DHGRM_PERF_TESTS=ON and run
+// with ctest -L perf
+//
+// Affiliation: Palmer Lab at UCSD
+// Date: 2026-10-19
+//
+// A fixed seed VCF is generated in the working directory.  The GRM of
+// every kernel is checked against a plain reference of the hgrm loop,
+// one line at a time split with std::string and summed sample pair by
+// sample pair, so a faster kernel can not change the result.
+//
+// Throughputs are the best of a few repetitions, compared with the
+// baselines of perf_baselines.txt: a test fails when it is slower than
+// baseline * (1 - tolerance).  HGRM_PERF_SCALE multiplies every
+// baseline, e.g. 0.5 on a machine half as fast as the one they were
+// measured on.  Measured values are printed for updating the file.
+//
+#include "../include/GrmAccumulator.h"
+#include "../include/GrmKernels.h"
+#include "../include/VcfSimulator.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+
+char BASELINE_NAME[] { "../tests/perf_baselines.txt" };
+char PERF_VCF_NAME[] { "hgrm_perf.vcf" };
+
+const size_t PERF_REPEATS { 3 };
+
+
+SimulationParams perf_params() {
+    SimulationParams params;
+    params.n_samples = 300;
+    params.k_founders = 8;
+    params.n_markers = 400;
+    params.block_length = 50;
+    params.noise = 0.01;
+    params.seed = 46;
+    return params;
+}
+
+
+struct Baseline
+{
+    double value { 0 };
+    double tolerance { 0 };
+};
+
+
+std::map<std::string, Baseline> read_baselines() {
+    std::ifstream fin { BASELINE_NAME };
+    std::map<std::string, Baseline> baselines;
+    std::string line;
+
+    while (std::getline(fin, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields { line };
+        std::string name;
+        Baseline baseline;
+
+        if (fields >> name >> baseline.value >> baseline.tolerance)
+            baselines[name] = baseline;
+    }
+
+    return baselines;
+}
+
+
+// compare a throughput, in units per second, with its baseline
+void check_throughput(const std::string& name, double measured) {
+    static const std::map<std::string, Baseline> baselines { read_baselines() };
+
+    const char* scale_env { std::getenv("HGRM_PERF_SCALE") };
+    const double scale { scale_env != nullptr ? std::atof(scale_env) : 1 };
+
+    std::printf("%-28s %12.1f\n", name.c_str(), measured);
+    testing::Test::RecordProperty(name, std::to_string(measured));
+
+    auto found { baselines.find(name) };
+    ASSERT_NE(found, baselines.end()) << name << " has no baseline";
+
+    const double minimum { scale * found->second.value * (1 - found->second.tolerance) };
+    EXPECT_GE(measured, minimum) << name << " is slower than its baseline";
+}
+
+
+// shortest of PERF_REPEATS runs of f, in seconds
+template<typename F>
+double best_seconds(F f) {
+    double best { 0 };
+
+    for (size_t r = 0; r < PERF_REPEATS; r++) {
+        auto start { std::chrono::steady_clock::now() };
+        f();
+        std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start };
+
+        if (r == 0 || elapsed.count() < best)
+            best = elapsed.count();
+    }
+
+    return best;
+}
+
+
+std::vector<std::string> split(const std::string& s, char delim) {
+    std::vector<std::string> parts;
+    std::string part;
+    std::istringstream in { s };
+
+    while (std::getline(in, part, delim))
+        parts.push_back(part);
+
+    return parts;
+}
+
+
+// The hgrm loop written plainly: for each marker, the HD values of each
+// sample, 0 when missing, and cov(i, j) += x_i . x_j for j >= i
+std::vector<double> reference_grm(const char* filename, size_t& n_samples) {
+    std::ifstream fin { filename };
+    std::string line;
+    std::vector<double> cov;
+    std::vector<std::vector<double>> x;
+
+    while (std::getline(fin, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields { line };
+        std::vector<std::string> columns;
+        std::string column;
+
+        while (fields >> column)
+            columns.push_back(column);
+
+        const std::vector<std::string> format { split(columns[8], ':') };
+        const size_t hd { static_cast<size_t>(std::find(format.begin(), format.end(), "HD")
+                                              - format.begin()) };
+
+        x.assign(columns.size() - 9, {});
+
+        for (size_t i = 0; i < x.size(); i++) {
+            const std::vector<std::string> entries { split(columns[9 + i], ':') };
+
+            if (hd < entries.size() && entries[hd] != ".")
+                for (const std::string& value : split(entries[hd], ','))
+                    x[i].push_back(value == "." ? 0 : std::atof(value.c_str()));
+        }
+
+        n_samples = x.size();
+        cov.resize(n_samples * n_samples, 0);
+
+        for (size_t i = 0; i < n_samples; i++)
+            for (size_t j = i; j < n_samples; j++)
+                for (size_t k = 0; k < std::min(x[i].size(), x[j].size()); k++)
+                    cov[i * n_samples + j] += x[i][k] * x[j][k];
+    }
+
+    return cov;
+}
+
+
+class TestPerf : public testing::Test
+{
+protected:
+    static void SetUpTestSuite() {
+        write_simulated_vcf(PERF_VCF_NAME, perf_params());
+        reference_ = reference_grm(PERF_VCF_NAME, n_samples_);
+    }
+
+    // the GRM of all markers of the file by an accumulator
+    std::unique_ptr<Matrix> accumulate(const GrmOptions& options) {
+        HaplotypeVcfParser vcf_data { PERF_VCF_NAME, 100000 };
+        HaplotypeDataRecord record { vcf_data.n_samples(), vcf_data.k_founders() };
+        GrmAccumulator grm { vcf_data.n_samples(), vcf_data.k_founders(), options };
+
+        grm.attach(record);
+
+        while (vcf_data.load_record(record))
+            grm.add(record);
+
+        grm.finalize();
+        return grm.release();
+    }
+
+    void expect_reference(const Matrix& cov) {
+        ASSERT_EQ(cov.dims()[0], n_samples_);
+
+        for (size_t i = 0; i < n_samples_; i++)
+            for (size_t j = i; j < n_samples_; j++) {
+                const double expected { reference_[i * n_samples_ + j] };
+                ASSERT_NEAR(cov(i, j), expected, 1e-9 * (1 + std::fabs(expected)))
+                    << "entry " << i << ", " << j;
+            }
+    }
+
+    static std::vector<double> reference_;
+    static size_t n_samples_;
+};
+
+std::vector<double> TestPerf::reference_;
+size_t TestPerf::n_samples_ { 0 };
+
+
+TEST_F(TestPerf, KernelsMatchReference) {
+    GrmOptions options;
+    expect_reference(*accumulate(options));
+
+    options.kernel = GrmKernel::sparse;
+    expect_reference(*accumulate(options));
+
+    options.kernel = GrmKernel::pair_states;
+    expect_reference(*accumulate(options));
+
+    options.kernel = GrmKernel::change_points;
+    expect_reference(*accumulate(options));
+
+    options.kernel = GrmKernel::dense;
+    options.panel_markers = 64;
+    expect_reference(*accumulate(options));
+}
+
+
+// the reductions of --threads and --deterministic
+TEST_F(TestPerf, ReductionsMatchReference) {
+    HaplotypeVcfParser vcf_data { PERF_VCF_NAME, 100000 };
+    const size_t n { vcf_data.n_samples() };
+    const size_t k { vcf_data.k_founders() };
+    HaplotypeDataRecord record { n, k };
+
+    std::vector<std::unique_ptr<GrmAccumulator>> partial;
+    for (size_t t = 0; t < 3; t++)
+        partial.push_back(std::make_unique<GrmAccumulator>(n, k));
+
+    GrmAccumulator banded { n, k };
+    std::vector<double> founder_weights;
+
+    for (size_t m = 0; vcf_data.load_record(record); m++) {
+        partial[m % 3]->add(record);
+
+        banded.add_totals(record, founder_weights);
+        banded.add_rows(record, founder_weights, n / 3, n);
+        banded.add_rows(record, founder_weights, 0, n / 3);
+    }
+
+    partial[0]->merge(*partial[1]);
+    partial[0]->merge(*partial[2]);
+    partial[0]->finalize();
+    banded.finalize();
+
+    expect_reference(partial[0]->matrix());
+    expect_reference(banded.matrix());
+}
+
+
+TEST_F(TestPerf, ParseThroughput) {
+    HaplotypeVcfParser header { PERF_VCF_NAME, 100000 };
+    const size_t bytes { header.file_size() };
+
+    const double seconds { best_seconds([&] {
+        HaplotypeVcfParser vcf_data { PERF_VCF_NAME, 100000 };
+        HaplotypeDataRecord record { vcf_data.n_samples(), vcf_data.k_founders() };
+
+        while (vcf_data.load_record(record));
+    }) };
+
+    check_throughput("parse_mb_per_s", bytes / seconds / 1e6);
+}
+
+
+TEST_F(TestPerf, KernelThroughput) {
+    HaplotypeVcfParser vcf_data { PERF_VCF_NAME, 100000 };
+    const size_t n { vcf_data.n_samples() };
+    const size_t k { vcf_data.k_founders() };
+
+    // the parsed markers, as records and as one panel
+    std::vector<std::unique_ptr<HaplotypeDataRecord>> markers;
+    DosagePanel panel { n, k, perf_params().n_markers };
+
+    while (true) {
+        auto record { std::make_unique<HaplotypeDataRecord>(n, k) };
+        if (!vcf_data.load_record(*record))
+            break;
+
+        panel.append(*record);
+        markers.push_back(std::move(record));
+    }
+
+    const double m_markers { static_cast<double>(markers.size()) };
+    Matrix cov { n, n };
+
+    const double dense { best_seconds([&] {
+        for (const auto& record : markers)
+            accumulate_upper(*record, cov);
+    }) };
+    check_throughput("dense_markers_per_s", m_markers / dense);
+
+    const double from_panel { best_seconds([&] {
+        accumulate_upper(panel, cov);
+    }) };
+    check_throughput("panel_markers_per_s", m_markers / from_panel);
+
+    SparseDosage sparse { n, k };
+    const double sparse_seconds { best_seconds([&] {
+        for (const auto& record : markers) {
+            sparse.assign(*record);
+            accumulate_upper(sparse, cov);
+        }
+    }) };
+    check_throughput("sparse_markers_per_s", m_markers / sparse_seconds);
+}
@@ -0,0 +1,87 @@
+#include "../include/Profiler.h"
+#include "../include/HaplotypeVcfParser.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+
+
+TEST(TestProfiler, ScopedPhaseAccumulates) {
+    PhaseCounters counters { "test" };
+
+    for (size_t i = 0; i < 3; i++) {
+        ScopedPhase timed { &counters, Phase::parse };
+        timed.add_bytes(10);
+        timed.add_markers(1);
+    }
+
+    const PhaseStats& s { counters.stats(Phase::parse) };
+    EXPECT_EQ(s.calls, 3);
+    EXPECT_EQ(s.bytes, 30);
+    EXPECT_EQ(s.markers, 3);
+    EXPECT_GE(s.seconds, 0);
+
+    EXPECT_EQ(counters.stats(Phase::read).calls, 0);
+}
+
+
+TEST(TestProfiler, NullCountersIsNoOp) {
+    ScopedPhase timed { nullptr, Phase::read };
+    timed.add_bytes(1);
+}
+
+
+TEST(TestProfiler, ParserCountsPhases) {
+    char fname[] { "../tests/test.vcf" };
+
+    Profiler profiler;
+    PhaseCounters* counters { profiler.register_thread("main") };
+
+    HaplotypeVcfParser vcf_data { fname, 1000 };
+    HaplotypeDataRecord record { vcf_data.n_samples(), vcf_data.k_founders() };
+
+    vcf_data.set_profiler(counters);
+    record.set_profiler(counters);
+
+    size_t m_markers { 0 };
+    while (vcf_data.load_record(record))
+        m_markers++;
+
+    // the whole file has been read
+    EXPECT_EQ(vcf_data.bytes_read(), vcf_data.file_size());
+
+    EXPECT_EQ(profiler.total(Phase::read).markers, m_markers);
+    EXPECT_EQ(profiler.total(Phase::parse).calls, m_markers);
+    EXPECT_EQ(profiler.total(Phase::tokenize).calls, m_markers);
+    EXPECT_GT(profiler.total(Phase::read).bytes, 0);
+    EXPECT_LT(profiler.total(Phase::read).bytes, vcf_data.file_size());
+}
+
+
+TEST(TestProfiler, WriteJson) {
+    char fname[] { "test_profiler_metrics.json" };
+
+    Profiler profiler;
+    PhaseCounters* counters { profiler.register_thread("worker") };
+    {
+        ScopedPhase timed { counters, Phase::accumulate };
+        timed.add_markers(5);
+    }
+    counters->stop();
+
+    profiler.write_json(fname, {{"n_samples", "12"}, {"input", "\"x.vcf\""}});
+
+    std::ifstream fin { fname };
+    std::stringstream contents;
+    contents << fin.rdbuf();
+    std::remove(fname);
+
+    const std::string json { contents.str() };
+    EXPECT_NE(json.find("\"n_samples\": 12"), std::string::npos);
+    EXPECT_NE(json.find("\"input\": \"x.vcf\""), std::string::npos);
+    EXPECT_NE(json.find("\"accumulate\": { \"seconds\""), std::string::npos);
+    EXPECT_NE(json.find("\"markers\": 5"), std::string::npos);
+    EXPECT_NE(json.find("\"name\": \"worker\""), std::string::npos);
+    EXPECT_NE(json.find("\"peak_rss_kb\""), std::string::npos);
+}
@@ -0,0 +1,50 @@
+#include "../include/SparseDosage.h"
+#include <gtest/gtest.h>
+
+
+
+char SPARSE_LINE[] { "chr12 1 . A T Q1 F1 INFO1 GT:AB:HD 0/0:2:1,0,1 0/0:1:0,2,0 1/0:0:0.5,0,2 1/1:1:2,0,0\n" };
+
+
+TEST(TestSparseDosage, Assign) {
+    HaplotypeDataRecord record { 4, 3 };
+    record.parse_vcf_line(SPARSE_LINE);
+
+    SparseDosage sparse { 4, 3 };
+    sparse.assign(record);
+
+    EXPECT_EQ(sparse.n_nonzero(), 6);
+    EXPECT_DOUBLE_EQ(sparse.density(), 0.5);
+
+    // founder 0 is carried by samples 0, 2 and 3
+    const size_t* start { sparse.founder_start() };
+    ASSERT_EQ(start[1] - start[0], 3);
+    EXPECT_EQ(sparse.founder_samples()[0], 0);
+    EXPECT_EQ(sparse.founder_samples()[1], 2);
+    EXPECT_EQ(sparse.founder_samples()[2], 3);
+    EXPECT_DOUBLE_EQ(sparse.founder_values()[1], 0.5);
+
+    EXPECT_EQ(start[2] - start[1], 1);
+    EXPECT_EQ(start[3] - start[2], 2);
+
+    // sample 2 carries founders 0 and 2
+    const size_t* sample_start { sparse.sample_start() };
+    ASSERT_EQ(sample_start[3] - sample_start[2], 2);
+    EXPECT_EQ(sparse.sample_founders()[sample_start[2]], 0);
+    EXPECT_EQ(sparse.sample_founders()[sample_start[2] + 1], 2);
+    EXPECT_DOUBLE_EQ(sparse.sample_values()[sample_start[2] + 1], 2);
+}
+
+
+TEST(TestSparseDosage, Reassign) {
+    HaplotypeDataRecord record { 4, 3 };
+    record.parse_vcf_line(SPARSE_LINE);
+
+    SparseDosage sparse { 4, 3, 1 };
+    sparse.assign(record);
+    EXPECT_EQ(sparse.n_nonzero(), 3);
+
+    HaplotypeDataRecord wrong { 3, 3 };
+    EXPECT_THROW(sparse.assign(wrong), std::runtime_error);
+    EXPECT_THROW(SparseDosage(4, 3, -1), std::runtime_error);
+}
@@ -95,3 +95,96 @@ TEST(TestStringRecord, SingleArgConstructor) {
     EXPECT_FALSE(record.next_field());
 
 }
+
+
+TEST(TestStringRecord, SkipField) {
+    char s[] { "the\tcat\tsat\n" };
+    StringRecord record { '\t' };
+
+    record.update_str(s);
+
+    EXPECT_TRUE(record.skip_field());
+    EXPECT_TRUE(record.next_field());
+    EXPECT_EQ(static_cast<std::string>(record.data()), "cat");
+
+    EXPECT_TRUE(record.skip_field());
+    EXPECT_FALSE(record.next_field());
+    EXPECT_FALSE(record.skip_field());
+}
+
+
+TEST(TestReadSampleIds, OneAndTwoColumns) {
+    char fname[] { "test_read_sample_ids.txt" };
+
+    FILE* fid { std::fopen(fname, "w") };
+    std::fprintf(fid, "S01\nFAM S02\n\nS03");
+    std::fclose(fid);
+
+    std::vector<std::string> ids { read_sample_ids(fname) };
+    std::remove(fname);
+
+    ASSERT_EQ(ids.size(), 3);
+    EXPECT_EQ(ids[0], "S01");
+    EXPECT_EQ(ids[1], "S02");
+    EXPECT_EQ(ids[2], "S03");
+
+    EXPECT_THROW(read_sample_ids("no_such_file.txt"), std::runtime_error);
+}
+
+
+// every line of test.vcf, read with stdio
+std::vector<std::string> stdio_lines(char* fname) {
+    std::vector<std::string> lines;
+    BufferedRead reader { fname, 1000 };
+    CharBuffer line { 10000 };
+
+    while (reader.get_line(line) > 0)
+        lines.push_back(line.data());
+
+    return lines;
+}
+
+
+TEST(TestUringReader, MatchesStdio) {
+    char fname[] { "../tests/test.vcf" };
+    const std::vector<std::string> expected { stdio_lines(fname) };
+
+    // small blocks, so lines span blocks and the queue wraps
+    UringOptions options;
+    options.queue_depth = 2;
+    options.block_size = 4096;
+
+    for (bool direct : { false, true }) {
+        options.direct = direct;
+
+        BufferedRead reader { fname, 1000 };
+
+        if (!UringReader::available()) {
+            EXPECT_FALSE(reader.use_uring(options));
+            continue;
+        }
+
+        ASSERT_TRUE(reader.use_uring(options));
+
+        CharBuffer line { 10000 };
+        std::vector<std::string> lines;
+
+        while (reader.get_line(line) > 0)
+            lines.push_back(line.data());
+
+        EXPECT_EQ(lines, expected);
+
+        // read ahead limited to the start of the file, later blocks
+        // are requested as they are read
+        reader.seek(5000, 4096);
+        size_t n_lines { 0 };
+        while (reader.get_line(line) > 0)
+            n_lines++;
+
+        EXPECT_EQ(reader.offset(), reader.file_size());
+        EXPECT_GT(n_lines, 0);
+    }
+
+    options.block_size = 1000;
+    EXPECT_THROW(UringReader(fname, options), std::runtime_error);
+}
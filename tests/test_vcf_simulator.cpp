@@ -0,0 +1,90 @@
+#include "../include/VcfSimulator.h"
+#include "../include/HaplotypeVcfParser.h"
+#include <cmath>
+#include <gtest/gtest.h>
+
+
+
+TEST(TestVcfSimulator, ParsesAsHaplotypeVcf) {
+    char fname[] { "test_vcf_simulator.vcf" };
+
+    SimulationParams params;
+    params.n_samples = 13;
+    params.k_founders = 5;
+    params.n_markers = 40;
+    params.block_length = 4;
+    params.noise = 0.05;
+
+    write_simulated_vcf(fname, params);
+
+    HaplotypeVcfParser vcf { fname };
+    EXPECT_EQ(vcf.n_samples(), 13);
+    EXPECT_EQ(vcf.k_founders(), 5);
+    EXPECT_EQ(vcf.sample_names()[0], "S000001");
+
+    HaplotypeDataRecord record { vcf.n_samples(), vcf.k_founders() };
+
+    size_t m_markers { 0 };
+    long last_pos { 0 };
+    while (vcf.load_record(record)) {
+        EXPECT_GT(record.pos(), last_pos);
+        last_pos = record.pos();
+
+        EXPECT_EQ(record.format(), "GT:GP:DS:HD");
+
+        // haplotype dosages sum to two, up to rounding
+        for (size_t i = 0; i < vcf.n_samples(); i++) {
+            double total { 0 };
+            for (size_t f = 0; f < vcf.k_founders(); f++) {
+                EXPECT_GE(record(i, f), 0);
+                total += record(i, f);
+            }
+            EXPECT_NEAR(total, 2, 0.01);
+        }
+
+        m_markers++;
+    }
+
+    EXPECT_EQ(m_markers, 40);
+    std::remove(fname);
+}
+
+
+TEST(TestVcfSimulator, Deterministic) {
+    SimulationParams params;
+    params.n_samples = 7;
+    params.n_markers = 25;
+
+    FILE* a { std::tmpfile() };
+    FILE* b { std::tmpfile() };
+
+    VcfSimulator sim_a { params };
+    sim_a.write(a);
+    VcfSimulator sim_b { params };
+    sim_b.write(b);
+
+    ASSERT_EQ(sim_a.bytes_written(), sim_b.bytes_written());
+    EXPECT_GT(sim_a.bytes_written(), 0);
+
+    std::rewind(a);
+    std::rewind(b);
+    std::string text_a(sim_a.bytes_written(), '\0');
+    std::string text_b(sim_b.bytes_written(), '\0');
+    EXPECT_EQ(std::fread(&text_a[0], 1, text_a.size(), a), text_a.size());
+    EXPECT_EQ(std::fread(&text_b[0], 1, text_b.size(), b), text_b.size());
+    EXPECT_EQ(text_a, text_b);
+
+    std::fclose(a);
+    std::fclose(b);
+}
+
+
+TEST(TestVcfSimulator, InvalidParams) {
+    SimulationParams params;
+    params.k_founders = 0;
+    EXPECT_THROW(VcfSimulator{ params }, std::runtime_error);
+
+    params.k_founders = 8;
+    params.noise = 2;
+    EXPECT_THROW(VcfSimulator{ params }, std::runtime_error);
+}
@@ -0,0 +1,168 @@
+#include "../include/WorkStealing.h"
+#include "../include/HaplotypeVcfParser.h"
+#include "../include/GrmKernels.h"
+#include "../include/GrmNormalizer.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+
+char VCF_NAME[] { "../tests/test.vcf" };
+
+
+TEST(TestWorkStealing, SplitChunks) {
+    std::vector<VcfChunk> chunks { split_vcf_chunks({ 10, 5 }, { 100, 30 }, 40) };
+
+    ASSERT_EQ(chunks.size(), 4);
+    EXPECT_EQ(chunks[0].begin, 10);
+    EXPECT_EQ(chunks[0].end, 50);
+    EXPECT_EQ(chunks[2].begin, 90);
+    EXPECT_EQ(chunks[2].end, 100);
+    EXPECT_EQ(chunks[3].file, 1);
+    EXPECT_EQ(chunks[3].begin, 5);
+    EXPECT_EQ(chunks[3].end, 30);
+
+    // whole files
+    EXPECT_EQ(split_vcf_chunks({ 10, 5 }, { 100, 30 }, 0).size(), 2);
+    EXPECT_THROW(split_vcf_chunks({ 10 }, { 100, 30 }, 0), std::runtime_error);
+}
+
+
+TEST(TestWorkStealing, StealFromBack) {
+    WorkStealingScheduler scheduler { 2, 4 };
+    size_t task { 0 };
+
+    // worker 1 owns tasks 2 and 3, then steals the last task of worker 0
+    EXPECT_TRUE(scheduler.next(1, task));
+    EXPECT_EQ(task, 2);
+    EXPECT_TRUE(scheduler.next(1, task));
+    EXPECT_EQ(task, 3);
+    EXPECT_TRUE(scheduler.next(1, task));
+    EXPECT_EQ(task, 1);
+    EXPECT_EQ(scheduler.n_steals(), 1);
+
+    EXPECT_TRUE(scheduler.next(0, task));
+    EXPECT_EQ(task, 0);
+    EXPECT_FALSE(scheduler.next(0, task));
+    EXPECT_FALSE(scheduler.next(1, task));
+}
+
+
+TEST(TestWorkStealing, EachTaskOnce) {
+    const size_t n_tasks { 1000 };
+    WorkStealingScheduler scheduler { 4, n_tasks };
+    std::vector<std::atomic<int>> runs(n_tasks);
+
+    run_workers(4, [&](size_t worker) {
+        size_t task { 0 };
+        while (scheduler.next(worker, task))
+            runs[task]++;
+    });
+
+    for (size_t t = 0; t < n_tasks; t++)
+        EXPECT_EQ(runs[t], 1);
+
+    EXPECT_THROW(run_workers(2, [](size_t) { throw std::runtime_error("fail"); }),
+                 std::runtime_error);
+}
+
+
+// every worker sees the writes of the previous phase, and an abort
+// releases the workers still waiting
+TEST(TestWorkStealing, Barrier) {
+    const size_t n_workers { 4 };
+    Barrier barrier { n_workers };
+    std::vector<size_t> phase(n_workers, 0);
+    std::atomic<size_t> mismatches { 0 };
+
+    run_workers(n_workers, [&](size_t worker) {
+        for (size_t p = 1; p <= 50; p++) {
+            phase[worker] = p;
+            EXPECT_TRUE(barrier.wait());
+
+            for (size_t w = 0; w < n_workers; w++)
+                if (phase[w] != p)
+                    mismatches++;
+
+            EXPECT_TRUE(barrier.wait());
+        }
+    });
+
+    EXPECT_EQ(mismatches, 0);
+
+    Barrier failing { 3 };
+    EXPECT_THROW(run_workers(3, [&](size_t worker) {
+        if (worker == 2) {
+            failing.abort();
+            throw std::runtime_error("fail");
+        }
+
+        EXPECT_FALSE(failing.wait());
+    }), std::runtime_error);
+}
+
+
+// Chunks of test.vcf processed by alternating parsers and normalizers
+// give the GRM of a single pass over the file
+TEST(TestWorkStealing, ChunkedParser) {
+    HaplotypeVcfParser full { VCF_NAME, 1000 };
+    const size_t n { full.n_samples() };
+    const size_t k { full.k_founders() };
+    HaplotypeDataRecord record { n, k };
+
+    GrmNormalizer expected_normalizer { n, k, Normalization::center };
+    Matrix expected { n, n };
+    size_t m_markers { 0 };
+
+    while (full.load_record(record)) {
+        expected_normalizer.add_marker(record);
+        accumulate_upper(record, expected);
+        m_markers++;
+    }
+    expected_normalizer.finalize(expected);
+
+    // chunks smaller than a line, so some contain no line start
+    std::vector<VcfChunk> chunks { split_vcf_chunks({ full.data_offset() },
+                                                    { full.file_size() }, 700) };
+    ASSERT_GT(chunks.size(), m_markers);
+
+    std::vector<std::unique_ptr<HaplotypeVcfParser>> parsers;
+    std::vector<std::unique_ptr<GrmNormalizer>> normalizers;
+    std::vector<std::unique_ptr<Matrix>> grms;
+
+    for (size_t w = 0; w < 2; w++) {
+        parsers.push_back(std::make_unique<HaplotypeVcfParser>(1000, full));
+        normalizers.push_back(std::make_unique<GrmNormalizer>(n, k, Normalization::center));
+        grms.push_back(std::make_unique<Matrix>(n, n));
+    }
+
+    size_t m_chunked { 0 };
+
+    for (size_t c = 0; c < chunks.size(); c++) {
+        const size_t w { c % 2 };
+        parsers[w]->set_range(chunks[c].begin, chunks[c].end);
+
+        while (parsers[w]->load_record(record)) {
+            normalizers[w]->add_marker(record);
+            accumulate_upper(record, *grms[w]);
+            m_chunked++;
+        }
+    }
+
+    EXPECT_EQ(m_chunked, m_markers);
+
+    normalizers[0]->merge(*normalizers[1]);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++)
+            (*grms[0])(i, j) += (*grms[1])(i, j);
+
+    normalizers[0]->finalize(*grms[0]);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++)
+            EXPECT_NEAR((*grms[0])(i, j), expected(i, j),
+                        1e-9 * (1 + std::fabs(expected(i, j))));
+}